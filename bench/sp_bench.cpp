@@ -0,0 +1,612 @@
+// micro benchmarks for the data path: sp_bench <name> [args], prints one line per variant
+
+#include "csv_loader.h"
+#include "bar_cache.h"
+#include "bar_archive.h"
+#include "file_reader.h"
+#include "async_loader.h"
+#include "huge_pages.h"
+#include "correlation_engine.h"
+#include "feature_engineer.h"
+#include "streaming.h"
+#include "prediction_table.h"
+#include "tick_aggregator.h"
+#include "bar_normalize.h"
+#include "adjustments.h"
+#include "range_index.h"
+#include "linear_regression.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sp;
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// best of `runs` wall times in milliseconds
+double time_ms(const function<void()>& fn, int runs = 3) {
+    double best = 1e300;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = chrono::steady_clock::now();
+        fn();
+        auto t1 = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, milli>(t1 - t0).count());
+    }
+    return best;
+}
+
+// random walk with cent prices and whole-share volumes, one bar per calendar day
+vector<Bar> synthetic_bars(size_t n, uint64_t seed = 1) {
+    mt19937_64 rng(seed);
+    normal_distribution<double> step(0.0, 0.01);
+    vector<Bar> bars(n);
+    double px = 100.0;
+    int y = 1980, m = 1, d = 1;
+    for (size_t i = 0; i < n; ++i) {
+        double c = round(px * 100.0) / 100.0;
+        double o = round(c * (1.0 + step(rng) / 4) * 100.0) / 100.0;
+        bars[i] = {key_to_date(y * 10000 + m * 100 + d), o, max(o, c) + 0.05, min(o, c) - 0.05, c,
+                   round(1e6 * exp(step(rng) * 20))};
+        px = max(1.0, px * (1.0 + step(rng)));
+        if (++d > 28) { d = 1; if (++m > 12) { m = 1; ++y; } }
+    }
+    return bars;
+}
+
+void write_csv(const string& path, const vector<Bar>& bars) {
+    ofstream out(path);
+    out << "Date,Open,High,Low,Close,Volume\n" << fixed;
+    for (const auto& b : bars) {
+        out << b.date << setprecision(2) << ',' << b.open << ',' << b.high << ',' << b.low << ','
+            << b.close << setprecision(0) << ',' << b.volume << '\n';
+    }
+}
+
+fs::path scratch_dir() {
+    fs::path dir = fs::temp_directory_path() / "sp_bench";
+    fs::create_directories(dir);
+    return dir;
+}
+
+void report(const string& name, double ms, size_t items, const string& unit, uintmax_t bytes = 0) {
+    cout << "  " << left << setw(28) << name << right << fixed << setprecision(2) << setw(10) << ms
+         << " ms  " << setw(12) << setprecision(1) << items / (ms / 1000.0) / 1e6 << " M" << unit << "/s";
+    if (bytes) cout << "  " << setw(10) << bytes / 1024 << " KiB";
+    cout << "\n";
+}
+
+// CSV vs binary cache vs compressed archive, full reads into vector<Bar>
+int bench_archive(const vector<string>& args) {
+    size_t rows = args.empty() ? 2000000 : stoul(args[0]);
+    auto bars = synthetic_bars(rows);
+    fs::path dir = scratch_dir();
+    string csv = (dir / "bars.csv").string();
+    string spb = (dir / "bars.spb").string();
+    string spa = (dir / "bars.spa").string();
+    write_csv(csv, bars);
+    auto parsed = CSVLoader(csv).load();
+    BarCache::write(spb, parsed);
+    BarArchive::write(spa, parsed);
+
+    cout << "archive: " << rows << " bars\n";
+    report("csv load", time_ms([&] { CSVLoader(csv).load(); }), rows, "bars", fs::file_size(csv));
+    LoadOptions checked;
+    checked.quality.policy = QualityPolicy::Clamp;
+    report("csv load + quality checks", time_ms([&] { CSVLoader(csv).load(checked); }), rows, "bars");
+    report("binary cache (.spb) load", time_ms([&] { CSVLoader(spb).load(); }), rows, "bars", fs::file_size(spb));
+    report("archive (.spa) load", time_ms([&] { CSVLoader(spa).load(); }), rows, "bars", fs::file_size(spa));
+    LoadOptions close_only;
+    close_only.columns = kClose;
+    report("archive close column only", time_ms([&] { CSVLoader(spa).load(close_only); }), rows, "bars");
+    fs::remove_all(dir);
+
+    // the two decode kernels alone (cent deltas -> prices) against plain loops; without
+    // SP_ENABLE_NATIVE the vector path is picked at run time
+    vector<int64_t> deltas(rows), q(rows);
+    vector<double> prices(rows);
+    for (size_t i = 0; i < rows; ++i) deltas[i] = llround((bars[i].close - (i ? bars[i - 1].close : 0)) * 100);
+    double sink = 0.0;
+    report("prefix sum, scalar", time_ms([&] {
+        copy(deltas.begin(), deltas.end(), q.begin());
+        for (size_t i = 1; i < rows; ++i) q[i] += q[i - 1];
+        sink += static_cast<double>(q[rows - 1]);
+    }), rows, "values");
+    report("prefix sum, simd", time_ms([&] {
+        copy(deltas.begin(), deltas.end(), q.begin());
+        simd::prefix_sum_i64(q.data(), rows, 0);
+        sink += static_cast<double>(q[rows - 1]);
+    }), rows, "values");
+    report("int64 / 100 to double, scalar", time_ms([&] {
+        for (size_t i = 0; i < rows; ++i) prices[i] = static_cast<double>(q[i]) / 100.0;
+        sink += prices[rows - 1];
+    }), rows, "values");
+    report("int64 / 100 to double, simd", time_ms([&] {
+        simd::i64_div_to_f64(q.data(), rows, 100.0, prices.data());
+        sink += prices[rows - 1];
+    }), rows, "values");
+    return sink == 42.0;
+}
+
+// many small per-symbol files: sequential ifstream (CSVLoader::load) vs batched reads
+int bench_ingest(const vector<string>& args) {
+    size_t files = args.empty() ? 500 : stoul(args[0]);
+    size_t rows = args.size() > 1 ? stoul(args[1]) : 2000;
+    fs::path dir = scratch_dir() / "ingest";
+    fs::create_directories(dir);
+    vector<string> paths;
+    uintmax_t bytes = 0;
+    for (size_t f = 0; f < files; ++f) {
+        paths.push_back((dir / ("sym" + to_string(f) + ".csv")).string());
+        write_csv(paths.back(), synthetic_bars(rows, f + 1));
+        bytes += fs::file_size(paths.back());
+    }
+    size_t total = files * rows;
+
+    FileReaderOptions pread_opts;
+    pread_opts.use_uring = false;
+    FileReader uring_reader, pread_reader(pread_opts);
+    cout << "ingest: " << files << " files x " << rows << " bars, " << bytes / 1024 << " KiB"
+         << (uring_reader.uring() ? "" : " (io_uring unavailable, both readers use pread)") << "\n";
+
+    size_t sink = 0;
+    auto read_only = [&](FileReader& reader) {
+        reader.read_all(paths, [&](size_t, const char*, size_t len, const string&) { sink += len; });
+    };
+    auto read_parse = [&](FileReader& reader) {
+        reader.read_all(paths, [&](size_t, const char* data, size_t len, const string&) {
+            sink += CSVLoader::parse(data, len).size();
+        });
+    };
+    report("ifstream read", time_ms([&] {
+        for (const auto& p : paths) {
+            ifstream in(p, ios::binary);
+            string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            sink += text.size();
+        }
+    }), total, "bars");
+    report("pread read", time_ms([&] { read_only(pread_reader); }), total, "bars");
+    report("io_uring read", time_ms([&] { read_only(uring_reader); }), total, "bars");
+    report("ifstream read+parse", time_ms([&] {
+        for (const auto& p : paths) sink += CSVLoader(p).load().size();
+    }), total, "bars");
+    report("pread read+parse", time_ms([&] { read_parse(pread_reader); }), total, "bars");
+    report("io_uring read+parse", time_ms([&] { read_parse(uring_reader); }), total, "bars");
+    report("coroutine loader", time_ms([&] { sink += load_many_async(paths).size(); }), total, "bars");
+    fs::remove_all(dir);
+    return sink == 0;
+}
+
+// transparent huge pages currently backing anonymous memory, from /proc/meminfo
+long anon_huge_kb() {
+    ifstream in("/proc/meminfo");
+    string key;
+    long kb = 0;
+    while (in >> key) {
+        if (key == "AnonHugePages:") {
+            in >> kb;
+            return kb;
+        }
+        in.ignore(256, '\n');
+    }
+    return -1;
+}
+
+// sequential and random scans plus a covariance compute, once per allocation policy
+int bench_hugepages(const vector<string>& args) {
+    size_t mb = args.empty() ? 512 : stoul(args[0]);
+    size_t n = (mb << 20) / sizeof(double);
+    cout << "hugepages: " << mb << " MiB buffers\n";
+    pair<const char*, HugePagePolicy> policies[] = {{"off", HugePagePolicy::Off},
+                                                   {"thp (madvise)", HugePagePolicy::Advise},
+                                                   {"hugetlb", HugePagePolicy::Reserve}};
+    double sink = 0.0;
+    for (auto [name, policy] : policies) {
+        set_huge_page_policy(policy);
+        long thp0 = anon_huge_kb();
+        huge_vector<double> buf(n);
+        for (size_t i = 0; i < n; ++i) buf[i] = static_cast<double>(i & 1023);
+        HugePageStats st = huge_page_stats();
+        long thp = anon_huge_kb() - thp0;
+        cout << " " << name << ": hugetlb " << st.hugetlb_bytes / (1 << 20) << " MiB, advised "
+             << st.advised_bytes / (1 << 20) << " MiB, AnonHugePages +" << thp / 1024 << " MiB\n";
+
+        report("sequential sum", time_ms([&] {
+            double s = 0.0;
+            for (size_t i = 0; i < n; ++i) s += buf[i];
+            sink += s;
+        }), n, "values");
+        // dependent random walk: one TLB lookup per load, nothing to prefetch
+        size_t steps = 1 << 23;
+        report("random gather", time_ms([&] {
+            uint64_t x = 88172645463325252ull;
+            double s = 0.0;
+            for (size_t i = 0; i < steps; ++i) {
+                x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+                s += buf[(x + static_cast<uint64_t>(s)) % n];
+            }
+            sink += s;
+        }), steps, "loads");
+
+        size_t symbols = 1000, rows = min<size_t>(n / symbols, 2000);
+        CorrelationEngine engine(symbols, rows, 1);
+        report("covariance 1000 symbols", time_ms([&] { engine.compute(buf.data(), rows, rows); }, 1),
+               symbols * symbols / 2 * rows, "fma");
+    }
+    return sink == 42.0;
+}
+
+// ring handoff between two threads: batched throughput, then one-record latency;
+// then the whole streaming engine (features + prediction) over many symbols
+int bench_ring(const vector<string>& args) {
+    size_t count = args.empty() ? 10000000 : stoul(args[0]);
+    cout << "ring: " << count << " bar records of " << sizeof(BarRecord) << " bytes\n";
+    for (size_t batch : {size_t(1), size_t(16), size_t(256)}) {
+        SpscRing<BarRecord> ring(4096);
+        uint64_t sink = 0;
+        report("spsc batch=" + to_string(batch), time_ms([&] {
+            thread producer([&] {
+                vector<BarRecord> buf(batch);
+                for (size_t sent = 0; sent < count;) {
+                    size_t n = min(batch, count - sent);
+                    for (size_t k = 0; k < n; ++k) buf[k].date = static_cast<int32_t>(sent + k);
+                    size_t done = 0;
+                    while (done < n) {
+                        done += ring.push(buf.data() + done, n - done);
+                        if (done < n) this_thread::yield();
+                    }
+                    sent += n;
+                }
+            });
+            vector<BarRecord> out(batch);
+            for (size_t got = 0; got < count;) {
+                size_t n = ring.pop(out.data(), batch);
+                for (size_t k = 0; k < n; ++k) sink += out[k].date;
+                if (n == 0) this_thread::yield();
+                got += n;
+            }
+            producer.join();
+        }, 1), count, "bars");
+        if (sink == 42) cout << "";
+    }
+
+    // one record at a time with the producer waiting for each to be taken: the
+    // handoff latency alone, without queueing behind earlier records
+    size_t pings = min<size_t>(count / 100, 200000);
+    SpscRing<BarRecord> ring(64);
+    vector<double> latency_us;
+    latency_us.reserve(pings);
+    thread consumer([&] {
+        BarRecord r;
+        for (size_t got = 0; got < pings;) {
+            if (ring.try_pop(r)) {
+                latency_us.push_back((StreamingEngine::now_ns() - r.stamp_ns) / 1000.0);
+                ++got;
+            } else {
+                this_thread::yield();
+            }
+        }
+    });
+    for (size_t i = 0; i < pings; ++i) {
+        BarRecord r;
+        r.stamp_ns = StreamingEngine::now_ns();
+        while (!ring.try_push(r)) this_thread::yield();
+        while (!ring.empty()) this_thread::yield();
+    }
+    consumer.join();
+    sort(latency_us.begin(), latency_us.end());
+    cout << "  handoff latency (" << pings << " pings)   p50 " << fixed << setprecision(2)
+         << latency_us[pings / 2] << " us, p99 " << latency_us[pings * 99 / 100] << " us\n";
+
+    // streaming engine: 500 symbols with fitted models, bars interleaved across symbols
+    size_t symbols = 500, per_symbol = max<size_t>(200, count / 500 / 10);
+    FeatureConfig config;
+    vector<vector<Bar>> series(symbols);
+    vector<BarRecord> feed;
+    feed.reserve(symbols * per_symbol);
+    for (size_t s = 0; s < symbols; ++s) series[s] = synthetic_bars(per_symbol, s + 1);
+    for (size_t i = 0; i < per_symbol; ++i) {
+        for (size_t s = 0; s < symbols; ++s) {
+            BarRecord r;
+            r.symbol = static_cast<uint32_t>(s);
+            r.date = date_to_key(series[s][i].date);
+            r.close = series[s][i].close;
+            r.volume = series[s][i].volume;
+            feed.push_back(r);
+        }
+    }
+    unsigned threads = max(1u, thread::hardware_concurrency() - 1);
+    StreamingEngine engine(config, threads, 4096);
+    for (size_t s = 0; s < symbols; ++s) {
+        FeatureEngineer engineer(config);
+        auto [X, y] = engineer.create_features(series[s], 1);
+        LinearRegression model;
+        if (model.train(X, y)) engine.set_model(static_cast<uint32_t>(s), model);
+    }
+    engine.start([](const BarRecord&, double) {});
+    double ms = time_ms([&] {
+        for (size_t i = 0; i < feed.size(); i += 256) {
+            engine.push(feed.data() + i, min<size_t>(256, feed.size() - i));
+        }
+        engine.stop();
+    }, 1);
+    StreamStats stats = engine.stats();
+    report("engine " + to_string(threads) + " compute threads", ms, feed.size(), "bars");
+    cout << "  engine handoff latency        p50 " << stats.p50_latency_us << " us, p99 "
+         << stats.p99_latency_us << " us, " << stats.predictions << " predictions\n";
+    return stats.bars != feed.size();
+}
+
+// shared-memory prediction table: publish and read cost per entry, alone and while a
+// writer keeps rewriting the entries being read
+int bench_shm(const vector<string>& args) {
+    size_t ops = args.empty() ? 20000000 : stoul(args[0]);
+    uint32_t symbols = 4096;
+    PredictionTable table = PredictionTable::create("sp_bench", symbols);
+    PredictionTable view = PredictionTable::open("sp_bench");
+    cout << "shm: " << ops << " operations over " << symbols << " symbols\n";
+    report("publish", time_ms([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            table.publish(static_cast<uint32_t>(i & (symbols - 1)), {double(i), 20240101, int64_t(i), 1});
+        }
+    }), ops, "ops");
+    double sink = 0.0;
+    PredictionValue v;
+    report("read", time_ms([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            if (view.read(static_cast<uint32_t>(i & (symbols - 1)), v)) sink += v.prediction;
+        }
+    }), ops, "ops");
+    atomic<bool> stop{false};
+    thread writer([&] {
+        for (uint64_t i = 0; !stop; ++i) {
+            table.publish(static_cast<uint32_t>(i & 15), {double(i), 20240101, int64_t(i), 1});
+        }
+    });
+    report("read, 16 hot symbols rewritten", time_ms([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            if (view.read(static_cast<uint32_t>(i & 15), v)) sink += v.prediction;
+        }
+    }), ops, "ops");
+    stop = true;
+    writer.join();
+    PredictionTable::remove("sp_bench");
+    return sink == 42.0;
+}
+
+// random trades over many symbols: aggregation alone, then csv and .spt input end to end
+int bench_ticks(const vector<string>& args) {
+    size_t n = args.empty() ? 20000000 : stoul(args[0]);
+    uint32_t symbols = 2000;
+    mt19937_64 rng(7);
+    uniform_int_distribution<uint32_t> pick(0, symbols - 1);
+    normal_distribution<double> step(0.0, 0.0005);
+    vector<double> px(symbols, 100.0);
+    vector<Tick> ticks(n);
+    int64_t t = 1704186000LL * 1000000000;  // 2024-01-02 09:00 UTC
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t s = pick(rng);
+        t += 1000 + rng() % 200000;
+        px[s] *= 1.0 + step(rng);
+        ticks[i] = {t, round(px[s] * 100) / 100, double(1 + rng() % 500), s, 0};
+    }
+    vector<BarSpec> specs = {BarSpec::parse("time1m"), BarSpec::parse("volume50000"),
+                             BarSpec::parse("dollar5000000")};
+    size_t bars = 0;
+    auto count_bar = [&](const AggregatedBar&) { ++bars; };
+    cout << "ticks: " << n << " trades, " << symbols << " symbols, time1m + volume50000 + dollar5000000\n";
+    report("aggregate (3 specs)", time_ms([&] {
+        TickAggregator agg(specs, count_bar);
+        agg.add(ticks.data(), ticks.size());
+        agg.flush();
+    }), n, "ticks");
+    report("aggregate (time1m only)", time_ms([&] {
+        TickAggregator agg({specs[0]}, count_bar);
+        agg.add(ticks.data(), ticks.size());
+        agg.flush();
+    }), n, "ticks");
+
+    fs::path dir = scratch_dir();
+    string csv = (dir / "ticks.csv").string();
+    string spt = (dir / "ticks.spt").string();
+    SymbolTable names;
+    for (uint32_t s = 0; s < symbols; ++s) names.id("S" + to_string(s));
+    write_ticks(spt, ticks, names);
+    {
+        ofstream out(csv);
+        out << "Symbol,Timestamp,Price,Size\n" << fixed << setprecision(2);
+        for (const auto& k : ticks) out << 'S' << k.symbol << ',' << k.time_ns << ',' << k.price << ',' << k.size << '\n';
+    }
+    auto read_agg = [&](const string& path) {
+        SymbolTable table;
+        TickAggregator agg(specs, count_bar);
+        read_ticks(path, table, [&](const Tick* p, size_t m) { agg.add(p, m); });
+        agg.flush();
+    };
+    report("csv read + aggregate", time_ms([&] { read_agg(csv); }, 1), n, "ticks", fs::file_size(csv));
+    report(".spt read + aggregate", time_ms([&] { read_agg(spt); }), n, "ticks", fs::file_size(spt));
+    fs::remove(csv);
+    fs::remove(spt);
+    return bars == 0;
+}
+
+// radix normalization vs std::sort on date strings, for a shuffled file with repeats
+int bench_normalize(const vector<string>& args) {
+    size_t rows = args.empty() ? 2000000 : stoul(args[0]);
+    auto sorted = synthetic_bars(rows);
+    auto shuffled = sorted;
+    mt19937_64 rng(3);
+    for (size_t i = 0; i < rows / 20; ++i) shuffled[rng() % rows] = sorted[rng() % rows];  // ~5% repeats
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    cout << "normalize: " << rows << " bars\n";
+    size_t kept = 0;
+    report("std::sort on strings + unique", time_ms([&] {
+        auto bars = shuffled;
+        stable_sort(bars.begin(), bars.end(), [](const Bar& a, const Bar& b) { return a.date < b.date; });
+        auto last = unique(bars.begin(), bars.end(), [](const Bar& a, const Bar& b) { return a.date == b.date; });
+        kept = size_t(last - bars.begin());
+    }), rows, "bars");
+    NormalizeStats stats;
+    report("radix normalize (shuffled)", time_ms([&] {
+        auto bars = shuffled;
+        normalize_bars(bars, DuplicatePolicy::KeepFirst, &stats);
+    }), rows, "bars");
+    report("radix normalize (in order)", time_ms([&] {
+        auto bars = sorted;
+        normalize_bars(bars, DuplicatePolicy::KeepFirst);
+    }), rows, "bars");
+    report("copy only (baseline)", time_ms([&] { auto bars = shuffled; }), rows, "bars");
+    return stats.rows_out != kept;
+}
+
+// adjusted copy of the bars vs reading columns through the view, and the cost of a new action
+int bench_adjust(const vector<string>& args) {
+    size_t rows = args.empty() ? 2000000 : stoul(args[0]);
+    auto bars = synthetic_bars(rows);
+    AdjustmentTable table;
+    for (size_t i = 1; i <= 40; ++i) {
+        table.add({date_to_key(bars[i * rows / 41].date), i % 4 ? 1.0 : 2.0, i % 4 ? 0.25 : 0.0});
+    }
+    cout << "adjust: " << rows << " bars, " << table.actions().size() << " actions\n";
+    double sink = 0.0;
+    report("adjusted copy (to_bars)", time_ms([&] {
+        auto copy = AdjustedView(bars, table).to_bars();
+        sink += copy.back().close;
+    }), rows, "bars");
+    report("view close + volume", time_ms([&] {
+        AdjustedView view(bars, table);
+        sink += view.column(kClose).back() + view.column(kVolume).back();
+    }), rows, "bars");
+    int updates = 1000;
+    double ms = time_ms([&] {
+        AdjustmentTable t = table;
+        for (int k = 0; k < updates; ++k) {
+            t.add({date_to_key(bars.back().date), 1.0, 0.01});
+            sink += AdjustedView(bars, t).segments().size();
+        }
+    });
+    cout << "  " << left << setw(28) << "new action + view rebuild" << right << fixed << setprecision(2)
+         << setw(10) << ms * 1000.0 / updates << " us each\n";
+    return sink == 0.0;
+}
+
+// random date-range aggregates through the index vs a scan of the rows, and the stored index
+int bench_range(const vector<string>& args) {
+    size_t rows = args.empty() ? 2000000 : stoul(args[0]);
+    size_t queries = args.size() > 1 ? stoul(args[1]) : 1000000;
+    auto bars = synthetic_bars(rows);
+    mt19937_64 rng(7);
+    vector<pair<size_t, size_t>> ranges(queries);
+    for (auto& r : ranges) {
+        size_t a = rng() % rows, b = rng() % rows;
+        r = {min(a, b), max(a, b) + 1};
+    }
+    cout << "range: " << rows << " bars, " << queries << " queries\n";
+    RangeIndex index;
+    report("build", time_ms([&] { index = RangeIndex::build(bars); }), rows, "bars");
+    double sink = 0.0;
+    report("index query", time_ms([&] {
+        for (const auto& [first, last] : ranges) sink += index.query_rows(first, last).vwap;
+    }), queries, "queries");
+    size_t scans = min<size_t>(queries, 200);
+    report("linear scan", time_ms([&] {
+        for (size_t q = 0; q < scans; ++q) {
+            double hi = -HUGE_VAL, lo = HUGE_VAL, vol = 0.0, pv = 0.0;
+            for (size_t i = ranges[q].first; i < ranges[q].second; ++i) {
+                hi = max(hi, bars[i].high);
+                lo = min(lo, bars[i].low);
+                vol += bars[i].volume;
+                pv += (bars[i].high + bars[i].low + bars[i].close) / 3.0 * bars[i].volume;
+            }
+            sink += hi - lo + pv / vol;
+        }
+    }), scans, "queries");
+
+    fs::path dir = scratch_dir();
+    string plain = (dir / "range.spb").string(), indexed = (dir / "range_indexed.spb").string();
+    BarCache::write(plain, bars);
+    BarCache::write(indexed, bars, 1024, true);
+    cout << "  .spb " << fs::file_size(plain) << " bytes, with index " << fs::file_size(indexed) << " bytes\n";
+    report("open .spb, build index", time_ms([&] { sink += BarCache::range_index(plain).size(); }), rows, "bars");
+    report("open .spb, stored index", time_ms([&] { sink += BarCache::range_index(indexed).size(); }), rows, "bars");
+    fs::remove(plain);
+    fs::remove(indexed);
+    return sink == 0.0;
+}
+
+// one long series through features and training, inline vs on the task graph
+int bench_pipeline(const vector<string>& args) {
+    size_t rows = args.empty() ? 2000000 : stoul(args[0]);
+    unsigned threads = args.size() > 1 ? stoul(args[1]) : default_threads();
+    auto bars = synthetic_bars(rows);
+    cout << "pipeline: " << rows << " bars, 1 vs " << threads << " threads\n";
+    double sink = 0.0;
+    for (unsigned t : {1u, threads}) {
+        FeatureConfig config;
+        config.threads = t;
+        vector<vector<double>> X;
+        vector<double> y;
+        report("features, " + to_string(t) + " thread(s)", time_ms([&] {
+            tie(X, y) = FeatureEngineer(config).create_features(bars, 1);
+        }), rows, "bars");
+        LinearRegression model;
+        model.set_threads(t);
+        report("train, " + to_string(t) + " thread(s)", time_ms([&] { model.train(X, y); }), X.size(), "rows");
+        sink += model.is_trained() ? model.coefficients()[0] : 0.0;
+    }
+    return sink == 0.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    map<string, function<int(const vector<string>&)>> benches = {
+        {"archive", bench_archive},
+        {"ingest", bench_ingest},
+        {"hugepages", bench_hugepages},
+        {"ring", bench_ring},
+        {"shm", bench_shm},
+        {"ticks", bench_ticks},
+        {"normalize", bench_normalize},
+        {"adjust", bench_adjust},
+        {"range", bench_range},
+        {"pipeline", bench_pipeline},
+    };
+    if (argc < 2 || !benches.count(argv[1])) {
+        cerr << "Usage: sp_bench <benchmark> [args]\n\nBenchmarks:\n";
+        cerr << "  archive [rows=2000000]    csv (with and without quality checks) vs .spb vs .spa loading\n";
+        cerr << "  ingest [files=500] [rows=2000]  ifstream vs pread vs io_uring per-symbol reads\n";
+        cerr << "  hugepages [mb=512]        scans and a covariance under each allocation policy\n";
+        cerr << "  ring [bars=10000000]      spsc handoff throughput/latency and the streaming engine\n";
+        cerr << "  shm [ops=20000000]        shared-memory prediction table publish/read\n";
+        cerr << "  ticks [n=20000000]        tick-to-bar aggregation, csv and .spt input\n";
+        cerr << "  normalize [rows=2000000]  radix sort + dedup of shuffled bars vs std::sort on strings\n";
+        cerr << "  adjust [rows=2000000]     split/dividend view reads vs an adjusted copy of the bars\n";
+        cerr << "  range [rows=2000000] [queries=1000000]  range ohlc/vwap via the index vs a linear scan\n";
+        cerr << "  pipeline [rows=2000000] [threads=cores]  features + training of one series, 1 vs n threads\n";
+        return 1;
+    }
+    vector<string> args(argv + 2, argv + argc);
+    try {
+        return benches[argv[1]](args);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,249 @@
+"""ctypes binding for libsp (src/sp_api.h).
+
+Arrays returned by Pipeline are numpy views over memory owned by the pipeline:
+no copies, but they are only valid until the next push/run or until the
+pipeline is freed. Copy them (arr.copy()) if they need to outlive it.
+
+    from libsp import Pipeline
+    with Pipeline(prediction_days=1, train_ratio=0.8) as p:
+        p.push_bars(dates, open_, high, low, close, volume)
+        p.run()
+        X = p.features()        # (rows, cols) float64 view
+        pred = p.predictions()
+        p.range_query(20240101, 20240331)   # {"high": ..., "low": ..., "vwap": ...}
+
+    with RangeIndex("data/stock_data.spb") as idx:
+        idx.query(20240101, 20240331)
+"""
+
+import ctypes
+import ctypes.util
+import os
+import sys
+
+import numpy as np
+
+_SP_OK = 0
+_API_VERSION = 2
+
+_double_p = ctypes.POINTER(ctypes.c_double)
+_size_p = ctypes.POINTER(ctypes.c_size_t)
+
+
+class Metrics(ctypes.Structure):
+    _fields_ = [
+        ("train_rmse", ctypes.c_double),
+        ("train_r2", ctypes.c_double),
+        ("test_rmse", ctypes.c_double),
+        ("test_r2", ctypes.c_double),
+        ("train_rows", ctypes.c_size_t),
+        ("test_rows", ctypes.c_size_t),
+    ]
+
+
+class RangeStats(ctypes.Structure):
+    _fields_ = [
+        ("rows", ctypes.c_size_t),
+        ("first_date", ctypes.c_int32),
+        ("last_date", ctypes.c_int32),
+        ("open", ctypes.c_double),
+        ("high", ctypes.c_double),
+        ("low", ctypes.c_double),
+        ("close", ctypes.c_double),
+        ("volume", ctypes.c_double),
+        ("vwap", ctypes.c_double),
+    ]
+
+    def as_dict(self):
+        return {name: getattr(self, name) for name, _ in self._fields_}
+
+
+def _find_library():
+    names = {"win32": "sp.dll", "darwin": "libsp.dylib"}
+    name = names.get(sys.platform, "libsp.so")
+    here = os.path.dirname(os.path.abspath(__file__))
+    candidates = [os.environ.get("SP_LIBRARY", "")]
+    for build in ("build", os.path.join("build", "Release")):
+        candidates.append(os.path.join(here, build, name))
+    for path in candidates:
+        if path and os.path.exists(path):
+            return path
+    return ctypes.util.find_library("sp") or name
+
+
+def _load():
+    lib = ctypes.CDLL(_find_library())
+    lib.sp_api_version.restype = ctypes.c_int
+    # before binding anything, so an older library fails here rather than on a missing symbol
+    if lib.sp_api_version() != _API_VERSION:
+        raise RuntimeError("libsp API version %d, expected %d" % (lib.sp_api_version(), _API_VERSION))
+    lib.sp_pipeline_create.argtypes = [ctypes.c_int, ctypes.c_double]
+    lib.sp_pipeline_create.restype = ctypes.c_void_p
+    lib.sp_pipeline_free.argtypes = [ctypes.c_void_p]
+    lib.sp_pipeline_clear.argtypes = [ctypes.c_void_p]
+    lib.sp_pipeline_push_bars.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int32)] + [_double_p] * 5 + [ctypes.c_size_t]
+    lib.sp_pipeline_run.argtypes = [ctypes.c_void_p]
+    lib.sp_pipeline_features.argtypes = [ctypes.c_void_p, _size_p, _size_p]
+    lib.sp_pipeline_features.restype = _double_p
+    for fn in (lib.sp_pipeline_targets, lib.sp_pipeline_predictions, lib.sp_pipeline_coefficients):
+        fn.argtypes = [ctypes.c_void_p, _size_p]
+        fn.restype = _double_p
+    lib.sp_pipeline_feature_name.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+    lib.sp_pipeline_feature_name.restype = ctypes.c_char_p
+    lib.sp_pipeline_metrics.argtypes = [ctypes.c_void_p, ctypes.POINTER(Metrics)]
+    lib.sp_pipeline_error.argtypes = [ctypes.c_void_p]
+    lib.sp_pipeline_error.restype = ctypes.c_char_p
+    lib.sp_pipeline_range_query.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32, ctypes.POINTER(RangeStats)]
+    lib.sp_range_index_open.argtypes = [ctypes.c_char_p]
+    lib.sp_range_index_open.restype = ctypes.c_void_p
+    lib.sp_range_index_free.argtypes = [ctypes.c_void_p]
+    lib.sp_range_index_query.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32, ctypes.POINTER(RangeStats)]
+    return lib
+
+
+_lib = None
+
+
+def library():
+    global _lib
+    if _lib is None:
+        _lib = _load()
+    return _lib
+
+
+def _column(values, dtype):
+    return np.ascontiguousarray(values, dtype=dtype)
+
+
+def _view(ptr, shape):
+    if not ptr or 0 in shape:
+        return np.empty(shape, dtype=np.float64)
+    return np.ctypeslib.as_array(ptr, shape=shape)
+
+
+class Pipeline:
+    def __init__(self, prediction_days=1, train_ratio=0.8):
+        self._lib = library()
+        self._p = self._lib.sp_pipeline_create(prediction_days, train_ratio)
+        if not self._p:
+            raise ValueError("invalid prediction_days or train_ratio")
+
+    def close(self):
+        if self._p:
+            self._lib.sp_pipeline_free(self._p)
+            self._p = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def _check(self, code):
+        if code != _SP_OK:
+            raise RuntimeError(self._lib.sp_pipeline_error(self._p).decode())
+
+    def push_bars(self, dates, open_, high, low, close, volume=None):
+        """dates as yyyymmdd integers (or numpy datetime64[D]), increasing."""
+        dates = np.asarray(dates)
+        if np.issubdtype(dates.dtype, np.datetime64):
+            ymd = dates.astype("datetime64[D]").astype(str)
+            dates = np.char.replace(ymd, "-", "").astype(np.int64)
+        cols = [_column(c, np.float64) for c in (open_, high, low, close)]
+        vol = _column(volume, np.float64) if volume is not None else None
+        d = _column(dates, np.int32)
+        n = len(d)
+        if any(len(c) != n for c in cols) or (vol is not None and len(vol) != n):
+            raise ValueError("all columns must have the same length")
+        ptrs = [c.ctypes.data_as(_double_p) for c in cols]
+        vptr = vol.ctypes.data_as(_double_p) if vol is not None else None
+        self._check(self._lib.sp_pipeline_push_bars(
+            self._p, d.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)), *ptrs, vptr, n))
+
+    def clear(self):
+        self._lib.sp_pipeline_clear(self._p)
+
+    def run(self):
+        self._check(self._lib.sp_pipeline_run(self._p))
+
+    def features(self):
+        rows, cols = ctypes.c_size_t(), ctypes.c_size_t()
+        ptr = self._lib.sp_pipeline_features(self._p, ctypes.byref(rows), ctypes.byref(cols))
+        return _view(ptr, (rows.value, cols.value))
+
+    def _vector(self, fn):
+        n = ctypes.c_size_t()
+        ptr = fn(self._p, ctypes.byref(n))
+        return _view(ptr, (n.value,))
+
+    def targets(self):
+        return self._vector(self._lib.sp_pipeline_targets)
+
+    def predictions(self):
+        return self._vector(self._lib.sp_pipeline_predictions)
+
+    def coefficients(self):
+        return self._vector(self._lib.sp_pipeline_coefficients)
+
+    def feature_names(self):
+        names = []
+        while True:
+            name = self._lib.sp_pipeline_feature_name(self._p, len(names))
+            if name is None:
+                return names
+            names.append(name.decode())
+
+    def metrics(self):
+        m = Metrics()
+        self._check(self._lib.sp_pipeline_metrics(self._p, ctypes.byref(m)))
+        return {name: getattr(m, name) for name, _ in Metrics._fields_}
+
+    def range_query(self, start_date, end_date):
+        """open/high/low/close/volume/vwap of the pushed bars dated [start, end], yyyymmdd."""
+        s = RangeStats()
+        self._check(self._lib.sp_pipeline_range_query(self._p, start_date, end_date, ctypes.byref(s)))
+        return s.as_dict()
+
+
+class RangeIndex:
+    """Constant-time range aggregates over a .spb bar cache or any bar file."""
+
+    def __init__(self, path):
+        self._lib = library()
+        self._idx = self._lib.sp_range_index_open(os.fsencode(path))
+        if not self._idx:
+            raise RuntimeError("cannot build a range index for %s" % path)
+
+    def close(self):
+        if self._idx:
+            self._lib.sp_range_index_free(self._idx)
+            self._idx = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def query(self, start_date, end_date):
+        s = RangeStats()
+        if self._lib.sp_range_index_query(self._idx, start_date, end_date, ctypes.byref(s)) != _SP_OK:
+            raise RuntimeError("range index is closed")
+        return s.as_dict()
+
+
+def run_csv(path, prediction_days=1, train_ratio=0.8):
+    """Loads a Date,Open,High,Low,Close,Volume csv and runs it; returns the pipeline."""
+    import pandas as pd
+    df = pd.read_csv(path)
+    dates = df["Date"].str.replace("-", "").astype(np.int32).to_numpy()
+    p = Pipeline(prediction_days, train_ratio)
+    p.push_bars(dates, df["Open"], df["High"], df["Low"], df["Close"], df["Volume"])
+    p.run()
+    return p
@@ -0,0 +1,164 @@
+// corporate action tables and the adjusted view; segment factors are built newest first,
+// each action scaling every row before its ex-date
+
+#include "adjustments.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+double Bar::*field_of(BarColumn column) {
+    switch (column) {
+        case kOpen: return &Bar::open;
+        case kHigh: return &Bar::high;
+        case kLow: return &Bar::low;
+        case kClose: return &Bar::close;
+        case kVolume: return &Bar::volume;
+        default: throw invalid_argument("column takes a single bar column");
+    }
+}
+
+} // namespace
+
+AdjustmentTable AdjustmentTable::load(const string& path) {
+    AdjustmentTable table;
+    ifstream in(path);
+    if (!in) return table;
+    string line;
+    if (!getline(in, line)) return table;
+    if (line.find("Date") == string::npos) throw runtime_error("adjustment table header must contain 'Date': " + path);
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        CorporateAction a;
+        try {
+            size_t c1 = line.find(',');
+            a.date = date_to_key(line.substr(0, c1));
+            if (c1 != string::npos) {
+                size_t c2 = line.find(',', c1 + 1);
+                string split = line.substr(c1 + 1, c2 == string::npos ? string::npos : c2 - c1 - 1);
+                if (!split.empty()) a.split = stod(split);
+                if (c2 != string::npos && c2 + 1 < line.size()) a.dividend = stod(line.substr(c2 + 1));
+            }
+            table.add(a);
+        } catch (const logic_error&) {
+            throw runtime_error("invalid adjustment line in " + path + ": " + line);
+        }
+    }
+    return table;
+}
+
+void AdjustmentTable::save(const string& path) const {
+    ofstream out(path);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+    out << "Date,Split,Dividend\n" << setprecision(12);
+    for (const auto& a : actions_) out << key_to_date(a.date) << ',' << a.split << ',' << a.dividend << '\n';
+}
+
+void AdjustmentTable::append(const string& path, const CorporateAction& action) {
+    bool fresh = !ifstream(path).good();
+    ofstream out(path, ios::app);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+    if (fresh) out << "Date,Split,Dividend\n";
+    out << setprecision(12) << key_to_date(action.date) << ',' << action.split << ',' << action.dividend << '\n';
+}
+
+void AdjustmentTable::add(const CorporateAction& action) {
+    if (!(action.split > 0.0) || !(action.dividend >= 0.0)) {
+        throw invalid_argument("split must be positive and dividend non-negative");
+    }
+    if (actions_.empty() || actions_.back().date < action.date) {
+        actions_.push_back(action);
+        return;
+    }
+    auto it = lower_bound(actions_.begin(), actions_.end(), action.date,
+                          [](const CorporateAction& a, int32_t date) { return a.date < date; });
+    if (it != actions_.end() && it->date == action.date) {
+        it->split *= action.split;
+        it->dividend += action.dividend;
+    } else {
+        actions_.insert(it, action);
+    }
+}
+
+AdjustedView::AdjustedView(const vector<Bar>& raw, const AdjustmentTable& table) : raw_(&raw) {
+    size_t end = raw.size();
+    double price = 1.0, volume = 1.0;
+    const auto& actions = table.actions();
+    for (auto a = actions.rbegin(); a != actions.rend() && end > 0; ++a) {
+        // first row on or after the ex-date
+        size_t b = size_t(partition_point(raw.begin(), raw.begin() + end, [&](const Bar& bar) {
+                       return date_to_key(bar.date) < a->date;
+                   }) - raw.begin());
+        if (b < end) segments_.push_back({b, end, price, volume});
+        end = b;
+        if (b == 0) break;
+        double f = 1.0 / a->split;
+        double close = raw[b - 1].close;
+        if (a->dividend > 0.0 && close > a->dividend) f *= 1.0 - a->dividend / close;
+        price *= f;
+        volume *= a->split;
+    }
+    if (end > 0) segments_.push_back({0, end, price, volume});
+    reverse(segments_.begin(), segments_.end());
+}
+
+const AdjustmentSegment& AdjustedView::segment_of(size_t i) const {
+    auto it = upper_bound(segments_.begin(), segments_.end(), i,
+                          [](size_t row, const AdjustmentSegment& s) { return row < s.begin; });
+    return *(it - 1);
+}
+
+Bar AdjustedView::bar(size_t i) const {
+    if (i >= size()) throw out_of_range("bar index past end of view");
+    const AdjustmentSegment& s = segment_of(i);
+    Bar b = (*raw_)[i];
+    b.open *= s.price;
+    b.high *= s.price;
+    b.low *= s.price;
+    b.close *= s.price;
+    b.volume *= s.volume;
+    return b;
+}
+
+void AdjustedView::column(BarColumn column, size_t first, size_t count, double* out) const {
+    if (first + count > size()) throw out_of_range("column range past end of view");
+    double Bar::*field = field_of(column);
+    if (count == 0) return;
+    const Bar* raw = raw_->data();
+    size_t end = first + count;
+    auto seg = segments_.begin() + (&segment_of(first) - segments_.data());
+    for (; seg != segments_.end() && seg->begin < end; ++seg) {
+        size_t lo = max(first, seg->begin), hi = min(end, seg->end);
+        double f = column == kVolume ? seg->volume : seg->price;
+        double* o = out + (lo - first);
+        for (size_t i = lo; i < hi; ++i) *o++ = raw[i].*field * f;
+    }
+}
+
+vector<double> AdjustedView::column(BarColumn column) const {
+    vector<double> out(size());
+    this->column(column, 0, size(), out.data());
+    return out;
+}
+
+vector<Bar> AdjustedView::to_bars() const {
+    vector<Bar> out(*raw_);
+    for (const auto& s : segments_) {
+        for (size_t i = s.begin; i < s.end; ++i) {
+            out[i].open *= s.price;
+            out[i].high *= s.price;
+            out[i].low *= s.price;
+            out[i].close *= s.price;
+            out[i].volume *= s.volume;
+        }
+    }
+    return out;
+}
+
+} // namespace sp
@@ -0,0 +1,78 @@
+// split and dividend adjustment as a view over raw bars: a per-symbol table of corporate
+// actions, and a reader that scales raw columns by a piecewise-constant factor, so a new
+// action is a table entry rather than a rewrite of the bar file
+
+#pragma once
+#include "csv_loader.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+struct CorporateAction {
+    int32_t date = 0;       // ex-date, yyyymmdd; bars before it are adjusted
+    double split = 1.0;     // new shares per old share, 2 for a 2-for-1 split
+    double dividend = 0.0;  // cash per share, in the prices of the bar before the ex-date
+};
+
+// actions in date order; actions on the same date are combined (splits multiply,
+// dividends add)
+class AdjustmentTable {
+public:
+    // csv with a Date,Split,Dividend header; a missing file is an empty table.
+    // throws runtime_error on a malformed line
+    static AdjustmentTable load(const std::string& path);
+    void save(const std::string& path) const;
+    // adds one line to a table file without rewriting it, creating the file if needed
+    static void append(const std::string& path, const CorporateAction& action);
+
+    // O(1) unless the action is older than the newest one already held
+    void add(const CorporateAction& action);
+
+    const std::vector<CorporateAction>& actions() const { return actions_; }
+    bool empty() const { return actions_.empty(); }
+
+private:
+    std::vector<CorporateAction> actions_;
+};
+
+// rows [begin, end) of the raw bars share one factor
+struct AdjustmentSegment {
+    size_t begin = 0;
+    size_t end = 0;
+    double price = 1.0;   // multiplies open, high, low, close
+    double volume = 1.0;  // multiplies volume
+};
+
+// backward adjusted: the newest bars read as they are, older ones are scaled so that
+// returns across an ex-date are continuous. a dividend scales earlier prices by
+// 1 - dividend / close before the ex-date. the raw bars must be in date order and
+// outlive the view; building it costs O(actions * log bars), reads cost a multiply
+class AdjustedView {
+public:
+    AdjustedView(const std::vector<Bar>& raw, const AdjustmentTable& table);
+
+    size_t size() const { return raw_->size(); }
+    const std::vector<Bar>& raw() const { return *raw_; }
+    const std::vector<AdjustmentSegment>& segments() const { return segments_; }
+
+    Bar bar(size_t i) const;
+
+    // adjusted rows [first, first + count) of one column (kOpen .. kVolume) into out,
+    // one tight multiply loop per segment
+    void column(BarColumn column, size_t first, size_t count, double* out) const;
+    std::vector<double> column(BarColumn column) const;
+
+    // a full adjusted copy, for code that needs plain bars
+    std::vector<Bar> to_bars() const;
+
+private:
+    const std::vector<Bar>* raw_;
+    std::vector<AdjustmentSegment> segments_;
+
+    const AdjustmentSegment& segment_of(size_t i) const;
+};
+
+} // namespace sp
@@ -0,0 +1,219 @@
+// coroutine loader: a fixed pool of load coroutines walks the path list; each one
+// hands its read to the FileReader, suspends, and is resumed on a worker to parse.
+// built as c++20 (sp_async), the header stays c++17
+
+#include "async_loader.h"
+#include "file_reader.h"
+#include "parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+// fifo of jobs drained by a fixed set of threads; the destructor finishes what is queued
+class WorkQueue {
+public:
+    explicit WorkQueue(unsigned threads, const function<void()>& init = {}) {
+        for (unsigned t = 0; t < max(1u, threads); ++t) {
+            threads_.emplace_back([this, init] {
+                if (init) init();
+                run();
+            });
+        }
+    }
+
+    ~WorkQueue() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    void post(function<void()> job) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            jobs_.push_back(move(job));
+        }
+        ready_.notify_one();
+    }
+
+    void post(coroutine_handle<> h) {
+        post([h] { h.resume(); });
+    }
+
+private:
+    void run() {
+        for (;;) {
+            function<void()> job;
+            {
+                unique_lock<mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty()) return;
+                job = move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    mutex mutex_;
+    condition_variable ready_;
+    deque<function<void()>> jobs_;
+    bool stop_ = false;
+    vector<thread> threads_;
+};
+
+// fire and forget coroutine, starts eagerly and frees its frame when it returns
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+bool is_binary(const string& path) {
+    auto has_ext = [&](const char* ext) {
+        return path.size() > 4 && path.compare(path.size() - 4, 4, ext) == 0;
+    };
+    return has_ext(".spb") || has_ext(".spa");
+}
+
+struct Context {
+    const vector<string>& paths;
+    const function<void(size_t, LoadedSeries&)>& on_loaded;
+    const AsyncLoadOptions& options;
+
+    atomic<size_t> next{0};
+    size_t active = 0;
+    exception_ptr failure;
+    mutex mutex_;
+    condition_variable done;
+
+    // declared last: destroyed (and joined) before the state above goes away
+    WorkQueue workers;
+    FileReader io;
+
+    Context(const vector<string>& p, const function<void(size_t, LoadedSeries&)>& f,
+            const AsyncLoadOptions& o)
+        : paths(p), on_loaded(f), options(o),
+          workers(o.workers ? o.workers : default_threads(), o.thread_init), io(reader_options(o)) {}
+
+    static FileReaderOptions reader_options(const AsyncLoadOptions& o) {
+        FileReaderOptions r;
+        r.queue_depth = static_cast<unsigned>(min<size_t>(max<size_t>(1, o.in_flight), 4096));
+        r.use_uring = o.use_uring;
+        r.fallback_threads = o.io_threads;
+        r.thread_init = o.thread_init;
+        return r;
+    }
+};
+
+// suspends the caller and resumes it on the worker pool
+struct Schedule {
+    WorkQueue& queue;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(coroutine_handle<> h) { queue.post(h); }
+    void await_resume() const noexcept {}
+};
+
+// suspends while the reader fetches the file, resumes on the worker pool with the bytes
+// still borrowed from the reader (often its registered buffer); release once parsed
+struct ReadFile {
+    Context& ctx;
+    const string& path;
+    const char* data = nullptr;
+    size_t len = 0;
+    string error;
+    function<void()> release;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(coroutine_handle<> h) {
+        ctx.io.submit_borrowed(path, [this, h](const char* bytes, size_t n, const string& err,
+                                               function<void()> done) {
+            data = bytes;
+            len = n;
+            error = err;
+            release = move(done);
+            ctx.workers.post(h);
+        });
+    }
+    void await_resume() const noexcept {}
+    ~ReadFile() {
+        if (release) release();
+    }
+};
+
+Detached load_loop(Context& ctx) {
+    co_await Schedule{ctx.workers};
+    for (size_t i = ctx.next++; i < ctx.paths.size(); i = ctx.next++) {
+        LoadedSeries series;
+        series.path = ctx.paths[i];
+        try {
+            if (is_binary(series.path)) {
+                // already mapped column files, nothing to overlap
+                series.bars = CSVLoader(series.path).load(ctx.options.load);
+            } else {
+                ReadFile read{ctx, series.path};
+                co_await read;
+                if (read.error.empty()) {
+                    series.bars = CSVLoader::parse(read.data, read.len, ctx.options.load);
+                } else {
+                    series.error = read.error;
+                }
+            }
+        } catch (const exception& e) {
+            series.error = e.what();
+        }
+        try {
+            ctx.on_loaded(i, series);
+        } catch (...) {
+            lock_guard<mutex> lock(ctx.mutex_);
+            if (!ctx.failure) ctx.failure = current_exception();
+            ctx.next = ctx.paths.size();
+        }
+    }
+    lock_guard<mutex> lock(ctx.mutex_);
+    if (--ctx.active == 0) ctx.done.notify_all();
+}
+
+} // namespace
+
+void load_many_async(const vector<string>& paths,
+                     const function<void(size_t, LoadedSeries&)>& on_loaded,
+                     const AsyncLoadOptions& options) {
+    if (paths.empty()) return;
+    Context ctx(paths, on_loaded, options);
+    size_t loops = min(max<size_t>(1, options.in_flight), paths.size());
+    {
+        lock_guard<mutex> lock(ctx.mutex_);
+        ctx.active = loops;
+    }
+    for (size_t i = 0; i < loops; ++i) load_loop(ctx);
+    {
+        unique_lock<mutex> lock(ctx.mutex_);
+        ctx.done.wait(lock, [&] { return ctx.active == 0; });
+    }
+    if (ctx.failure) rethrow_exception(ctx.failure);
+}
+
+vector<LoadedSeries> load_many_async(const vector<string>& paths, const AsyncLoadOptions& options) {
+    vector<LoadedSeries> out(paths.size());
+    load_many_async(paths, [&](size_t i, LoadedSeries& s) { out[i] = move(s); }, options);
+    return out;
+}
+
+} // namespace sp
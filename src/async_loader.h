@@ -0,0 +1,40 @@
+// loads many bar files at once: each load is a coroutine awaiting its read
+
+#pragma once
+#include "csv_loader.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+struct AsyncLoadOptions {
+    LoadOptions load;
+    unsigned workers = 0;     // threads resuming coroutines and parsing, 0 = default_threads()
+    unsigned io_threads = 2;  // pread threads, only when io_uring is unavailable
+    size_t in_flight = 64;    // loads alive at once, also the io_uring queue depth
+    bool use_uring = true;
+    std::function<void()> thread_init;  // runs first on every worker and reader thread
+};
+
+struct LoadedSeries {
+    std::string path;
+    std::vector<Bar> bars;
+    std::string error;  // set instead of throwing, so one bad file doesn't stop the rest
+};
+
+// calls on_loaded(index into paths, series) on a worker thread as each file is parsed,
+// so downstream work overlaps the remaining reads. reads go through FileReader
+// (file_reader.h): one io_uring thread on linux, io_threads pread threads otherwise,
+// however many files there are. an exception thrown by on_loaded
+// is rethrown here once the loads in flight have finished
+void load_many_async(const std::vector<std::string>& paths,
+                     const std::function<void(size_t, LoadedSeries&)>& on_loaded,
+                     const AsyncLoadOptions& options = {});
+
+// same, collecting the series in the order of paths
+std::vector<LoadedSeries> load_many_async(const std::vector<std::string>& paths,
+                                          const AsyncLoadOptions& options = {});
+
+} // namespace sp
@@ -0,0 +1,150 @@
+// AR(p) fit through autocovariances and levinson-durbin, O(n*p + p^2)
+
+#include "autoregressive.h"
+#include "spectral.h"
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+// one pass over the centered data, keeping the last max_lag values in a ring
+vector<double> autocovariance(const vector<double>& x, int max_lag) {
+    size_t n = x.size();
+    if (n == 0 || max_lag < 0) return {};
+    size_t p = min(static_cast<size_t>(max_lag), n - 1);
+    double mu = accumulate(x.begin(), x.end(), 0.0) / n;
+
+    vector<double> r(p + 1, 0.0);
+    vector<double> ring(p + 1, 0.0);
+    for (size_t t = 0; t < n; ++t) {
+        double d = x[t] - mu;
+        ring[t % (p + 1)] = d;
+        size_t lags = min(t, p);
+        for (size_t k = 0; k <= lags; ++k) {
+            r[k] += d * ring[(t - k) % (p + 1)];
+        }
+    }
+    for (double& v : r) v /= n;
+    r.resize(max_lag + 1, 0.0);
+    return r;
+}
+
+ARModel::ARModel(int max_order, OrderCriterion criterion)
+    : max_order_(max_order), criterion_(criterion) {}
+
+bool ARModel::train(const vector<double>& series) {
+    trained_ = false;
+    has_exog_ = false;
+    size_t n = series.size();
+    if (max_order_ < 0 || n <= static_cast<size_t>(max_order_) + 1) {
+        return false;
+    }
+    int p = max_order_;
+    // the direct pass costs O(n*p), past a few dozen lags the FFT is cheaper
+    auto r = p > 64 ? autocovariance_fft(series, p) : autocovariance(series, p);
+    if (!(r[0] > 0.0)) return false;
+
+    mean_ = accumulate(series.begin(), series.end(), 0.0) / n;
+
+    // levinson-durbin: walks orders 1..p, each step O(m), and scores every order
+    aic_.assign(p + 1, NAN);
+    bic_.assign(p + 1, NAN);
+    double ln_n = log(static_cast<double>(n));
+    auto score = [&](int m, double err) {
+        double ll = n * log(max(err, 1e-300));
+        aic_[m] = ll + 2.0 * m;
+        bic_[m] = ll + m * ln_n;
+    };
+
+    vector<double> a, prev;
+    double err = r[0];
+    score(0, err);
+
+    int best = 0;
+    double best_score = criterion_ == OrderCriterion::BIC ? bic_[0] : aic_[0];
+    vector<double> best_phi;
+    double best_err = err;
+
+    for (int m = 1; m <= p; ++m) {
+        double acc = r[m];
+        for (int j = 1; j < m; ++j) acc -= a[j - 1] * r[m - j];
+        double k = acc / err;
+
+        prev = a;
+        a.resize(m);
+        a[m - 1] = k;
+        for (int j = 1; j < m; ++j) a[j - 1] = prev[j - 1] - k * prev[m - j - 1];
+
+        err *= (1.0 - k * k);
+        if (!(err > 0.0)) err = 0.0;
+        score(m, err);
+
+        double s = criterion_ == OrderCriterion::BIC ? bic_[m] : aic_[m];
+        if (criterion_ == OrderCriterion::None || s < best_score) {
+            best = m;
+            best_score = s;
+            best_phi = a;
+            best_err = err;
+        }
+        if (err == 0.0) break;
+    }
+
+    order_ = best;
+    phi_ = best_phi;
+    sigma2_ = best_err;
+    trained_ = true;
+    return true;
+}
+
+bool ARModel::train(const vector<double>& series, const vector<vector<double>>& exog) {
+    if (exog.size() != series.size()) return false;
+    if (!train(series)) return false;
+
+    // residuals of the AR part, regressed on the exogenous inputs
+    vector<vector<double>> X;
+    vector<double> resid;
+    for (size_t t = order_; t < series.size(); ++t) {
+        double pred = mean_;
+        for (int j = 0; j < order_; ++j) pred += phi_[j] * (series[t - j - 1] - mean_);
+        X.push_back(exog[t]);
+        resid.push_back(series[t] - pred);
+    }
+    if (!exog_.train(X, resid)) {
+        trained_ = false;
+        return false;
+    }
+    has_exog_ = true;
+    return true;
+}
+
+double ARModel::ar_part(const vector<double>& history) const {
+    if (!trained_) {
+        throw runtime_error("Model not trained");
+    }
+    if (history.size() < static_cast<size_t>(order_)) {
+        throw invalid_argument("History shorter than AR order");
+    }
+    double pred = mean_;
+    size_t last = history.size() - 1;
+    for (int j = 0; j < order_; ++j) {
+        pred += phi_[j] * (history[last - j] - mean_);
+    }
+    return pred;
+}
+
+double ARModel::predict(const vector<double>& history) const {
+    if (has_exog_) {
+        throw invalid_argument("ARX model needs exogenous inputs");
+    }
+    return ar_part(history);
+}
+
+double ARModel::predict(const vector<double>& history, const vector<double>& exog_next) const {
+    double pred = ar_part(history);
+    if (has_exog_) pred += exog_.predict(exog_next);
+    return pred;
+}
+
+} // namespace sp
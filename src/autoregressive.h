@@ -0,0 +1,61 @@
+// autoregressive AR(p) / ARX model fitted with levinson-durbin recursion
+
+#pragma once
+#include "linear_regression.h"
+#include <vector>
+
+namespace sp {
+
+// which information criterion picks the AR order
+enum class OrderCriterion { AIC, BIC, None };
+
+// sample autocovariance r[0..max_lag] (divided by n), data centered on its mean
+std::vector<double> autocovariance(const std::vector<double>& x, int max_lag);
+
+class ARModel {
+public:
+    // max_order is the highest lag tried; with OrderCriterion::None it is used as-is
+    explicit ARModel(int max_order, OrderCriterion criterion = OrderCriterion::AIC);
+
+    // fits x_t - mu = sum phi_j (x_{t-j} - mu) + e_t
+    bool train(const std::vector<double>& series);
+
+    // ARX: AR part as above, then exogenous weights fitted on the AR residuals.
+    // exog[t] holds the regressors known at time t
+    bool train(const std::vector<double>& series,
+               const std::vector<std::vector<double>>& exog);
+
+    // one step ahead forecast from the most recent values (oldest first)
+    double predict(const std::vector<double>& history) const;
+    double predict(const std::vector<double>& history,
+                   const std::vector<double>& exog_next) const;
+
+    int order() const { return order_; }
+    double mean() const { return mean_; }
+    double noise_variance() const { return sigma2_; }
+    const std::vector<double>& coefficients() const { return phi_; }
+    const std::vector<double>& exog_coefficients() const { return exog_.coefficients(); }
+
+    // criterion values for every order 0..max_order from the last fit
+    const std::vector<double>& aic() const { return aic_; }
+    const std::vector<double>& bic() const { return bic_; }
+
+    bool is_trained() const { return trained_; }
+
+private:
+    int max_order_;
+    OrderCriterion criterion_;
+
+    int order_ = 0;
+    double mean_ = 0.0;
+    double sigma2_ = 0.0;
+    std::vector<double> phi_;
+    std::vector<double> aic_, bic_;
+    LinearRegression exog_;
+    bool has_exog_ = false;
+    bool trained_ = false;
+
+    double ar_part(const std::vector<double>& history) const;
+};
+
+} // namespace sp
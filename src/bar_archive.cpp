@@ -0,0 +1,300 @@
+// .spa layout: 64 byte header, column blobs block after block, then a block index
+// (first/last date, rows, offset and size of each of the 6 column blobs)
+
+#include "bar_archive.h"
+#include "mapped_file.h"
+#include "simd.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const char kMagic[8] = {'S', 'P', 'A', 'R', 'C', 'H', '1', '\0'};
+const int kColumns = 6;  // date, open, high, low, close, volume
+const uint8_t kDecimal = 0;
+const uint8_t kXor = 1;
+const int kMaxWidth = 56;  // one unaligned 64-bit load always covers a packed value
+
+struct ArchiveHeader {
+    char magic[8];
+    uint64_t rows;
+    uint32_t block_rows;
+    uint32_t n_blocks;
+    uint64_t index_offset;
+    char pad[32];
+};
+static_assert(sizeof(ArchiveHeader) == 64, "archive header must stay 64 bytes");
+
+struct BlockEntry {
+    int32_t first_date;
+    int32_t last_date;
+    uint32_t rows;
+    uint32_t reserved;
+    uint64_t offset[kColumns];
+    uint64_t size[kColumns];
+};
+
+const double kPow10[] = {1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0};
+
+template <class T>
+void put(vector<uint8_t>& out, const T& v) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <class T>
+T get(const uint8_t* p) {
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+int bit_width(uint64_t v) {
+    int w = 0;
+    while (v) {
+        ++w;
+        v >>= 1;
+    }
+    return w;
+}
+
+// delta + frame of reference: [mode][exp][width][5 pad][first][min delta][bits...]
+bool encode_ints(const int64_t* q, size_t n, uint8_t exponent, vector<uint8_t>& out) {
+    int64_t lo = 0, hi = 0;
+    for (size_t i = 1; i < n; ++i) {
+        int64_t d = q[i] - q[i - 1];
+        if (i == 1 || d < lo) lo = d;
+        if (i == 1 || d > hi) hi = d;
+    }
+    int w = bit_width(static_cast<uint64_t>(hi - lo));
+    if (w > kMaxWidth) return false;
+
+    out.push_back(kDecimal);
+    out.push_back(exponent);
+    out.push_back(static_cast<uint8_t>(w));
+    out.insert(out.end(), 5, 0);
+    put(out, n ? q[0] : int64_t(0));
+    put(out, lo);
+
+    size_t start = out.size();
+    size_t bytes = (n > 1 ? ((n - 1) * w + 7) / 8 : 0) + 8;  // padded for the unaligned loads
+    out.resize(start + bytes, 0);
+    uint8_t* bits = out.data() + start;
+    for (size_t i = 1; i < n && w > 0; ++i) {
+        uint64_t v = static_cast<uint64_t>(q[i] - q[i - 1] - lo);
+        size_t bit = (i - 1) * w;
+        uint64_t word = get<uint64_t>(bits + bit / 8);
+        word |= v << (bit % 8);
+        memcpy(bits + bit / 8, &word, 8);
+    }
+    return true;
+}
+
+void encode_xor(const double* v, size_t n, vector<uint8_t>& out) {
+    out.push_back(kXor);
+    out.insert(out.end(), 7, 0);
+    uint64_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t bits;
+        memcpy(&bits, &v[i], 8);
+        uint64_t x = bits ^ prev;
+        prev = bits;
+        int lead = 0, trail = 0;
+        while (lead < 8 && ((x >> (56 - 8 * lead)) & 0xff) == 0) ++lead;
+        while (lead + trail < 8 && ((x >> (8 * trail)) & 0xff) == 0) ++trail;
+        out.push_back(static_cast<uint8_t>(lead << 4 | trail));
+        for (int b = trail; b < 8 - lead; ++b) out.push_back(static_cast<uint8_t>(x >> (8 * b)));
+    }
+}
+
+void encode_doubles(const double* v, size_t n, vector<uint8_t>& out) {
+    vector<int64_t> q(n);
+    for (uint8_t e = 0; e < 7; ++e) {
+        double scale = kPow10[e];
+        bool exact = true;
+        for (size_t i = 0; i < n && exact; ++i) {
+            double s = nearbyint(v[i] * scale);
+            exact = fabs(s) < 2e15 && s / scale == v[i];
+            if (exact) q[i] = static_cast<int64_t>(s);
+        }
+        if (exact && encode_ints(q.data(), n, e, out)) return;
+    }
+    encode_xor(v, n, out);
+}
+
+// decodes a decimal blob to its integers (before scaling)
+void decode_ints(const uint8_t* p, size_t n, vector<int64_t>& q) {
+    int w = p[2];
+    int64_t first = get<int64_t>(p + 8);
+    int64_t lo = get<int64_t>(p + 16);
+    const uint8_t* bits = p + 24;
+    q.resize(n);
+    if (n == 0) return;
+    q[0] = first;
+    uint64_t mask = w == 64 ? ~uint64_t(0) : (uint64_t(1) << w) - 1;
+    for (size_t i = 1; i < n; ++i) {
+        size_t bit = (i - 1) * w;
+        uint64_t word = get<uint64_t>(bits + bit / 8);
+        q[i] = static_cast<int64_t>((word >> (bit % 8)) & mask) + lo;
+    }
+    simd::prefix_sum_i64(q.data(), n, 0);
+}
+
+// false when an xor blob runs past its size
+bool decode_doubles(const uint8_t* p, uint64_t size, size_t n, vector<int64_t>& scratch, vector<double>& out) {
+    out.resize(n);
+    if (p[0] == kDecimal) {
+        decode_ints(p, n, scratch);
+        simd::i64_div_to_f64(scratch.data(), n, kPow10[p[1]], out.data());
+        return true;
+    }
+    const uint8_t* q = p + 8;
+    const uint8_t* end = p + size;
+    uint64_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t ctl = *q++;
+        int lead = ctl >> 4, trail = ctl & 0x0f;
+        if (q + max(0, 8 - lead - trail) > end) return false;
+        uint64_t x = 0;
+        for (int b = trail; b < 8 - lead; ++b) x |= static_cast<uint64_t>(*q++) << (8 * b);
+        prev ^= x;
+        memcpy(&out[i], &prev, 8);
+        if (i + 1 < n && q >= end) return false;
+    }
+    return true;
+}
+
+// a blob must lie inside the file and be long enough for its rows; xor blobs vary in
+// length and are checked as they are decoded. dates are always decimal
+bool blob_fits(const uint8_t* base, uint64_t file_size, uint64_t offset, uint64_t size, size_t rows, bool dates) {
+    if (offset < sizeof(ArchiveHeader) || offset > file_size || size > file_size - offset || size < 8) return false;
+    const uint8_t* p = base + offset;
+    if (p[0] == kDecimal) {
+        if (size < 24 || p[1] > 6 || p[2] > kMaxWidth) return false;
+        uint64_t bits = rows > 1 ? ((rows - 1) * uint64_t(p[2]) + 7) / 8 : 0;
+        return bits + 8 <= size - 24;  // plus the padding for the unaligned loads
+    }
+    return !dates && p[0] == kXor && size - 8 >= rows;
+}
+
+} // namespace
+
+void BarArchive::write(const string& path, const vector<Bar>& bars, uint32_t block_rows) {
+    if (block_rows == 0) throw invalid_argument("block size must be positive");
+    size_t n = bars.size();
+    vector<int64_t> dates(n);
+    for (size_t i = 0; i < n; ++i) {
+        dates[i] = date_to_key(bars[i].date);
+        if (i > 0 && dates[i] <= dates[i - 1]) {
+            throw invalid_argument("bars must be sorted by unique date: " + bars[i].date);
+        }
+    }
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+    ArchiveHeader h{};
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.rows = n;
+    h.block_rows = block_rows;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    vector<BlockEntry> index;
+    uint64_t offset = sizeof(ArchiveHeader);
+    vector<uint8_t> blob;
+    vector<double> col;
+    double Bar::*fields[5] = {&Bar::open, &Bar::high, &Bar::low, &Bar::close, &Bar::volume};
+
+    for (size_t b0 = 0; b0 < n; b0 += block_rows) {
+        size_t rows = min<size_t>(block_rows, n - b0);
+        BlockEntry e{};
+        e.first_date = static_cast<int32_t>(dates[b0]);
+        e.last_date = static_cast<int32_t>(dates[b0 + rows - 1]);
+        e.rows = static_cast<uint32_t>(rows);
+        for (int c = 0; c < kColumns; ++c) {
+            blob.clear();
+            if (c == 0) {
+                encode_ints(&dates[b0], rows, 0, blob);
+            } else {
+                col.resize(rows);
+                for (size_t i = 0; i < rows; ++i) col[i] = bars[b0 + i].*fields[c - 1];
+                encode_doubles(col.data(), rows, blob);
+            }
+            e.offset[c] = offset;
+            e.size[c] = blob.size();
+            out.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+            offset += blob.size();
+        }
+        index.push_back(e);
+    }
+
+    h.n_blocks = static_cast<uint32_t>(index.size());
+    h.index_offset = offset;
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(BlockEntry));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    if (!out) throw runtime_error("failed to write the file: " + path);
+}
+
+vector<Bar> BarArchive::read(const string& path, const LoadOptions& options) {
+    MappedFile file(path);
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(file.data());
+    if (file.size() < sizeof(ArchiveHeader)) throw runtime_error("not a bar archive: " + path);
+    ArchiveHeader h = get<ArchiveHeader>(base);
+    if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.index_offset > file.size()
+        || uint64_t(h.n_blocks) * sizeof(BlockEntry) > file.size() - h.index_offset) {
+        throw runtime_error("not a bar archive: " + path);
+    }
+    vector<BlockEntry> index(h.n_blocks);
+    memcpy(index.data(), base + h.index_offset, index.size() * sizeof(BlockEntry));
+    for (const auto& e : index) {
+        for (int c = 0; c < kColumns; ++c) {
+            if (!blob_fits(base, h.index_offset, e.offset[c], e.size[c], e.rows, c == 0)) {
+                throw runtime_error("corrupt block index in bar archive: " + path);
+            }
+        }
+    }
+
+    int32_t lo = options.start_date.empty() ? INT32_MIN : date_to_key(options.start_date);
+    int32_t hi = options.end_date.empty() ? INT32_MAX : date_to_key(options.end_date);
+
+    // first block whose last date reaches the range start
+    auto it = lower_bound(index.begin(), index.end(), lo,
+                          [](const BlockEntry& e, int32_t d) { return e.last_date < d; });
+
+    vector<Bar> bars;
+    vector<int64_t> keys, scratch;
+    vector<double> values;
+    double Bar::*fields[5] = {&Bar::open, &Bar::high, &Bar::low, &Bar::close, &Bar::volume};
+    for (; it != index.end() && it->first_date <= hi; ++it) {
+        size_t rows = it->rows;
+        decode_ints(base + it->offset[0], rows, keys);
+        size_t a = lower_bound(keys.begin(), keys.end(), static_cast<int64_t>(lo)) - keys.begin();
+        size_t b = upper_bound(keys.begin(), keys.end(), static_cast<int64_t>(hi)) - keys.begin();
+        if (a >= b) continue;
+
+        size_t out0 = bars.size();
+        bars.resize(out0 + (b - a));
+        for (size_t i = a; i < b; ++i) {
+            Bar& bar = bars[out0 + i - a];
+            bar.date = key_to_date(static_cast<int32_t>(keys[i]));
+            bar.open = bar.high = bar.low = bar.close = bar.volume = NAN;
+        }
+        for (int c = 0; c < 5; ++c) {
+            if (!(options.columns & (1u << c))) continue;
+            if (!decode_doubles(base + it->offset[c + 1], it->size[c + 1], rows, scratch, values)) {
+                throw runtime_error("corrupt column in bar archive: " + path);
+            }
+            for (size_t i = a; i < b; ++i) bars[out0 + i - a].*fields[c] = values[i];
+        }
+    }
+    return bars;
+}
+
+} // namespace sp
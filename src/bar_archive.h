@@ -0,0 +1,27 @@
+// compressed bar archive (.spa): per-column blocks, delta + frame-of-reference bit packing
+
+#pragma once
+#include "csv_loader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+class BarArchive {
+public:
+    static constexpr uint32_t kDefaultBlock = 65536;
+
+    // bars must be sorted by date. each block column is stored as
+    //  - decimal: values scaled by the smallest power of ten that round-trips them exactly,
+    //    delta encoded and bit packed against the minimum delta, or
+    //  - xor: each double's bits xor the previous, leading zero bytes dropped (gorilla style)
+    static void write(const std::string& path, const std::vector<Bar>& bars,
+                      uint32_t block_rows = kDefaultBlock);
+
+    // maps the archive and decodes only the blocks overlapping the date range,
+    // and only the selected columns
+    static std::vector<Bar> read(const std::string& path, const LoadOptions& options = {});
+};
+
+} // namespace sp
@@ -0,0 +1,232 @@
+// .spb layout: 64 byte header, sparse int32 date index, int32 date column, then
+// one contiguous double column per field (open, high, low, close, volume), then
+// optionally the range index tables (range_index.h)
+
+#include "bar_cache.h"
+#include "bar_normalize.h"
+#include "range_index.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const char kMagic[8] = {'S', 'P', 'B', 'A', 'R', 'S', '1', '\0'};
+
+struct BarCacheHeader {
+    char magic[8];
+    uint64_t rows;
+    uint32_t stride;
+    uint32_t index_count;
+    uint64_t dates_offset;
+    uint64_t columns_offset;
+    uint64_t range_offset;  // 0: no range index stored
+    char pad[16];
+};
+static_assert(sizeof(BarCacheHeader) == 64, "bar cache header must stay 64 bytes");
+
+const char kRangeMagic[8] = {'S', 'P', 'R', 'N', 'G', '1', '\0', '\0'};
+
+// ahead of the prefix sums (rows + 1 each) and the block tables (levels * blocks each)
+struct RangeSectionHeader {
+    char magic[8];
+    uint64_t rows;
+    uint64_t blocks;
+    uint32_t levels;
+    uint32_t block;
+};
+static_assert(sizeof(RangeSectionHeader) == 32, "range section header must stay 32 bytes");
+
+uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+
+BarCacheHeader read_header(ifstream& in, const string& path) {
+    BarCacheHeader h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw runtime_error("not a bar cache file: " + path);
+    }
+    return h;
+}
+
+// exact [first, last) rows for the date range plus their date keys
+struct RowSpan {
+    uint64_t first = 0, last = 0, total = 0;
+    vector<int32_t> dates;
+};
+
+RowSpan locate(ifstream& in, const BarCacheHeader& h, const LoadOptions& options) {
+    int32_t lo = options.start_date.empty() ? INT32_MIN : date_to_key(options.start_date);
+    int32_t hi = options.end_date.empty() ? INT32_MAX : date_to_key(options.end_date);
+
+    vector<int32_t> index(h.index_count);
+    in.seekg(sizeof(BarCacheHeader));
+    in.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(int32_t));
+
+    // candidate block range from the sparse index, narrowed on the real dates below
+    uint64_t first_block = upper_bound(index.begin(), index.end(), lo) - index.begin();
+    first_block = first_block > 0 ? first_block - 1 : 0;
+    uint64_t last_block = upper_bound(index.begin(), index.end(), hi) - index.begin();
+    uint64_t cand_first = min<uint64_t>(first_block * h.stride, h.rows);
+    uint64_t cand_last = min<uint64_t>(last_block * h.stride, h.rows);
+
+    RowSpan span;
+    span.total = h.rows;
+    if (cand_last <= cand_first || lo > hi) return span;
+    vector<int32_t> dates(cand_last - cand_first);
+    in.seekg(h.dates_offset + cand_first * sizeof(int32_t));
+    in.read(reinterpret_cast<char*>(dates.data()), dates.size() * sizeof(int32_t));
+
+    auto b = lower_bound(dates.begin(), dates.end(), lo);
+    auto e = upper_bound(b, dates.end(), hi);
+    span.first = cand_first + (b - dates.begin());
+    span.last = cand_first + (e - dates.begin());
+    span.dates.assign(b, e);
+    return span;
+}
+
+} // namespace
+
+void BarCache::write(const string& path, const vector<Bar>& bars, uint32_t index_stride, bool range_index) {
+    if (index_stride == 0) throw invalid_argument("index stride must be positive");
+    vector<int32_t> dates(bars.size());
+    for (size_t i = 0; i < bars.size(); ++i) {
+        dates[i] = date_to_key(bars[i].date);
+        if (i > 0 && dates[i] <= dates[i - 1]) {
+            throw invalid_argument("bars must be sorted by unique date: " + bars[i].date);
+        }
+    }
+    vector<int32_t> index;
+    for (size_t i = 0; i < dates.size(); i += index_stride) index.push_back(dates[i]);
+
+    BarCacheHeader h{};
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.rows = bars.size();
+    h.stride = index_stride;
+    h.index_count = static_cast<uint32_t>(index.size());
+    h.dates_offset = align8(sizeof(BarCacheHeader) + index.size() * sizeof(int32_t));
+    h.columns_offset = align8(h.dates_offset + dates.size() * sizeof(int32_t));
+    h.range_offset = range_index ? h.columns_offset + 5 * bars.size() * sizeof(double) : 0;
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(int32_t));
+    out.seekp(h.dates_offset);
+    out.write(reinterpret_cast<const char*>(dates.data()), dates.size() * sizeof(int32_t));
+    out.seekp(h.columns_offset);
+
+    vector<double> col(bars.size());
+    double Bar::*fields[5] = {&Bar::open, &Bar::high, &Bar::low, &Bar::close, &Bar::volume};
+    for (auto field : fields) {
+        for (size_t i = 0; i < bars.size(); ++i) col[i] = bars[i].*field;
+        out.write(reinterpret_cast<const char*>(col.data()), col.size() * sizeof(double));
+    }
+    if (range_index) {
+        RangeIndex index = RangeIndex::build(bars);
+        RangeSectionHeader r{};
+        memcpy(r.magic, kRangeMagic, sizeof(kRangeMagic));
+        r.rows = bars.size();
+        r.blocks = index.blocks_;
+        r.levels = index.levels_;
+        r.block = RangeIndex::kBlock;
+        out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+        for (const auto* v : {&index.volume_sum_, &index.pv_sum_, &index.block_high_, &index.block_low_}) {
+            out.write(reinterpret_cast<const char*>(v->data()), v->size() * sizeof(double));
+        }
+    }
+    if (!out) throw runtime_error("failed to write the file: " + path);
+}
+
+vector<Bar> BarCache::read(const string& path, const LoadOptions& options) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("failed to open the file: " + path);
+    BarCacheHeader h = read_header(in, path);
+    RowSpan span = locate(in, h, options);
+
+    size_t n = span.last - span.first;
+    vector<Bar> bars(n);
+    for (size_t i = 0; i < n; ++i) {
+        bars[i].date = key_to_date(span.dates[i]);
+        bars[i].open = bars[i].high = bars[i].low = bars[i].close = bars[i].volume = NAN;
+    }
+
+    vector<double> col(n);
+    double Bar::*fields[5] = {&Bar::open, &Bar::high, &Bar::low, &Bar::close, &Bar::volume};
+    for (int c = 0; c < 5 && n > 0; ++c) {
+        if (!(options.columns & (1u << c))) continue;
+        in.seekg(h.columns_offset + (c * h.rows + span.first) * sizeof(double));
+        in.read(reinterpret_cast<char*>(col.data()), n * sizeof(double));
+        for (size_t i = 0; i < n; ++i) bars[i].*fields[c] = col[i];
+    }
+    if (!in) throw runtime_error("truncated bar cache file: " + path);
+    return bars;
+}
+
+RangeIndex BarCache::range_index(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("failed to open the file: " + path);
+    BarCacheHeader h = read_header(in, path);
+    size_t n = h.rows;
+
+    RangeIndex index;
+    vector<int32_t> dates(n);
+    in.seekg(h.dates_offset);
+    in.read(reinterpret_cast<char*>(dates.data()), n * sizeof(int32_t));
+    index.keys_.resize(n);
+    for (size_t i = 0; i < n; ++i) index.keys_[i] = day_time_key(dates[i]);
+    vector<double>* columns[4] = {&index.open_, &index.high_, &index.low_, &index.close_};
+    for (int c = 0; c < 4; ++c) {
+        columns[c]->resize(n);
+        in.read(reinterpret_cast<char*>(columns[c]->data()), n * sizeof(double));
+    }
+    if (!in) throw runtime_error("truncated bar cache file: " + path);
+
+    RangeSectionHeader r{};
+    if (h.range_offset) {
+        in.seekg(h.range_offset);
+        in.read(reinterpret_cast<char*>(&r), sizeof(r));
+    }
+    // the table shape follows from the row count; anything else is not ours to size buffers by
+    uint64_t blocks = n / RangeIndex::kBlock;
+    uint32_t levels = 0;
+    for (uint64_t b = blocks; b; b >>= 1) ++levels;
+    if (!h.range_offset || !in || memcmp(r.magic, kRangeMagic, sizeof(kRangeMagic)) != 0 || r.rows != n
+        || r.block != RangeIndex::kBlock || r.blocks != blocks || r.levels != levels) {
+        // nothing usable stored (none, another block size, or damaged): build from the volume column
+        in.clear();
+        vector<double> volume(n);
+        in.seekg(h.columns_offset + 4 * n * sizeof(double));
+        in.read(reinterpret_cast<char*>(volume.data()), n * sizeof(double));
+        if (!in) throw runtime_error("truncated bar cache file: " + path);
+        index.build_tables(volume);
+        return index;
+    }
+    index.blocks_ = r.blocks;
+    index.levels_ = r.levels;
+    index.volume_sum_.resize(n + 1);
+    index.pv_sum_.resize(n + 1);
+    index.block_high_.resize(size_t(r.levels) * r.blocks);
+    index.block_low_.resize(size_t(r.levels) * r.blocks);
+    for (auto* v : {&index.volume_sum_, &index.pv_sum_, &index.block_high_, &index.block_low_}) {
+        in.read(reinterpret_cast<char*>(v->data()), v->size() * sizeof(double));
+    }
+    if (!in) throw runtime_error("truncated range index in " + path);
+    return index;
+}
+
+pair<uint64_t, uint64_t> BarCache::row_range(const string& path, const LoadOptions& options,
+                                             uint64_t* total_rows) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("failed to open the file: " + path);
+    BarCacheHeader h = read_header(in, path);
+    RowSpan span = locate(in, h, options);
+    if (total_rows) *total_rows = span.total;
+    return {span.first, span.last};
+}
+
+} // namespace sp
@@ -0,0 +1,34 @@
+// columnar binary copy of a bar series (.spb) with a sparse date index for range reads
+
+#pragma once
+#include "csv_loader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+class RangeIndex;
+
+class BarCache {
+public:
+    // bars must be sorted by date; every index_stride-th date goes into the sparse index.
+    // range_index also stores the RangeIndex tables (16 bytes a row plus the small block
+    // tables) after the columns
+    static void write(const std::string& path, const std::vector<Bar>& bars,
+                      uint32_t index_stride = 1024, bool range_index = false);
+
+    // binary-searches the sparse index, then seeks straight to the first requested row
+    // of each selected column; unselected columns are never read
+    static std::vector<Bar> read(const std::string& path, const LoadOptions& options = {});
+
+    // row range [first, last) covering the options' date range, and the row count
+    static std::pair<uint64_t, uint64_t> row_range(const std::string& path, const LoadOptions& options,
+                                                   uint64_t* total_rows = nullptr);
+
+    // the range index of a file: its stored tables if write() added them, otherwise built
+    // from the columns
+    static RangeIndex range_index(const std::string& path);
+};
+
+} // namespace sp
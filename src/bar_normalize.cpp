@@ -0,0 +1,228 @@
+// keys are made relative to the smallest one, stripped of low bits they all share and
+// packed above the row index, so one uint64 array is sorted and only the digits that
+// differ between keys get a pass.
+// already-sorted input (the common case) costs one key scan
+
+#include "bar_normalize.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const int kDigitBits = 11;  // 2048 counters, stays in L1
+const size_t kBuckets = size_t(1) << kDigitBits;
+const int kMsBits = 27;     // 86,400,000 ms per day
+
+int bit_width(uint64_t v) {
+    int bits = 0;
+    while (v) {
+        ++bits;
+        v >>= 1;
+    }
+    return bits;
+}
+
+// reads up to `digits` digits at p; false if there are none
+bool read_number(const string& s, size_t& p, int digits, unsigned& out) {
+    size_t start = p;
+    out = 0;
+    while (p < s.size() && p - start < size_t(digits) && s[p] >= '0' && s[p] <= '9') {
+        out = out * 10 + unsigned(s[p++] - '0');
+    }
+    return p > start;
+}
+
+// stable lsd radix sort of keys on bits [low, low + bits), through scratch
+void radix_sort(vector<uint64_t>& keys, int low, int bits) {
+    size_t n = keys.size();
+    int passes = (bits + kDigitBits - 1) / kDigitBits;
+    vector<size_t> counts(size_t(passes) * kBuckets, 0);
+    for (uint64_t k : keys) {
+        for (int p = 0; p < passes; ++p) counts[p * kBuckets + ((k >> (low + p * kDigitBits)) & (kBuckets - 1))]++;
+    }
+    vector<uint64_t> scratch(n);
+    uint64_t* src = keys.data();
+    uint64_t* dst = scratch.data();
+    for (int p = 0; p < passes; ++p) {
+        size_t* c = &counts[p * kBuckets];
+        // a digit every key shares moves nothing
+        if (*max_element(c, c + kBuckets) == n) continue;
+        size_t sum = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            size_t v = c[b];
+            c[b] = sum;
+            sum += v;
+        }
+        int shift = low + p * kDigitBits;
+        for (size_t i = 0; i < n; ++i) dst[c[(src[i] >> shift) & (kBuckets - 1)]++] = src[i];
+        swap(src, dst);
+    }
+    if (src != keys.data()) copy(src, src + n, keys.data());
+}
+
+} // namespace
+
+uint64_t bar_time_key(const string& date) {
+    uint64_t y, m, d;
+    auto digit = [&](size_t i) { return unsigned(date[i] - '0') <= 9; };
+    auto num = [&](size_t i, size_t len) {
+        uint64_t v = 0;
+        for (size_t k = i; k < i + len; ++k) v = v * 10 + uint64_t(date[k] - '0');
+        return v;
+    };
+    // "YYYY-MM-DD" is read in place; anything else goes through date_to_key
+    if (date.size() >= 10 && digit(0) && digit(1) && digit(2) && digit(3) && date[4] == '-' && digit(5)
+        && digit(6) && date[7] == '-' && digit(8) && digit(9) && (date.size() == 10 || !digit(10))
+        && num(5, 2) - 1 < 12 && num(8, 2) - 1 < 31) {
+        y = num(0, 4);
+        m = num(5, 2);
+        d = num(8, 2);
+    } else {
+        int32_t day = date_to_key(date);
+        y = uint64_t(day / 10000);
+        m = uint64_t(day / 100 % 100);
+        d = uint64_t(day % 100);
+    }
+    uint64_t key = ((y << 9) | (m << 5) | d) << kMsBits;
+
+    if (date.size() == 10) return key;
+    size_t p = date.find_first_of(" T");
+    if (p == string::npos) return key;
+    while (p < date.size() && (date[p] == ' ' || date[p] == 'T')) ++p;
+    if (p == date.size()) return key;
+
+    unsigned hh = 0, mm = 0, ss = 0, ms = 0;
+    bool ok = read_number(date, p, 2, hh) && p < date.size() && date[p++] == ':' && read_number(date, p, 2, mm);
+    if (ok && p < date.size() && date[p] == ':') ok = read_number(date, ++p, 2, ss);
+    if (ok && p < date.size() && date[p] == '.') {
+        size_t start = ++p;
+        ok = read_number(date, p, 3, ms);
+        for (size_t k = p - start; k < 3; ++k) ms *= 10;
+        while (p < date.size() && date[p] >= '0' && date[p] <= '9') ++p;
+    }
+    if (!ok || hh > 23 || mm > 59 || ss > 60) throw invalid_argument("invalid time: " + date);
+    // a leap second sorts with the last millisecond of its minute
+    uint64_t ms_of_day = min<uint64_t>((hh * 3600ull + mm * 60ull + ss) * 1000ull + ms, 86399999ull);
+    return key | ms_of_day;
+}
+
+uint64_t day_time_key(int32_t day) {
+    uint64_t y = uint64_t(day / 10000), m = uint64_t(day / 100 % 100), d = uint64_t(day % 100);
+    return ((y << 9) | (m << 5) | d) << kMsBits;
+}
+
+int32_t time_key_day(uint64_t key) {
+    uint64_t v = key >> kMsBits;
+    return int32_t((v >> 9) * 10000 + ((v >> 5) & 15) * 100 + (v & 31));
+}
+
+void normalize_bars(vector<Bar>& bars, DuplicatePolicy policy, NormalizeStats* stats) {
+    size_t n = bars.size();
+    NormalizeStats st;
+    st.rows_in = n;
+
+    vector<uint64_t> keys(n);
+    uint64_t lo = UINT64_MAX, hi = 0, varying = 0;
+    bool unique = true;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t k = bar_time_key(bars[i].date);
+        keys[i] = k;
+        lo = min(lo, k);
+        hi = max(hi, k);
+        varying |= k ^ keys[0];
+        if (i && k <= keys[i - 1]) {
+            if (k < keys[i - 1]) st.was_sorted = false;
+            else unique = false;
+        }
+    }
+
+    if (st.was_sorted && (unique || policy == DuplicatePolicy::Keep)) {
+        st.rows_out = n;
+        if (stats) *stats = st;
+        return;
+    }
+
+    // order[i] is the input row that goes to position i; keys are put in that order too,
+    // so finding runs of equal keys reads them sequentially
+    vector<size_t> order;
+    if (!st.was_sorted) {
+        order.resize(n);
+        // low bits no key differs in (the time of day, for daily bars) are dropped
+        int shift = 0;
+        while (shift < 63 && !((varying >> shift) & 1)) ++shift;
+        int key_bits = bit_width((hi - lo) >> shift);
+        int index_bits = bit_width(n - 1);
+        if (key_bits + index_bits <= 64) {
+            vector<uint64_t> packed(n);
+            for (size_t i = 0; i < n; ++i) packed[i] = (((keys[i] - lo) >> shift) << index_bits) | i;
+            radix_sort(packed, index_bits, key_bits);
+            uint64_t mask = index_bits == 64 ? UINT64_MAX : (uint64_t(1) << index_bits) - 1;
+            for (size_t i = 0; i < n; ++i) {
+                order[i] = size_t(packed[i] & mask);
+                keys[i] = packed[i] >> index_bits;
+            }
+        } else {
+            // keys spanning millennia at millisecond resolution; still stable
+            iota(order.begin(), order.end(), size_t(0));
+            stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+            vector<uint64_t> in_order(n);
+            for (size_t i = 0; i < n; ++i) in_order[i] = keys[order[i]];
+            keys.swap(in_order);
+        }
+    }
+    auto row = [&](size_t i) { return st.was_sorted ? i : order[i]; };
+
+    vector<Bar> out;
+    out.reserve(n);
+    const size_t kAhead = 16;
+    for (size_t i = 0; i < n;) {
+#if defined(__GNUC__) || defined(__clang__)
+        // the gather is random access once the input was shuffled
+        if (i + kAhead < n) __builtin_prefetch(&bars[row(i + kAhead)]);
+#endif
+        size_t j = i + 1;
+        while (j < n && keys[j] == keys[i]) ++j;
+        switch (policy) {
+        case DuplicatePolicy::Keep:
+            for (size_t r = i; r < j; ++r) out.push_back(move(bars[row(r)]));
+            break;
+        case DuplicatePolicy::KeepFirst:
+            out.push_back(move(bars[row(i)]));
+            break;
+        case DuplicatePolicy::KeepLast:
+            out.push_back(move(bars[row(j - 1)]));
+            break;
+        case DuplicatePolicy::Merge: {
+            Bar merged = move(bars[row(i)]);
+            for (size_t r = i + 1; r < j; ++r) {
+                const Bar& b = bars[row(r)];
+                merged.high = max(merged.high, b.high);
+                merged.low = min(merged.low, b.low);
+                merged.close = b.close;
+                merged.volume += b.volume;
+            }
+            out.push_back(move(merged));
+            break;
+        }
+        }
+        i = j;
+    }
+    st.rows_out = out.size();
+    st.duplicates = n - out.size();
+    bars = move(out);
+    if (stats) *stats = st;
+}
+
+DuplicatePolicy parse_duplicate_policy(const string& name) {
+    if (name == "keep") return DuplicatePolicy::Keep;
+    if (name == "first") return DuplicatePolicy::KeepFirst;
+    if (name == "last") return DuplicatePolicy::KeepLast;
+    if (name == "merge") return DuplicatePolicy::Merge;
+    throw invalid_argument("duplicate policy must be keep, first, last or merge: " + name);
+}
+
+} // namespace sp
@@ -0,0 +1,34 @@
+// puts loaded bars in time order and resolves rows that share a timestamp, for merged
+// vendor files; a stable lsd radix sort over packed integer keys, not string compares
+
+#pragma once
+#include "csv_loader.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sp {
+
+struct NormalizeStats {
+    size_t rows_in = 0;
+    size_t rows_out = 0;
+    size_t duplicates = 0;   // rows dropped or merged into another row
+    bool was_sorted = true;  // input was already in non-decreasing time order
+};
+
+// orderable integer for a "YYYY-MM-DD[ HH:MM[:SS[.fff]]]" date (a T may replace the space):
+// year, month, day and millisecond of the day packed into bit fields. throws invalid_argument
+uint64_t bar_time_key(const std::string& date);
+// bar_time_key of midnight on a yyyymmdd day, and the yyyymmdd day of a key
+uint64_t day_time_key(int32_t day);
+int32_t time_key_day(uint64_t key);
+
+// sorts bars by bar_time_key, keeping the file order of equal keys, then applies
+// policy to each run of equal keys. the bars are moved once, into their final place
+void normalize_bars(std::vector<Bar>& bars, DuplicatePolicy policy = DuplicatePolicy::KeepLast,
+                    NormalizeStats* stats = nullptr);
+
+// "keep", "first", "last", "merge"; throws invalid_argument
+DuplicatePolicy parse_duplicate_policy(const std::string& name);
+
+} // namespace sp
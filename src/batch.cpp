@@ -0,0 +1,145 @@
+// per-symbol pipeline fed by the async loader
+
+#include "batch.h"
+#include "linear_regression.h"
+#include "numa_topology.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+
+namespace sp {
+using namespace std;
+namespace fs = std::filesystem;
+
+BatchRunner::BatchRunner(const BatchConfig& config) : config_(config) {}
+
+vector<string> BatchRunner::list_files(const string& dir) {
+    vector<string> paths;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        string ext = entry.path().extension().string();
+        if (ext == ".csv" || ext == ".spb" || ext == ".spa") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+SymbolResult BatchRunner::run_symbol(const string& symbol, const vector<Bar>& bars) const {
+    SymbolResult r;
+    r.symbol = symbol;
+    r.bars = bars.size();
+    // symbols already run side by side, one per loader worker
+    FeatureConfig features_config = config_.features;
+    features_config.threads = 1;
+    FeatureEngineer engineer(features_config);
+    auto [features, targets] = engineer.create_features(bars, config_.horizon);
+    auto [train_X, train_y, test_X, test_y] =
+        engineer.train_test_split(features, targets, config_.train_ratio);
+    r.train_rows = train_X.size();
+    r.test_rows = test_X.size();
+    if (train_X.empty() || test_X.empty()) {
+        r.error = "insufficient data";
+        return r;
+    }
+    LinearRegression model;
+    model.set_threads(1);
+    if (!model.train(train_X, train_y)) {
+        r.error = "training failed";
+        return r;
+    }
+    r.test_rmse = sqrt(model.evaluate(test_X, test_y));
+    r.test_r2 = model.r_squared(test_X, test_y);
+    r.last_prediction = model.predict(test_X.back());
+    return r;
+}
+
+vector<SymbolResult> BatchRunner::run(const vector<string>& paths,
+                                      vector<NodeThroughput>* per_node) const {
+    vector<SymbolResult> results(paths.size());
+    auto process = [&](size_t i, LoadedSeries& series) {
+        string symbol = fs::path(series.path).stem().string();
+        if (!series.error.empty()) {
+            results[i].symbol = symbol;
+            results[i].error = series.error;
+            return;
+        }
+        try {
+            results[i] = run_symbol(symbol, series.bars);
+        } catch (const exception& e) {
+            results[i].symbol = symbol;
+            results[i].error = e.what();
+        }
+    };
+    if (!config_.numa) {
+        load_many_async(paths, process, config_.load);
+        return results;
+    }
+
+    vector<NumaNode> nodes = numa_topology();
+    size_t total_cpus = 0;
+    for (const auto& node : nodes) total_cpus += node.cpus.size();
+    vector<NodeThroughput> stats(nodes.size());
+    vector<exception_ptr> failures(nodes.size());
+    vector<thread> shards;
+    size_t begin = 0, cpus_before = 0;
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        cpus_before += nodes[n].cpus.size();
+        size_t end = paths.size() * cpus_before / total_cpus;
+        shards.emplace_back([&, n, begin, end] {
+            const NumaNode& node = nodes[n];
+            pin_thread_to_node(node);
+            AsyncLoadOptions load = config_.load;
+            load.workers = static_cast<unsigned>(node.cpus.size());
+            load.in_flight = max<size_t>(1, load.in_flight * node.cpus.size() / total_cpus);
+            load.thread_init = [&node] { pin_thread_to_node(node); };
+            vector<string> shard(paths.begin() + begin, paths.begin() + end);
+            NodeThroughput& s = stats[n];
+            s.node = node.id;
+            s.threads = load.workers;
+            atomic<size_t> symbols{0}, bars{0};
+            auto start = chrono::steady_clock::now();
+            try {
+                load_many_async(shard, [&](size_t i, LoadedSeries& series) {
+                    bars += series.bars.size();
+                    ++symbols;
+                    process(begin + i, series);
+                }, load);
+            } catch (...) {
+                failures[n] = current_exception();
+            }
+            s.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            s.symbols = symbols;
+            s.bars = bars;
+        });
+        begin = end;
+    }
+    for (auto& t : shards) t.join();
+    for (auto& f : failures) {
+        if (f) rethrow_exception(f);
+    }
+    if (per_node) *per_node = move(stats);
+    return results;
+}
+
+void BatchRunner::write_csv(const string& path, const vector<SymbolResult>& results) {
+    ofstream out(path);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+    out << "Symbol,Bars,TrainRows,TestRows,TestRMSE,TestR2,LastPrediction,Error\n" << fixed;
+    for (const auto& r : results) {
+        string error = r.error;
+        replace(error.begin(), error.end(), ',', ';');
+        out << r.symbol << ',' << r.bars << ',' << r.train_rows << ',' << r.test_rows << ','
+            << setprecision(4) << r.test_rmse << ',' << r.test_r2 << ',' << r.last_prediction << ','
+            << error << '\n';
+    }
+}
+
+} // namespace sp
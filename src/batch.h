@@ -0,0 +1,72 @@
+// runs the single-symbol pipeline (features, fit, test metrics) over a directory of files
+
+#pragma once
+#include "async_loader.h"
+#include "feature_engineer.h"
+#include <string>
+#include <vector>
+
+namespace sp {
+
+struct RefreshStats;
+
+struct BatchConfig {
+    FeatureConfig features;
+    int horizon = 1;
+    double train_ratio = 0.8;
+    AsyncLoadOptions load;
+    bool numa = false;  // shard symbols across numa nodes, see BatchRunner::run
+};
+
+struct SymbolResult {
+    std::string symbol;  // file name without extension
+    size_t bars = 0;
+    size_t train_rows = 0;
+    size_t test_rows = 0;
+    double test_rmse = 0.0;
+    double test_r2 = 0.0;
+    double last_prediction = 0.0;
+    std::string error;   // empty when the symbol ran through
+};
+
+// one node's share of a numa-sharded run
+struct NodeThroughput {
+    int node = 0;
+    unsigned threads = 0;  // workers pinned to the node
+    size_t symbols = 0;
+    size_t bars = 0;
+    double seconds = 0.0;  // wall time of the node's shard
+};
+
+class BatchRunner {
+public:
+    explicit BatchRunner(const BatchConfig& config);
+
+    // .csv, .spb and .spa files directly under dir, sorted by name
+    static std::vector<std::string> list_files(const std::string& dir);
+
+    // each symbol is processed on a loader worker as soon as its file is parsed;
+    // results come back in the order of paths. with config.numa the paths are split
+    // into one contiguous shard per node (sized by its cpu count), each loaded by its own
+    // workers and reader pinned to that node, so a symbol's bars, features and model
+    // are first touched, and stay, on the node that computes them. per_node is filled
+    // only in that mode
+    std::vector<SymbolResult> run(const std::vector<std::string>& paths,
+                                  std::vector<NodeThroughput>* per_node = nullptr) const;
+    SymbolResult run_symbol(const std::string& symbol, const std::vector<Bar>& bars) const;
+    
+    // run() that keeps per-symbol state under state_dir (refresh.h): files whose
+    // fingerprint is unchanged are not read, changed ones continue from their first
+    // changed bar instead of rebuilding every feature row and refitting from scratch.
+    // config.numa is not used here: the changed files are loaded unsharded
+    std::vector<SymbolResult> refresh(const std::vector<std::string>& paths,
+                                      const std::string& state_dir,
+                                      RefreshStats* stats = nullptr) const;
+
+    static void write_csv(const std::string& path, const std::vector<SymbolResult>& results);
+
+private:
+    BatchConfig config_;
+};
+
+} // namespace sp
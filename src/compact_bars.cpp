@@ -0,0 +1,158 @@
+// quantizes prices to ticks relative to a per-block base and decodes them with simd kernels
+
+#include "compact_bars.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+int price_slot(BarColumn column) {
+    switch (column) {
+        case kOpen: return 0;
+        case kHigh: return 1;
+        case kLow: return 2;
+        case kClose: return 3;
+        default: return -1;
+    }
+}
+
+void put_varint(huge_vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+uint64_t get_varint(const uint8_t*& p) {
+    uint64_t v = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        v |= static_cast<uint64_t>(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    v |= static_cast<uint64_t>(*p++) << shift;
+    return v;
+}
+
+} // namespace
+
+CompactBarSeries CompactBarSeries::encode(const vector<Bar>& bars, double tick_size) {
+    if (!(tick_size > 0.0)) throw invalid_argument("tick size must be positive");
+    CompactBarSeries s;
+    s.tick_ = tick_size;
+    size_t n = bars.size();
+    s.dates_.resize(n);
+    for (auto& col : s.prices_) col.resize(n);
+
+    bool fits_u32 = true;
+    vector<uint64_t> volumes(n);
+    for (size_t i = 0; i < n; ++i) {
+        double v = bars[i].volume;
+        if (!(v >= 0.0) || v > 1.8e19) throw invalid_argument("volume out of range on " + bars[i].date);
+        volumes[i] = static_cast<uint64_t>(llround(v));
+        fits_u32 = fits_u32 && volumes[i] <= numeric_limits<uint32_t>::max();
+    }
+
+    for (size_t b0 = 0; b0 < n; b0 += kBlock) {
+        size_t b1 = min(n, b0 + kBlock);
+        vector<int64_t> ticks(4 * (b1 - b0));
+        int64_t lo = numeric_limits<int64_t>::max(), hi = numeric_limits<int64_t>::min();
+        for (size_t i = b0; i < b1; ++i) {
+            const double px[4] = {bars[i].open, bars[i].high, bars[i].low, bars[i].close};
+            for (int c = 0; c < 4; ++c) {
+                double q = px[c] / tick_size;
+                if (!isfinite(q) || fabs(q) > 9e15 || fabs(q - nearbyint(q)) > 1e-6) {
+                    throw invalid_argument("price not on the tick grid on " + bars[i].date);
+                }
+                int64_t t = static_cast<int64_t>(nearbyint(q));
+                ticks[(i - b0) * 4 + c] = t;
+                lo = min(lo, t);
+                hi = max(hi, t);
+            }
+        }
+        if (hi - lo > numeric_limits<int32_t>::max()) {
+            throw invalid_argument("price range within a block exceeds 32-bit ticks");
+        }
+        s.base_.push_back(lo);
+        for (size_t i = b0; i < b1; ++i) {
+            s.dates_[i] = date_to_key(bars[i].date);
+            for (int c = 0; c < 4; ++c) {
+                s.prices_[c][i] = static_cast<int32_t>(ticks[(i - b0) * 4 + c] - lo);
+            }
+        }
+        if (!fits_u32) {
+            s.volume_block_.push_back(s.volume_bytes_.size());
+            for (size_t i = b0; i < b1; ++i) put_varint(s.volume_bytes_, volumes[i]);
+        }
+    }
+    s.varint_ = !fits_u32;
+    if (fits_u32) s.volume_u32_.assign(volumes.begin(), volumes.end());
+    return s;
+}
+
+void CompactBarSeries::decode(BarColumn column, size_t first, size_t count, double* out) const {
+    if (first + count > size()) throw out_of_range("decode range past end of series");
+    int slot = price_slot(column);
+    if (slot < 0 && column != kVolume) throw invalid_argument("decode takes a single bar column");
+
+    size_t i = first, end = first + count;
+    while (i < end) {
+        size_t block = i / kBlock;
+        size_t stop = min(end, (block + 1) * kBlock);
+        if (slot >= 0) {
+            simd::i32_affine(&prices_[slot][i], stop - i, static_cast<double>(base_[block]), tick_, out);
+        } else if (!varint_) {
+            simd::u32_to_f64(&volume_u32_[i], stop - i, out);
+        } else {
+            // varints are sequential: skip to i inside the block, then decode
+            const uint8_t* p = volume_bytes_.data() + volume_block_[block];
+            for (size_t k = block * kBlock; k < i; ++k) get_varint(p);
+            for (size_t k = i; k < stop; ++k) out[k - i] = static_cast<double>(get_varint(p));
+        }
+        out += stop - i;
+        i = stop;
+    }
+}
+
+vector<double> CompactBarSeries::column(BarColumn column) const {
+    vector<double> out(size());
+    decode(column, 0, size(), out.data());
+    return out;
+}
+
+void CompactBarSeries::for_each_block(BarColumn column,
+                                      const function<void(const double*, size_t, size_t)>& fn) const {
+    double buf[kBlock];
+    for (size_t first = 0; first < size(); first += kBlock) {
+        size_t count = min(kBlock, size() - first);
+        decode(column, first, count, buf);
+        fn(buf, count, first);
+    }
+}
+
+vector<Bar> CompactBarSeries::to_bars() const {
+    vector<Bar> bars(size());
+    auto open = column(kOpen), high = column(kHigh), low = column(kLow);
+    auto close = column(kClose), volume = column(kVolume);
+    for (size_t i = 0; i < size(); ++i) {
+        bars[i] = {key_to_date(dates_[i]), open[i], high[i], low[i], close[i], volume[i]};
+    }
+    return bars;
+}
+
+size_t CompactBarSeries::memory_bytes() const {
+    size_t bytes = dates_.size() * sizeof(int32_t) + base_.size() * sizeof(int64_t);
+    for (const auto& col : prices_) bytes += col.size() * sizeof(int32_t);
+    bytes += volume_u32_.size() * sizeof(uint32_t) + volume_bytes_.size()
+           + volume_block_.size() * sizeof(uint64_t);
+    return bytes;
+}
+
+} // namespace sp
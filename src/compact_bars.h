@@ -0,0 +1,50 @@
+// compact in-memory bar storage: fixed-point int32 prices per block, integer volumes
+
+#pragma once
+#include "csv_loader.h"
+#include "huge_pages.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace sp {
+
+class CompactBarSeries {
+public:
+    static constexpr size_t kBlock = 1024;
+
+    // prices must sit on the tick grid (within 1e-6 tick); volumes are stored as whole
+    // units, as uint32 when every value fits and as varints otherwise
+    static CompactBarSeries encode(const std::vector<Bar>& bars, double tick_size = 0.01);
+
+    size_t size() const { return dates_.size(); }
+    double tick_size() const { return tick_; }
+    int32_t date_key(size_t i) const { return dates_[i]; }
+    bool varint_volume() const { return varint_; }
+
+    // decodes rows [first, first + count) of one column (kOpen .. kVolume) into out
+    void decode(BarColumn column, size_t first, size_t count, double* out) const;
+    std::vector<double> column(BarColumn column) const;
+
+    // streams a column block by block through a small buffer, so an indicator kernel
+    // consumes decoded values while they are still in L1
+    void for_each_block(BarColumn column,
+                        const std::function<void(const double* values, size_t count, size_t first)>& fn) const;
+
+    std::vector<Bar> to_bars() const;
+
+    // bytes held by the encoded columns
+    size_t memory_bytes() const;
+
+private:
+    double tick_ = 0.01;
+    huge_vector<int32_t> dates_;
+    std::vector<int64_t> base_;            // per block, in ticks
+    huge_vector<int32_t> prices_[4];       // open, high, low, close offsets from base
+    bool varint_ = false;
+    huge_vector<uint32_t> volume_u32_;
+    huge_vector<uint8_t> volume_bytes_;    // varint stream when volumes exceed 32 bits
+    std::vector<uint64_t> volume_block_;   // byte offset of each block in the varint stream
+};
+
+} // namespace sp
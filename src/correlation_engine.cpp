@@ -0,0 +1,205 @@
+// cache-blocked, multithreaded SYRK (upper triangle only) with rank-1 window updates
+
+#include "correlation_engine.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+// column tile and row (time) block sizes: two 64-column panels of 256 rows
+// stay in L2 while their upper-triangle tile is accumulated
+const size_t kTile = 64;
+const size_t kDepth = 256;
+
+const char kMagic[8] = {'S', 'P', 'C', 'O', 'R', 'R', '1', '\0'};
+
+struct MatrixHeader {
+    char magic[8];
+    uint64_t n;
+    uint64_t window;
+    uint32_t kind;
+    uint32_t reserved;
+    char pad[32];
+};
+static_assert(sizeof(MatrixHeader) == 64, "matrix header must stay 64 bytes");
+
+size_t packed_index(size_t n, size_t i, size_t j) {
+    return i * n - i * (i - 1) / 2 + (j - i);
+}
+
+} // namespace
+
+CorrelationEngine::CorrelationEngine(size_t n_symbols, size_t window, unsigned threads)
+    : n_(n_symbols), window_(window), threads_(threads == 0 ? default_threads() : threads),
+      cross_(n_symbols * n_symbols, 0.0), sums_(n_symbols, 0.0),
+      ring_(n_symbols * window, 0.0) {
+    if (window == 0) throw invalid_argument("window must be positive");
+}
+
+void CorrelationEngine::syrk_upper(const double* returns, size_t first_row, size_t rows, size_t ld) {
+    size_t tiles = (n_ + kTile - 1) / kTile;
+    vector<pair<size_t, size_t>> work;
+    for (size_t bi = 0; bi < tiles; ++bi)
+        for (size_t bj = bi; bj < tiles; ++bj) work.emplace_back(bi, bj);
+
+    // every tile owns a disjoint block of the output, so no locking
+    parallel_for(work.size(), [&](size_t w) {
+        size_t i0 = work[w].first * kTile, i1 = min(n_, i0 + kTile);
+        size_t j0 = work[w].second * kTile, j1 = min(n_, j0 + kTile);
+        for (size_t k0 = 0; k0 < rows; k0 += kDepth) {
+            size_t len = min(kDepth, rows - k0);
+            size_t off = first_row + k0;
+            for (size_t i = i0; i < i1; ++i) {
+                const double* a = returns + i * ld + off;
+                double* c = &cross_[i * n_];
+                size_t j = max(j0, i);
+                // 1x4 micro-kernel: one column of A against four at a time
+                for (; j + 4 <= j1; j += 4) {
+                    const double* b0 = returns + j * ld + off;
+                    const double* b1 = b0 + ld;
+                    const double* b2 = b1 + ld;
+                    const double* b3 = b2 + ld;
+                    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+                    for (size_t k = 0; k < len; ++k) {
+                        double av = a[k];
+                        s0 += av * b0[k];
+                        s1 += av * b1[k];
+                        s2 += av * b2[k];
+                        s3 += av * b3[k];
+                    }
+                    c[j] += s0;
+                    c[j + 1] += s1;
+                    c[j + 2] += s2;
+                    c[j + 3] += s3;
+                }
+                for (; j < j1; ++j) {
+                    const double* b = returns + j * ld + off;
+                    double s = 0.0;
+                    for (size_t k = 0; k < len; ++k) s += a[k] * b[k];
+                    c[j] += s;
+                }
+            }
+        }
+    }, threads_);
+}
+
+void CorrelationEngine::compute(const double* returns, size_t rows, size_t ld) {
+    if (ld < rows) throw invalid_argument("leading dimension smaller than row count");
+    size_t used = min(rows, window_);
+    size_t first = rows - used;
+
+    fill(cross_.begin(), cross_.end(), 0.0);
+    syrk_upper(returns, first, used, ld);
+
+    for (size_t j = 0; j < n_; ++j) {
+        const double* col = returns + j * ld + first;
+        double s = 0.0;
+        for (size_t k = 0; k < used; ++k) s += col[k];
+        sums_[j] = s;
+        for (size_t k = 0; k < used; ++k) ring_[k * n_ + j] = col[k];
+    }
+    count_ = used;
+    head_ = used % window_;
+}
+
+void CorrelationEngine::push_row(const double* row) {
+    bool full = count_ == window_;
+    const double* old = &ring_[head_ * n_];
+
+    // S += r r^T - o o^T on the upper triangle, rows split across threads
+    parallel_for(n_, [&](size_t i) {
+        double* c = &cross_[i * n_];
+        double ri = row[i];
+        if (full) {
+            double oi = old[i];
+            for (size_t j = i; j < n_; ++j) c[j] += ri * row[j] - oi * old[j];
+        } else {
+            for (size_t j = i; j < n_; ++j) c[j] += ri * row[j];
+        }
+    }, threads_);
+
+    for (size_t j = 0; j < n_; ++j) {
+        sums_[j] += row[j] - (full ? old[j] : 0.0);
+    }
+    copy(row, row + n_, ring_.begin() + head_ * n_);
+    head_ = (head_ + 1) % window_;
+    if (!full) ++count_;
+}
+
+double CorrelationEngine::covariance(size_t i, size_t j) const {
+    if (i >= n_ || j >= n_) throw out_of_range("symbol index out of range");
+    if (count_ < 2) return NAN;
+    if (i > j) swap(i, j);
+    double m = static_cast<double>(count_);
+    return (cross_[i * n_ + j] - sums_[i] * sums_[j] / m) / (m - 1.0);
+}
+
+double CorrelationEngine::correlation(size_t i, size_t j) const {
+    double vi = covariance(i, i);
+    double vj = covariance(j, j);
+    if (!(vi > 0.0) || !(vj > 0.0)) return NAN;
+    return covariance(i, j) / sqrt(vi * vj);
+}
+
+void CorrelationEngine::write(const string& path, MatrixKind kind) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+
+    MatrixHeader h{};
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.n = n_;
+    h.window = count_;
+    h.kind = static_cast<uint32_t>(kind);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    // variances once up front so correlation rows need no recomputation
+    vector<double> sd(n_);
+    for (size_t i = 0; i < n_; ++i) sd[i] = sqrt(covariance(i, i));
+
+    vector<double> row;
+    row.reserve(n_);
+    for (size_t i = 0; i < n_; ++i) {
+        row.clear();
+        for (size_t j = i; j < n_; ++j) {
+            double c = covariance(i, j);
+            if (kind == MatrixKind::Correlation) {
+                c = (sd[i] > 0.0 && sd[j] > 0.0) ? c / (sd[i] * sd[j]) : NAN;
+            }
+            row.push_back(c);
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(double));
+    }
+    if (!out) throw runtime_error("failed to write the file: " + path);
+}
+
+CorrelationFile::CorrelationFile(const string& path) : file_(path) {
+    if (file_.size() < sizeof(MatrixHeader)) throw runtime_error("matrix file too small: " + path);
+    MatrixHeader h;
+    memcpy(&h, file_.data(), sizeof(h));
+    if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw runtime_error("not a correlation matrix file: " + path);
+    }
+    n_ = static_cast<size_t>(h.n);
+    window_ = static_cast<size_t>(h.window);
+    kind_ = static_cast<MatrixKind>(h.kind);
+    if (file_.size() != sizeof(MatrixHeader) + n_ * (n_ + 1) / 2 * sizeof(double)) {
+        throw runtime_error("matrix file size does not match header: " + path);
+    }
+    values_ = reinterpret_cast<const double*>(file_.data() + sizeof(MatrixHeader));
+}
+
+double CorrelationFile::at(size_t i, size_t j) const {
+    if (i >= n_ || j >= n_) throw out_of_range("symbol index out of range");
+    if (i > j) swap(i, j);
+    return values_[packed_index(n_, i, j)];
+}
+
+} // namespace sp
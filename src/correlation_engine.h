@@ -0,0 +1,70 @@
+// rolling cross-asset covariance / correlation matrix over aligned return columns
+
+#pragma once
+#include "huge_pages.h"
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+
+namespace sp {
+
+enum class MatrixKind { Covariance = 0, Correlation = 1 };
+
+class CorrelationEngine {
+public:
+    // threads = 0 uses every hardware thread
+    CorrelationEngine(size_t n_symbols, size_t window, unsigned threads = 0);
+
+    // full recompute from the last `window` rows of a column-major panel:
+    // symbol j's returns start at returns + j * ld, rows are time steps
+    void compute(const double* returns, size_t rows, size_t ld);
+
+    // slides the window by one time step (one return per symbol), O(N^2)
+    void push_row(const double* row);
+
+    size_t symbols() const { return n_; }
+    size_t window() const { return window_; }
+    size_t count() const { return count_; }
+
+    double covariance(size_t i, size_t j) const;
+    double correlation(size_t i, size_t j) const;
+
+    // packed upper triangle (row-major, j >= i) behind a fixed 64 byte header
+    void write(const std::string& path, MatrixKind kind) const;
+
+private:
+    size_t n_;
+    size_t window_;
+    unsigned threads_;
+
+    // upper triangle of sum(r r^T) stored in a full n x n array, plus column sums
+    huge_vector<double> cross_;
+    std::vector<double> sums_;
+
+    // rows currently in the window, needed to retract them incrementally
+    huge_vector<double> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+
+    void syrk_upper(const double* returns, size_t first_row, size_t rows, size_t ld);
+};
+
+// read-only view of a matrix file written by CorrelationEngine::write
+class CorrelationFile {
+public:
+    explicit CorrelationFile(const std::string& path);
+
+    size_t symbols() const { return n_; }
+    size_t window() const { return window_; }
+    MatrixKind kind() const { return kind_; }
+    double at(size_t i, size_t j) const;
+
+private:
+    MappedFile file_;
+    const double* values_ = nullptr;
+    size_t n_ = 0;
+    size_t window_ = 0;
+    MatrixKind kind_ = MatrixKind::Covariance;
+};
+
+} // namespace sp
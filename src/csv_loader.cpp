@@ -1,46 +1,169 @@
 // reads stock data from csv file into Bar structs
 
 #include "csv_loader.h"
+#include "bar_cache.h"
+#include "bar_archive.h"
+#include "bar_normalize.h"
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 
 using namespace sp;
-using std::getline;
+
+int32_t sp::date_to_key(const std::string& date) {
+    int32_t parts[3] = {0, 0, 0};
+    int field = 0, digits = 0;
+    for (char c : date) {
+        if (c == '-' || c == '/') {
+            if (digits == 0 || ++field > 2) break;
+            digits = 0;
+        } else if (c >= '0' && c <= '9') {
+            parts[field] = parts[field] * 10 + (c - '0');
+            ++digits;
+        } else {
+            break;
+        }
+    }
+    if (field != 2 || digits == 0 || parts[1] < 1 || parts[1] > 12 || parts[2] < 1 || parts[2] > 31) {
+        throw std::invalid_argument("invalid date: " + date);
+    }
+    return parts[0] * 10000 + parts[1] * 100 + parts[2];
+}
+
+std::string sp::key_to_date(int32_t key) {
+    if (key < 0 || key > 99991231) {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "%d", key);
+        return buf;
+    }
+    // hand formatted, binary readers call this once per row
+    int y = key / 10000, m = (key / 100) % 100, d = key % 100;
+    char buf[10] = {char('0' + y / 1000), char('0' + y / 100 % 10), char('0' + y / 10 % 10),
+                    char('0' + y % 10), '-', char('0' + m / 10), char('0' + m % 10), '-',
+                    char('0' + d / 10), char('0' + d % 10)};
+    return std::string(buf, 10);
+}
+
+namespace {
+
+double parse_field(const char* b, const char* e) {
+    while (b < e && (*b == ' ' || *b == '+')) ++b;
+    double v = 0.0;
+    auto res = std::from_chars(b, e, v);
+    if (res.ec != std::errc() || res.ptr == b) {
+        throw std::runtime_error("invalid number in CSV: '" + std::string(b, e) + "'");
+    }
+    return v;
+}
+
+// normalization and any quality checks the parse loop could not do inline
+std::vector<Bar> finish(std::vector<Bar> bars, const LoadOptions& options, const QualityChecker* checked,
+                        QualityReport* quality) {
+    if (options.normalize) normalize_bars(bars, options.duplicates);
+    if (checked) {
+        if (quality) *quality = checked->report();
+    } else if (options.quality.policy != QualityPolicy::Off) {
+        QualityReport report = check_bars(bars, options.quality, options.columns);
+        if (quality) *quality = std::move(report);
+    }
+    return bars;
+}
+
+} // namespace
 
 CSVLoader::CSVLoader(const std::string &path) : path_(path) {}
 
 std::vector<Bar> CSVLoader::load() {
-    std::vector<Bar> rows;
+    return load(LoadOptions{});
+}
+
+std::vector<Bar> CSVLoader::load(const LoadOptions& options, QualityReport* quality) {
+    auto has_ext = [&](const char* ext) {
+        return path_.size() > 4 && path_.compare(path_.size() - 4, 4, ext) == 0;
+    };
+    if (has_ext(".spb")) return finish(BarCache::read(path_, options), options, nullptr, quality);
+    if (has_ext(".spa")) return finish(BarArchive::read(path_, options), options, nullptr, quality);
 
-    std::ifstream in(path_);
+    std::ifstream in(path_, std::ios::binary);
     if (!in) throw std::runtime_error("failed to open the file: " + path_);
 
-    std::string line;
+    // one read of the whole file, then parse in place
+    std::ostringstream buf;
+    buf << in.rdbuf();
+    std::string text = buf.str();
+    return parse(text.data(), text.size(), options, quality);
+}
+
+std::vector<Bar> CSVLoader::parse(const char* data, size_t len, const LoadOptions& options,
+                                  QualityReport* quality) {
+    std::vector<Bar> rows;
+    const char* p = data;
+    const char* end = data + len;
+
+    auto next_line = [&](const char*& b, const char*& e) {
+        if (p >= end) return false;
+        b = p;
+        while (p < end && *p != '\n') ++p;
+        e = p;
+        if (p < end) ++p;
+        if (e > b && e[-1] == '\r') --e;
+        return true;
+    };
+
+    const char *b, *e;
 
     // skip header line
-    if (!getline(in, line)) return rows;
+    if (!next_line(b, e)) return rows;
+
+    if (std::string(b, e).find("Date") == std::string::npos) throw std::runtime_error("CSV header must contain 'Date'");
+
+    bool ranged = !options.start_date.empty() || !options.end_date.empty();
+    int32_t lo = options.start_date.empty() ? INT32_MIN : date_to_key(options.start_date);
+    int32_t hi = options.end_date.empty() ? INT32_MAX : date_to_key(options.end_date);
 
-    if (line.find("Date") == std::string::npos) throw std::runtime_error("CSV header must contain 'Date'");
+    // rows that are about to be re-sorted are checked after the sort instead
+    bool check_inline = options.quality.policy != QualityPolicy::Off && !options.normalize;
+    QualityChecker checker(options.quality, options.columns);
 
     // parse each row: Date,Open,High,Low,Close,Volume
-    while (getline(in, line)) {
-        if (line.empty()) continue;
+    while (next_line(b, e)) {
+        if (b == e) continue;
 
-        std::istringstream ss(line);
-        std::string tok;
-        Bar b{};
+        // field boundaries only; nothing is converted yet
+        const char* fb[6];
+        const char* fe[6];
+        int n = 0;
+        for (const char* q = b; n < 6; ++q) {
+            fb[n] = q;
+            while (q < e && *q != ',') ++q;
+            fe[n++] = q;
+            if (q >= e) break;
+        }
 
-        getline(ss, b.date, ',');
+        if (ranged) {
+            int32_t key = date_to_key(std::string(fb[0], fe[0]));
+            if (key < lo || key > hi) continue;
+        }
 
-        getline(ss, tok, ','); b.open = std::stod(tok);
-        getline(ss, tok, ','); b.high = std::stod(tok);
-        getline(ss, tok, ','); b.low = std::stod(tok);
-        getline(ss, tok, ','); b.close = std::stod(tok);
-        getline(ss, tok, ','); b.volume = std::stod(tok);
+        Bar bar{};
+        bar.date.assign(fb[0], fe[0]);
+        double* values[5] = {&bar.open, &bar.high, &bar.low, &bar.close, &bar.volume};
+        for (int c = 0; c < 5; ++c) {
+            if (!(options.columns & (1u << c))) {
+                *values[c] = NAN;
+                continue;
+            }
+            if (c + 1 >= n) throw std::runtime_error("CSV row has too few columns: " + std::string(b, e));
+            *values[c] = parse_field(fb[c + 1], fe[c + 1]);
+        }
 
-        rows.push_back(b);
+        if (check_inline && !checker.check(bar)) continue;
+        rows.push_back(bar);
     }
 
-    return rows;
+    return finish(std::move(rows), options, check_inline ? &checker : nullptr, quality);
 }
@@ -1,6 +1,8 @@
 // loads OHLCV stock data from csv files
 
 #pragma once
+#include "data_quality.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -11,10 +13,50 @@ struct Bar {
      std::string date; double open, high, low, close; double volume;
      };
 
+// "YYYY-MM-DD" <-> yyyymmdd integer, so dates sort and compare as numbers
+int32_t date_to_key(const std::string& date);
+std::string key_to_date(int32_t key);
+
+// column bits for LoadOptions::columns
+enum BarColumn : unsigned {
+    kOpen = 1u << 0,
+    kHigh = 1u << 1,
+    kLow = 1u << 2,
+    kClose = 1u << 3,
+    kVolume = 1u << 4,
+    kAllColumns = kOpen | kHigh | kLow | kClose | kVolume
+};
+
+// rows sharing a timestamp after normalization (bar_normalize.h): keep them all, keep
+// the first or last in file order, or merge into one bar (first open, highest high,
+// lowest low, last close, summed volume)
+enum class DuplicatePolicy : uint8_t { Keep, KeepFirst, KeepLast, Merge };
+
+// rows outside [start_date, end_date] (inclusive, empty = open ended) are skipped
+// before any price is parsed; columns not selected are never converted and stay NaN.
+// without normalize, rows are returned in file order and assumed sorted and unique.
+// quality rules (data_quality.h) run on each csv row as it is parsed, or over the
+// sorted rows when normalizing, and on binary files after they are read
+struct LoadOptions {
+    std::string start_date;
+    std::string end_date;
+    unsigned columns = kAllColumns;
+    bool normalize = false;
+    DuplicatePolicy duplicates = DuplicatePolicy::KeepLast;
+    QualityRules quality;
+};
+
 class CSVLoader {
 public:
     explicit CSVLoader(const std::string &path);
+    // .spb paths are read as a binary bar cache (bar_cache.h), .spa as an archive (bar_archive.h)
     std::vector<Bar> load();
+    // quality, when given, receives what options.quality found
+    std::vector<Bar> load(const LoadOptions& options, QualityReport* quality = nullptr);
+
+    // parses csv text already in memory (header line included)
+    static std::vector<Bar> parse(const char* data, size_t len, const LoadOptions& options = {},
+                                  QualityReport* quality = nullptr);
 private:
     std::string path_;
 };
@@ -0,0 +1,149 @@
+// quality rules for one bar at a time; the loader calls check() right after it converts
+// a row, so the data is validated without a second pass
+
+#include "data_quality.h"
+#include "csv_loader.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+QualityChecker::QualityChecker(const QualityRules& rules, unsigned columns)
+    : rules_(rules), columns_(columns) {}
+
+unsigned QualityChecker::flags(const Bar& bar) const {
+    const double v[5] = {bar.open, bar.high, bar.low, bar.close, bar.volume};
+    unsigned f = 0;
+    for (int c = 0; c < 5; ++c) {
+        if (!(columns_ & (1u << c))) continue;
+        if (!isfinite(v[c])) f |= kNonFinite;
+        else if (c < 4 ? v[c] <= 0.0 : v[c] < 0.0) f |= kNonPositive;
+    }
+    // the relative rules need usable numbers
+    if (f) return f;
+
+    if ((columns_ & kHigh) && (columns_ & kLow) && bar.high < bar.low) f |= kHighBelowLow;
+    if (rules_.max_gap > 0.0 && have_prev_ && (columns_ & kClose)) {
+        double prev = prev_[3];
+        if (fabs(bar.close / prev - 1.0) > rules_.max_gap
+            || ((columns_ & kOpen) && fabs(bar.open / prev - 1.0) > rules_.max_gap)) {
+            f |= kPriceGap;
+        }
+    }
+    if (rules_.volume_spike > 0.0 && (columns_ & kVolume) && volume_rows_ >= rules_.volume_window
+        && volume_avg_ > 0.0 && bar.volume > rules_.volume_spike * volume_avg_) {
+        f |= kVolumeSpike;
+    }
+    return f;
+}
+
+void QualityChecker::accept(const Bar& bar) {
+    prev_[0] = bar.open;
+    prev_[1] = bar.high;
+    prev_[2] = bar.low;
+    prev_[3] = bar.close;
+    prev_[4] = bar.volume;
+    have_prev_ = true;
+    if (!(columns_ & kVolume)) return;
+    // plain mean while warming up, then exponential
+    double alpha = volume_rows_ < rules_.volume_window ? 1.0 / double(volume_rows_ + 1)
+                                                      : 2.0 / double(rules_.volume_window + 1);
+    volume_avg_ += alpha * (bar.volume - volume_avg_);
+    ++volume_rows_;
+}
+
+bool QualityChecker::check(Bar& bar) {
+    size_t row = report_.rows++;
+    unsigned f = rules_.policy == QualityPolicy::Off ? 0 : flags(bar);
+    if (f & kPriceGap) {
+        bool same_level = gap_run_ > 0 && fabs(bar.close / last_raw_close_ - 1.0) <= rules_.max_gap;
+        gap_run_ = same_level ? gap_run_ + 1 : 1;
+        if (rules_.reanchor_rows > 0 && gap_run_ >= rules_.reanchor_rows) {
+            f &= ~unsigned(kPriceGap);  // the level moved; this row is the new reference
+            gap_run_ = 0;
+        }
+    } else {
+        gap_run_ = 0;
+    }
+    if ((columns_ & kClose) && isfinite(bar.close)) last_raw_close_ = bar.close;
+    if (!f) {
+        accept(bar);
+        return true;
+    }
+
+    ++report_.flagged;
+    if (row / 64 >= report_.flagged_rows.size()) report_.flagged_rows.resize(row / 64 + 1, 0);
+    report_.flagged_rows[row / 64] |= uint64_t(1) << (row % 64);
+    for (unsigned r = 0; r < kQualityRuleCount; ++r) {
+        if (f & (1u << r)) ++report_.rule_counts[r];
+    }
+
+    switch (rules_.policy) {
+    case QualityPolicy::Off:
+    case QualityPolicy::Flag:
+        return true;
+    case QualityPolicy::Drop:
+        ++report_.dropped;
+        return false;
+    case QualityPolicy::Clamp:
+    case QualityPolicy::ForwardFill:
+        break;
+    }
+
+    double* v[5] = {&bar.open, &bar.high, &bar.low, &bar.close, &bar.volume};
+    bool fill = rules_.policy == QualityPolicy::ForwardFill || (f & (kNonPositive | kNonFinite));
+    if (fill) {
+        if (!have_prev_) {
+            ++report_.dropped;
+            return false;
+        }
+        for (int c = 0; c < 5; ++c) *v[c] = prev_[c];
+    } else {
+        if (f & kPriceGap) {
+            double lo = prev_[3] * (1.0 - rules_.max_gap), hi = prev_[3] * (1.0 + rules_.max_gap);
+            for (int c = 0; c < 4; ++c) {
+                if (columns_ & (1u << c)) *v[c] = min(max(*v[c], lo), hi);
+            }
+        }
+        if ((columns_ & kHigh) && (columns_ & kLow)) {
+            double top = max(bar.high, bar.low), bottom = min(bar.high, bar.low);
+            for (int c : {0, 3}) {
+                if (columns_ & (1u << c)) {
+                    top = max(top, *v[c]);
+                    bottom = min(bottom, *v[c]);
+                }
+            }
+            bar.high = top;
+            bar.low = bottom;
+        }
+        if (f & kVolumeSpike) bar.volume = rules_.volume_spike * volume_avg_;
+    }
+    ++report_.repaired;
+    accept(bar);
+    return true;
+}
+
+QualityReport check_bars(vector<Bar>& bars, const QualityRules& rules, unsigned columns) {
+    QualityChecker checker(rules, columns);
+    size_t kept = 0;
+    for (size_t i = 0; i < bars.size(); ++i) {
+        if (!checker.check(bars[i])) continue;
+        if (kept != i) bars[kept] = move(bars[i]);
+        ++kept;
+    }
+    bars.resize(kept);
+    return checker.report();
+}
+
+QualityPolicy parse_quality_policy(const string& name) {
+    if (name == "off") return QualityPolicy::Off;
+    if (name == "flag") return QualityPolicy::Flag;
+    if (name == "drop") return QualityPolicy::Drop;
+    if (name == "clamp") return QualityPolicy::Clamp;
+    if (name == "ffill") return QualityPolicy::ForwardFill;
+    throw invalid_argument("quality policy must be flag, drop, clamp or ffill: " + name);
+}
+
+} // namespace sp
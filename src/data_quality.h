@@ -0,0 +1,91 @@
+// row-level data-quality rules for loaded bars, checked one row at a time as the loader
+// produces them, with a policy for what happens to a flagged row
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+struct Bar;
+
+// bits of a row's flags; a row can break several rules
+enum QualityRule : unsigned {
+    kNonPositive = 1u << 0,   // a price <= 0 or a negative volume
+    kNonFinite = 1u << 1,     // a loaded column is inf or nan
+    kHighBelowLow = 1u << 2,
+    kPriceGap = 1u << 3,      // open or close too far from the previous close
+    kVolumeSpike = 1u << 4,   // volume too far above its recent average
+    kQualityRuleCount = 5
+};
+
+// Off: no checks. Flag: report only, rows pass unchanged. Drop: flagged rows are removed.
+// Clamp: prices are pulled into the allowed gap band and high/low widened to cover
+// open and close, volume capped at the spike limit; a row with no usable price is
+// forward filled instead. ForwardFill: a flagged row repeats the previous good row's
+// prices and volume under its own date. a flagged first row has nothing to repeat and
+// is dropped by Clamp and ForwardFill
+enum class QualityPolicy : uint8_t { Off, Flag, Drop, Clamp, ForwardFill };
+
+struct QualityRules {
+    QualityPolicy policy = QualityPolicy::Off;
+    double max_gap = 0.5;        // |price / previous close - 1|; 0 disables the rule
+    double volume_spike = 20.0;  // multiple of the average volume; 0 disables the rule
+    size_t volume_window = 20;   // rows averaged (exponentially) before spikes are checked
+    // consecutive gap rows within max_gap of each other that make a new price level (a
+    // split in unadjusted data); the last of them is accepted and later gaps are measured
+    // from it. 0 keeps measuring from the old level
+    size_t reanchor_rows = 3;
+};
+
+struct QualityReport {
+    size_t rows = 0;       // rows checked
+    size_t flagged = 0;
+    size_t dropped = 0;
+    size_t repaired = 0;   // clamped or forward filled
+    size_t rule_counts[kQualityRuleCount] = {};
+    std::vector<uint64_t> flagged_rows;  // bit i: the i-th checked row broke a rule
+
+    bool is_flagged(size_t row) const {
+        return row / 64 < flagged_rows.size() && (flagged_rows[row / 64] >> (row % 64)) & 1;
+    }
+};
+
+// the rules carry state between rows (previous close, average volume), so rows must be
+// checked in time order. gaps are measured against the last row that passed or was
+// repaired, so one bad print does not also flag the row after it, until reanchor_rows
+// gap rows in a row agree on a new level. only loaded columns (LoadOptions::columns)
+// are checked
+class QualityChecker {
+public:
+    QualityChecker(const QualityRules& rules, unsigned columns);
+
+    // checks and, per the policy, repairs the next row; false if it is dropped
+    bool check(Bar& bar);
+
+    const QualityReport& report() const { return report_; }
+
+private:
+    QualityRules rules_;
+    unsigned columns_;
+    QualityReport report_;
+    bool have_prev_ = false;
+    double prev_[5] = {};       // last good open, high, low, close, volume
+    double volume_avg_ = 0.0;
+    size_t volume_rows_ = 0;
+    size_t gap_run_ = 0;          // consecutive gap rows on one level
+    double last_raw_close_ = 0.0; // close of the previous row as it was loaded
+
+    unsigned flags(const Bar& bar) const;
+    void accept(const Bar& bar);
+};
+
+// checks bars already in memory, in order, removing dropped rows
+QualityReport check_bars(std::vector<Bar>& bars, const QualityRules& rules, unsigned columns);
+
+// "flag", "drop", "clamp", "ffill" (or "off"); throws invalid_argument
+QualityPolicy parse_quality_policy(const std::string& name);
+
+} // namespace sp
@@ -0,0 +1,228 @@
+// randomized range finder + power iterations, then an exact SVD of the small projected matrix
+
+#include "factor_model.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const size_t kRowBlock = 256;
+const size_t kColBlock = 64;
+
+// T x N and T x l panels, big enough to be worth huge pages
+using Buffer = huge_vector<double>;
+
+// Y (T x l) = A (T x N) * M (N x l), all column-major; threads own row blocks of Y
+void mul_a(const Buffer& A, size_t T, size_t N, const Buffer& M, size_t l,
+           Buffer& Y, unsigned threads) {
+    Y.assign(T * l, 0.0);
+    size_t blocks = (T + kRowBlock - 1) / kRowBlock;
+    parallel_for(blocks, [&](size_t b) {
+        size_t t0 = b * kRowBlock, t1 = min(T, t0 + kRowBlock);
+        for (size_t j = 0; j < N; ++j) {
+            const double* a = &A[j * T];
+            for (size_t c = 0; c < l; ++c) {
+                double m = M[c * N + j];
+                double* y = &Y[c * T];
+                for (size_t t = t0; t < t1; ++t) y[t] += a[t] * m;
+            }
+        }
+    }, threads);
+}
+
+// Z (N x l) = A^T * Q (T x l); threads own symbol blocks, rows walked in chunks
+void mul_at(const Buffer& A, size_t T, size_t N, const Buffer& Q, size_t l,
+            Buffer& Z, unsigned threads) {
+    Z.assign(N * l, 0.0);
+    size_t blocks = (N + kColBlock - 1) / kColBlock;
+    parallel_for(blocks, [&](size_t b) {
+        size_t j0 = b * kColBlock, j1 = min(N, j0 + kColBlock);
+        for (size_t t0 = 0; t0 < T; t0 += kRowBlock) {
+            size_t t1 = min(T, t0 + kRowBlock);
+            for (size_t j = j0; j < j1; ++j) {
+                const double* a = &A[j * T];
+                for (size_t c = 0; c < l; ++c) {
+                    const double* q = &Q[c * T];
+                    double s = 0.0;
+                    for (size_t t = t0; t < t1; ++t) s += a[t] * q[t];
+                    Z[c * N + j] += s;
+                }
+            }
+        }
+    }, threads);
+}
+
+// modified gram-schmidt, applied twice for stability; degenerate columns become zero
+void orthonormalize(Buffer& M, size_t rows, size_t cols) {
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t c = 0; c < cols; ++c) {
+            double* v = &M[c * rows];
+            for (size_t p = 0; p < c; ++p) {
+                const double* u = &M[p * rows];
+                double d = 0.0;
+                for (size_t i = 0; i < rows; ++i) d += u[i] * v[i];
+                for (size_t i = 0; i < rows; ++i) v[i] -= d * u[i];
+            }
+            double norm2 = 0.0;
+            for (size_t i = 0; i < rows; ++i) norm2 += v[i] * v[i];
+            double inv = norm2 > 1e-300 ? 1.0 / sqrt(norm2) : 0.0;
+            for (size_t i = 0; i < rows; ++i) v[i] *= inv;
+        }
+    }
+}
+
+// cyclic jacobi on a small symmetric matrix (row-major), eigenvectors in columns of V
+void jacobi_eigen(vector<double> S, size_t n, vector<double>& values, vector<double>& V) {
+    V.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) V[i * n + i] = 1.0;
+    for (int sweep = 0; sweep < 100; ++sweep) {
+        double off = 0.0;
+        for (size_t p = 0; p < n; ++p)
+            for (size_t q = p + 1; q < n; ++q) off += S[p * n + q] * S[p * n + q];
+        if (off < 1e-30) break;
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                double apq = S[p * n + q];
+                if (fabs(apq) < 1e-300) continue;
+                double theta = (S[q * n + q] - S[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0), s = t * c;
+                for (size_t k = 0; k < n; ++k) {
+                    double skp = S[k * n + p], skq = S[k * n + q];
+                    S[k * n + p] = c * skp - s * skq;
+                    S[k * n + q] = s * skp + c * skq;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    double spk = S[p * n + k], sqk = S[q * n + k];
+                    S[p * n + k] = c * spk - s * sqk;
+                    S[q * n + k] = s * spk + c * sqk;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    double vkp = V[k * n + p], vkq = V[k * n + q];
+                    V[k * n + p] = c * vkp - s * vkq;
+                    V[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    values.resize(n);
+    for (size_t i = 0; i < n; ++i) values[i] = S[i * n + i];
+}
+
+} // namespace
+
+FactorModel::FactorModel(int n_factors, int oversample, int power_iters, unsigned threads, uint64_t seed)
+    : k_(n_factors), oversample_(oversample), power_iters_(power_iters),
+      threads_(threads == 0 ? default_threads() : threads), seed_(seed) {
+    if (n_factors <= 0) throw invalid_argument("n_factors must be positive");
+}
+
+bool FactorModel::fit(const double* returns, size_t rows, size_t n_symbols, size_t ld, size_t fit_rows) {
+    fitted_ = false;
+    size_t T = fit_rows ? min(fit_rows, rows) : rows, N = n_symbols;
+    if (T < 2 || N == 0 || ld < rows) return false;
+    size_t l = min<size_t>(k_ + max(oversample_, 0), min(T, N));
+    if (l < static_cast<size_t>(k_)) return false;
+
+    // demeaned copy of the fitted rows
+    Buffer A(T * N);
+    vector<double> means(N);
+    parallel_for(N, [&](size_t j) {
+        const double* col = returns + j * ld;
+        double mu = 0.0;
+        for (size_t t = 0; t < T; ++t) mu += col[t];
+        mu /= T;
+        means[j] = mu;
+        for (size_t t = 0; t < T; ++t) A[j * T + t] = col[t] - mu;
+    }, threads_);
+
+    // gaussian test matrix, then range finder Q = orth(A * omega)
+    Buffer omega(N * l);
+    mt19937_64 rng(seed_);
+    normal_distribution<double> gauss(0.0, 1.0);
+    for (auto& v : omega) v = gauss(rng);
+
+    Buffer Q, Z;
+    mul_a(A, T, N, omega, l, Q, threads_);
+    orthonormalize(Q, T, l);
+    for (int it = 0; it < power_iters_; ++it) {
+        mul_at(A, T, N, Q, l, Z, threads_);
+        orthonormalize(Z, N, l);
+        mul_a(A, T, N, Z, l, Q, threads_);
+        orthonormalize(Q, T, l);
+    }
+
+    // B = Q^T A = Z^T with Z = A^T Q; eigen of B B^T = Z^T Z gives the small SVD
+    mul_at(A, T, N, Q, l, Z, threads_);
+    vector<double> G(l * l, 0.0);
+    for (size_t a = 0; a < l; ++a) {
+        for (size_t b = a; b < l; ++b) {
+            double s = 0.0;
+            for (size_t j = 0; j < N; ++j) s += Z[a * N + j] * Z[b * N + j];
+            G[a * l + b] = G[b * l + a] = s;
+        }
+    }
+    vector<double> eig, W;
+    jacobi_eigen(G, l, eig, W);
+    vector<size_t> order(l);
+    for (size_t i = 0; i < l; ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return eig[a] > eig[b]; });
+
+    rows_ = rows;
+    n_ = N;
+    factors_.assign(k_ * rows, 0.0);
+    loadings_.assign(N * k_, 0.0);
+    variance_.assign(k_, 0.0);
+    for (int f = 0; f < k_; ++f) {
+        size_t e = order[f];
+        double sigma = sqrt(max(eig[e], 0.0));
+        variance_[f] = sigma * sigma / (T - 1);
+        // factor returns U * sigma = Q * w, loadings V = Z * w / sigma
+        for (size_t c = 0; c < l; ++c) {
+            double w = W[c * l + e];
+            for (size_t t = 0; t < T; ++t) factors_[f * rows + t] += Q[c * T + t] * w * sigma;
+            if (sigma > 0.0) {
+                for (size_t j = 0; j < N; ++j) loadings_[j * k_ + f] += Z[c * N + j] * w / sigma;
+            }
+        }
+    }
+    // later rows: demeaned returns times the loadings, as U * sigma = A * V in the span
+    parallel_for(static_cast<size_t>(k_), [&](size_t f) {
+        double* out = &factors_[f * rows];
+        for (size_t j = 0; j < N; ++j) {
+            const double* col = returns + j * ld;
+            double v = loadings_[j * k_ + f];
+            for (size_t t = T; t < rows; ++t) out[t] += (col[t] - means[j]) * v;
+        }
+    }, threads_);
+    fitted_ = true;
+    return true;
+}
+
+void FactorModel::append_features(FeatureEngineer& engineer, size_t symbol,
+                                  size_t row_offset, size_t n_bars) const {
+    if (!fitted_) {
+        throw runtime_error("Factor model not fitted");
+    }
+    if (symbol >= n_) {
+        throw out_of_range("symbol index out of range");
+    }
+    vector<double> fit(n_bars, NAN);
+    for (int f = 0; f < k_; ++f) {
+        vector<double> col(n_bars, NAN);
+        for (size_t i = row_offset; i < n_bars && i - row_offset < rows_; ++i) {
+            col[i] = factor_return(i - row_offset, f);
+            fit[i] = (f == 0 ? 0.0 : fit[i]) + loading(symbol, f) * col[i];
+        }
+        engineer.add_external_column("factor_" + to_string(f + 1) + "_return", move(col));
+    }
+    engineer.add_external_column("factor_fit", move(fit));
+}
+
+} // namespace sp
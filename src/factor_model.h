@@ -0,0 +1,56 @@
+// statistical factor model: top-k principal components of a returns panel via randomized SVD
+
+#pragma once
+#include "feature_engineer.h"
+#include "huge_pages.h"
+#include <cstdint>
+#include <vector>
+
+namespace sp {
+
+class FactorModel {
+public:
+    // oversample extra directions and power_iters subspace passes trade time for accuracy
+    explicit FactorModel(int n_factors, int oversample = 10, int power_iters = 2,
+                         unsigned threads = 0, uint64_t seed = 1);
+
+    // column-major panel like CorrelationEngine: symbol j's returns at returns + j * ld.
+    // returns are demeaned per symbol before the decomposition. with fit_rows > 0 only the
+    // first fit_rows rows (the training span) are decomposed and the rest are projected on
+    // those means and loadings, so factor values past the span never see later returns
+    bool fit(const double* returns, size_t rows, size_t n_symbols, size_t ld, size_t fit_rows = 0);
+
+    int n_factors() const { return k_; }
+    size_t rows() const { return rows_; }
+    size_t symbols() const { return n_; }
+
+    // factor f's return at time t (principal component score, projected past fit_rows)
+    double factor_return(size_t t, size_t f) const { return factors_[f * rows_ + t]; }
+    // exposure of a symbol to factor f (unit-norm right singular vector)
+    double loading(size_t symbol, size_t f) const { return loadings_[symbol * k_ + f]; }
+    // variance explained by each factor over the fitted rows
+    const std::vector<double>& explained_variance() const { return variance_; }
+
+    // adds factor_K_return columns and the symbol's factor_fit (sum of loading * factor)
+    // to the engineer; panel row t maps to bar t + row_offset, other bars get NaN
+    void append_features(FeatureEngineer& engineer, size_t symbol,
+                         size_t row_offset, size_t n_bars) const;
+
+    bool is_fitted() const { return fitted_; }
+
+private:
+    int k_;
+    int oversample_;
+    int power_iters_;
+    unsigned threads_;
+    uint64_t seed_;
+
+    size_t rows_ = 0;
+    size_t n_ = 0;
+    huge_vector<double> factors_;   // k x T, factor-major
+    huge_vector<double> loadings_;  // N x k, symbol-major
+    std::vector<double> variance_;
+    bool fitted_ = false;
+};
+
+} // namespace sp
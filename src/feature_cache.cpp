@@ -0,0 +1,193 @@
+// feature matrices stored as flat binary files that can be mapped straight back in
+
+#include "feature_cache.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t kFeatureVersion = 2;  // 2: rows with inf features or targets are dropped
+const char kMagic[8] = {'S', 'P', 'F', 'E', 'A', 'T', '1', '\0'};
+
+struct CacheHeader {
+    char magic[8];
+    uint64_t key;
+    uint64_t rows;
+    uint64_t cols;
+    char pad[32];
+};
+static_assert(sizeof(CacheHeader) == 64, "cache header must stay 64 bytes");
+
+} // namespace
+
+namespace {
+
+void hash_config(XXHash64& h, const FeatureEngineer& engineer, int prediction_horizon) {
+    const FeatureConfig& c = engineer.config();
+    for (bool flag : {c.use_returns, c.use_lagged_prices, c.use_sma, c.use_ema,
+                      c.use_rsi, c.use_volume, c.use_spectral}) {
+        h.update_value(static_cast<uint8_t>(flag));
+    }
+    for (int v : {c.lag_days, c.sma_period, c.ema_period, c.rsi_period,
+                  c.spectral_window, c.spectral_hop, c.spectral_bands}) {
+        h.update_value(v);
+    }
+    uint64_t lags = c.acf_lags.size();
+    h.update_value(lags);
+    for (int lag : c.acf_lags) h.update_value(lag);
+
+    for (const auto& col : engineer.external_columns()) {
+        h.update(col.first);
+        h.update(col.second.data(), col.second.size() * sizeof(double));
+    }
+    h.update_value(prediction_horizon);
+}
+
+} // namespace
+
+uint64_t feature_cache_key(const vector<Bar>& bars, const FeatureEngineer& engineer,
+                           int prediction_horizon) {
+    XXHash64 h(kFeatureVersion);
+    uint64_t n = bars.size();
+    h.update_value(n);
+    for (const auto& b : bars) {
+        h.update(b.date);
+        h.update_value(b.open);
+        h.update_value(b.high);
+        h.update_value(b.low);
+        h.update_value(b.close);
+        h.update_value(b.volume);
+    }
+    hash_config(h, engineer, prediction_horizon);
+    return h.digest();
+}
+
+uint64_t feature_config_key(const FeatureEngineer& engineer, int prediction_horizon) {
+    XXHash64 h(kFeatureVersion);
+    hash_config(h, engineer, prediction_horizon);
+    return h.digest();
+}
+
+FeatureCache::FeatureCache(const string& dir, uint64_t max_bytes)
+    : dir_(dir), max_bytes_(max_bytes) {
+    fs::create_directories(dir_);
+}
+
+string FeatureCache::path_for(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.spf", static_cast<unsigned long long>(key));
+    return (fs::path(dir_) / name).string();
+}
+
+bool FeatureCache::lookup(uint64_t key, vector<vector<double>>& features,
+                          vector<double>& targets) const {
+    string path = path_for(key);
+    error_code ec;
+    if (!fs::exists(path, ec)) return false;
+
+    try {
+        MappedFile file(path);
+        if (file.size() < sizeof(CacheHeader)) return false;
+        CacheHeader h;
+        memcpy(&h, file.data(), sizeof(h));
+        if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.key != key) return false;
+        size_t rows = h.rows, cols = h.cols;
+        if (file.size() != sizeof(CacheHeader) + (rows * cols + rows) * sizeof(double)) return false;
+
+        const char* p = file.data() + sizeof(CacheHeader);
+        features.assign(rows, vector<double>(cols));
+        for (size_t i = 0; i < rows; ++i) {
+            memcpy(features[i].data(), p + i * cols * sizeof(double), cols * sizeof(double));
+        }
+        targets.resize(rows);
+        memcpy(targets.data(), p + rows * cols * sizeof(double), rows * sizeof(double));
+    } catch (const exception&) {
+        return false;
+    }
+
+    // mtime doubles as the LRU timestamp
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void FeatureCache::store(uint64_t key, const vector<vector<double>>& features,
+                         const vector<double>& targets) {
+    if (features.size() != targets.size()) {
+        throw invalid_argument("Features and targets size mismatch");
+    }
+    size_t cols = features.empty() ? 0 : features[0].size();
+    for (const auto& f : features) {
+        if (f.size() != cols) throw invalid_argument("Inconsistent feature dimensions");
+    }
+
+    string path = path_for(key);
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) throw runtime_error("failed to open the file: " + tmp);
+        CacheHeader h{};
+        memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.key = key;
+        h.rows = features.size();
+        h.cols = cols;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        for (const auto& f : features) {
+            out.write(reinterpret_cast<const char*>(f.data()), cols * sizeof(double));
+        }
+        out.write(reinterpret_cast<const char*>(targets.data()), targets.size() * sizeof(double));
+        if (!out) throw runtime_error("failed to write the file: " + tmp);
+    }
+    // readers never see a half written entry
+    fs::rename(tmp, path);
+    evict();
+}
+
+pair<vector<vector<double>>, vector<double>>
+FeatureCache::get_or_create(FeatureEngineer& engineer, const vector<Bar>& bars,
+                            int prediction_horizon, bool* hit) {
+    uint64_t key = feature_cache_key(bars, engineer, prediction_horizon);
+    vector<vector<double>> features;
+    vector<double> targets;
+    if (lookup(key, features, targets)) {
+        if (hit) *hit = true;
+        return {features, targets};
+    }
+    if (hit) *hit = false;
+    auto result = engineer.create_features(bars, prediction_horizon);
+    if (!result.first.empty()) store(key, result.first, result.second);
+    return result;
+}
+
+void FeatureCache::evict() {
+    if (max_bytes_ == 0) return;
+    struct Entry { fs::path path; fs::file_time_type time; uint64_t size; };
+    vector<Entry> entries;
+    uint64_t total = 0;
+    error_code ec;
+    for (const auto& e : fs::directory_iterator(dir_, ec)) {
+        if (!e.is_regular_file(ec) || e.path().extension() != ".spf") continue;
+        uint64_t size = e.file_size(ec);
+        entries.push_back({e.path(), e.last_write_time(ec), size});
+        total += size;
+    }
+    if (total <= max_bytes_) return;
+
+    sort(entries.begin(), entries.end(),
+         [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const auto& e : entries) {
+        if (total <= max_bytes_) break;
+        if (fs::remove(e.path, ec)) total -= e.size;
+    }
+}
+
+} // namespace sp
@@ -0,0 +1,47 @@
+// on-disk cache of feature matrices keyed by a hash of the bars, config and horizon
+
+#pragma once
+#include "csv_loader.h"
+#include "feature_engineer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+// hash of everything create_features depends on; bump kFeatureVersion in the
+// .cpp whenever feature code changes so stale entries stop matching
+uint64_t feature_cache_key(const std::vector<Bar>& bars, const FeatureEngineer& engineer,
+                           int prediction_horizon);
+
+// the same without the bars: changes only when the feature code or configuration does
+uint64_t feature_config_key(const FeatureEngineer& engineer, int prediction_horizon);
+
+class FeatureCache {
+public:
+    // entries live as <dir>/<key>.spf; least recently used files are evicted
+    // once the directory grows past max_bytes (0 = unbounded)
+    explicit FeatureCache(const std::string& dir, uint64_t max_bytes = 256ull << 20);
+
+    // maps the entry and copies it out; refreshes its LRU position on a hit
+    bool lookup(uint64_t key, std::vector<std::vector<double>>& features,
+                std::vector<double>& targets) const;
+
+    void store(uint64_t key, const std::vector<std::vector<double>>& features,
+               const std::vector<double>& targets);
+
+    // create_features through the cache
+    std::pair<std::vector<std::vector<double>>, std::vector<double>>
+    get_or_create(FeatureEngineer& engineer, const std::vector<Bar>& bars,
+                  int prediction_horizon, bool* hit = nullptr);
+
+    std::string path_for(uint64_t key) const;
+
+private:
+    std::string dir_;
+    uint64_t max_bytes_;
+
+    void evict();
+};
+
+} // namespace sp
@@ -1,132 +1,223 @@
 // builds feature vectors from price history for training
 
 #include "feature_engineer.h"
+#include "spectral.h"
+#include "adjustments.h"
+#include "task_graph.h"
 #include <cmath>
 #include <algorithm>
+#include <iterator>
 #include <numeric>
+#include <stdexcept>
 
 namespace sp {
 using namespace std;
 
+namespace {
+// feature rows built per task
+constexpr size_t kRowBlock = 8192;
+}
+
 FeatureEngineer::FeatureEngineer() : config_() {}
 
 FeatureEngineer::FeatureEngineer(const FeatureConfig& config) : config_(config) {}
 
 pair<vector<vector<double>>, vector<double>>
 FeatureEngineer::create_features(const vector<Bar>& bars, int prediction_horizon) {
-    if (bars.size() < static_cast<size_t>(config_.lag_days + prediction_horizon + 50)) {
-        return {{}, {}};
-    }
-    vector<vector<double>> features;
-    vector<double> targets;
-    
-    // extract closing prices for indicator calculations
-    vector<double> closes;
+    return create_features(bars, prediction_horizon, 0, nullptr);
+}
+
+pair<vector<vector<double>>, vector<double>>
+FeatureEngineer::create_features(const vector<Bar>& bars, int prediction_horizon,
+                                 size_t first_bar, vector<size_t>* bar_index) {
+    vector<double> closes, volumes;
     closes.reserve(bars.size());
+    volumes.reserve(bars.size());
     for (const auto& bar : bars) {
         closes.push_back(bar.close);
+        volumes.push_back(bar.volume);
     }
-    
-    // precompute all indicators once
+    return build_rows(closes, volumes, prediction_horizon, first_bar, bar_index);
+}
+
+pair<vector<vector<double>>, vector<double>>
+FeatureEngineer::create_features(const AdjustedView& bars, int prediction_horizon,
+                                 size_t first_bar, vector<size_t>* bar_index) {
+    return build_rows(bars.column(kClose), bars.column(kVolume), prediction_horizon, first_bar, bar_index);
+}
+
+pair<vector<vector<double>>, vector<double>>
+FeatureEngineer::build_rows(const vector<double>& closes, const vector<double>& volumes,
+                            int prediction_horizon, size_t first_bar, vector<size_t>* bar_index) {
+    size_t n = closes.size();
+    if (bar_index) bar_index->clear();
+    if (n < static_cast<size_t>(config_.lag_days + prediction_horizon + 50)) {
+        return {{}, {}};
+    }
+    for (const auto& col : external_) {
+        if (col.second.size() != n) {
+            throw invalid_argument("External column size mismatch: " + col.first);
+        }
+    }
+    // precompute all indicators once, each its own task
+    TaskGraph graph;
+    vector<TaskGraph::Task> indicators;
     vector<double> sma_values, ema_values, rsi_values;
     if (config_.use_sma) {
-        SMAIndicator sma(config_.sma_period);
-        sma_values = sma.compute(closes);
+        indicators.push_back(graph.add([&] {
+            SMAIndicator sma(config_.sma_period);
+            sma_values = sma.compute(closes);
+        }));
     }
     if (config_.use_ema) {
-        EMAIndicator ema(config_.ema_period);
-        ema_values = ema.compute(closes);
+        indicators.push_back(graph.add([&] {
+            EMAIndicator ema(config_.ema_period);
+            ema_values = ema.compute(closes);
+        }));
     }
     if (config_.use_rsi) {
-        RSIIndicator rsi(config_.rsi_period);
-        rsi_values = rsi.compute(closes);
+        indicators.push_back(graph.add([&] {
+            RSIIndicator rsi(config_.rsi_period);
+            rsi_values = rsi.compute(closes);
+        }));
+    }
+    // spectral columns are indexed by return, return j is bar j + 1
+    SpectralColumns spectral;
+    if (config_.use_spectral) {
+        indicators.push_back(graph.add([&] {
+            vector<double> rets(closes.size() - 1);
+            for (size_t j = 0; j + 1 < closes.size(); ++j) {
+                rets[j] = (closes[j + 1] - closes[j]) / closes[j];
+            }
+            spectral = rolling_spectral(rets, config_.spectral_window, config_.spectral_hop,
+                                        config_.acf_lags, config_.spectral_bands);
+        }));
     }
     
     // skip early days where we don't have enough history
-    size_t start_idx = max(config_.lag_days, 50);
-    size_t end_idx = bars.size() - prediction_horizon;
+    size_t start_idx = max<size_t>(max(config_.lag_days, 50), first_bar);
+    size_t end_idx = n - prediction_horizon;
     
-    // build feature vector for each day
-    for (size_t i = start_idx; i < end_idx; ++i) {
-        vector<double> feature_vec;
+    // each block of days fills its own rows once every indicator is ready; the blocks
+    // are concatenated in order, so the rows match a single sequential pass
+    struct Rows {
+        vector<vector<double>> features;
+        vector<double> targets;
+        vector<size_t> bar_index;
+    };
+    size_t blocks = start_idx < end_idx ? (end_idx - start_idx + kRowBlock - 1) / kRowBlock : 0;
+    vector<Rows> parts(blocks);
+    auto build_block = [&](size_t b) {
+        Rows& out = parts[b];
+        size_t block_end = min(end_idx, start_idx + (b + 1) * kRowBlock);
+    
+        // build feature vector for each day
+        for (size_t i = start_idx + b * kRowBlock; i < block_end; ++i) {
+            vector<double> feature_vec;
         
-        // add price returns for last N days
-        if (config_.use_returns) {
-            for (int lag = 1; lag <= config_.lag_days; ++lag) {
-                double ret = (bars[i].close - bars[i - lag].close) / bars[i - lag].close;
-                feature_vec.push_back(ret);
+            // add price returns for last N days
+            if (config_.use_returns) {
+                for (int lag = 1; lag <= config_.lag_days; ++lag) {
+                    double ret = (closes[i] - closes[i - lag]) / closes[i - lag];
+                    feature_vec.push_back(ret);
+                }
             }
-        }
         
-        // add historical prices normalized by current price
-        if (config_.use_lagged_prices) {
-            for (int lag = 1; lag <= config_.lag_days; ++lag) {
-                double normalized = bars[i - lag].close / bars[i].close;
-                feature_vec.push_back(normalized);
+            // add historical prices normalized by current price
+            if (config_.use_lagged_prices) {
+                for (int lag = 1; lag <= config_.lag_days; ++lag) {
+                    double normalized = closes[i - lag] / closes[i];
+                    feature_vec.push_back(normalized);
+                }
             }
-        }
         
-        // add technical indicators
-        if (config_.use_sma && !isnan(sma_values[i])) {
-            feature_vec.push_back(sma_values[i] / bars[i].close);
-        }
-        if (config_.use_ema && !isnan(ema_values[i])) {
-            feature_vec.push_back(ema_values[i] / bars[i].close);
-        }
-        if (config_.use_rsi && !isnan(rsi_values[i])) {
-            feature_vec.push_back(rsi_values[i] / 100.0);
-        }
+            // add technical indicators
+            if (config_.use_sma && !isnan(sma_values[i])) {
+                feature_vec.push_back(sma_values[i] / closes[i]);
+            }
+            if (config_.use_ema && !isnan(ema_values[i])) {
+                feature_vec.push_back(ema_values[i] / closes[i]);
+            }
+            if (config_.use_rsi && !isnan(rsi_values[i])) {
+                feature_vec.push_back(rsi_values[i] / 100.0);
+            }
         
-        // add volume features
-        if (config_.use_volume) {
-            if (i > 0 && bars[i - 1].volume > 0) {
-                double vol_change = (bars[i].volume - bars[i - 1].volume) / bars[i - 1].volume;
-                feature_vec.push_back(vol_change);
-            } else {
-                feature_vec.push_back(0.0);
+            // add volume features
+            if (config_.use_volume) {
+                if (i > 0 && volumes[i - 1] > 0) {
+                    double vol_change = (volumes[i] - volumes[i - 1]) / volumes[i - 1];
+                    feature_vec.push_back(vol_change);
+                } else {
+                    feature_vec.push_back(0.0);
+                }
+                double avg_vol = 0.0;
+                for (int lag = 1; lag <= 5 && i >= static_cast<size_t>(lag); ++lag) {
+                    avg_vol += volumes[i - lag];
+                }
+                avg_vol /= 5.0;
+                if (avg_vol > 0) {
+                    feature_vec.push_back(volumes[i] / avg_vol);
+                } else {
+                    feature_vec.push_back(1.0);
+                }
             }
-            double avg_vol = 0.0;
+        
+            // calculate 5-day volatility
+            vector<double> recent_returns;
             for (int lag = 1; lag <= 5 && i >= static_cast<size_t>(lag); ++lag) {
-                avg_vol += bars[i - lag].volume;
+                double ret = (closes[i - lag + 1] - closes[i - lag]) / closes[i - lag];
+                recent_returns.push_back(ret);
             }
-            avg_vol /= 5.0;
-            if (avg_vol > 0) {
-                feature_vec.push_back(bars[i].volume / avg_vol);
-            } else {
-                feature_vec.push_back(1.0);
+            if (!recent_returns.empty()) {
+                double mean_ret = accumulate(recent_returns.begin(), recent_returns.end(), 0.0) 
+                                / recent_returns.size();
+                double variance = 0.0;
+                for (double r : recent_returns) {
+                    variance += (r - mean_ret) * (r - mean_ret);
+                }
+                variance /= recent_returns.size();
+                feature_vec.push_back(std::sqrt(variance));
             }
-        }
         
-        // calculate 5-day volatility
-        vector<double> recent_returns;
-        for (int lag = 1; lag <= 5 && i >= static_cast<size_t>(lag); ++lag) {
-            double ret = (bars[i - lag + 1].close - bars[i - lag].close) / bars[i - lag].close;
-            recent_returns.push_back(ret);
-        }
-        if (!recent_returns.empty()) {
-            double mean_ret = accumulate(recent_returns.begin(), recent_returns.end(), 0.0) 
-                            / recent_returns.size();
-            double variance = 0.0;
-            for (double r : recent_returns) {
-                variance += (r - mean_ret) * (r - mean_ret);
+            if (config_.use_spectral) {
+                for (const auto& col : spectral.acf) feature_vec.push_back(col[i - 1]);
+                for (const auto& col : spectral.band_power) feature_vec.push_back(col[i - 1]);
+            }
+        
+            for (const auto& col : external_) {
+                feature_vec.push_back(col.second[i]);
             }
-            variance /= recent_returns.size();
-            feature_vec.push_back(std::sqrt(variance));
-        }
         
-        double target_price = bars[i + prediction_horizon].close;
+            double target_price = closes[i + prediction_horizon];
         
-        // skip if any feature is NaN
-        bool has_nan = false;
-        for (double val : feature_vec) {
-            if (isnan(val)) { has_nan = true; break; }
-        }
-        if (!has_nan) {
-            features.push_back(feature_vec);
-            targets.push_back(target_price);
+            // skip if any feature is NaN or inf (a zero close or volume divides to inf)
+            bool bad = !isfinite(target_price);
+            for (double val : feature_vec) {
+                if (!isfinite(val)) { bad = true; break; }
+            }
+            if (!bad) {
+                out.features.push_back(move(feature_vec));
+                out.targets.push_back(target_price);
+                if (bar_index) out.bar_index.push_back(i);
+            }
         }
+    };
+    graph.add_range(blocks, build_block, indicators);
+    graph.run(n < 2 * kRowBlock ? 1 : config_.threads);
+
+    vector<vector<double>> features;
+    vector<double> targets;
+    size_t rows = 0;
+    for (const auto& part : parts) rows += part.targets.size();
+    features.reserve(rows);
+    targets.reserve(rows);
+    if (bar_index) bar_index->reserve(rows);
+    for (auto& part : parts) {
+        move(part.features.begin(), part.features.end(), back_inserter(features));
+        targets.insert(targets.end(), part.targets.begin(), part.targets.end());
+        if (bar_index) bar_index->insert(bar_index->end(), part.bar_index.begin(), part.bar_index.end());
     }
-    return {features, targets};
+    return {move(features), move(targets)};
 }
 
 tuple<vector<vector<double>>, vector<double>,
@@ -157,6 +248,10 @@ int FeatureEngineer::get_feature_count() const {
     if (config_.use_rsi) count += 1;
     if (config_.use_volume) count += 2;  // volume change + volume ratio
     count += 1;  // volatility
+    if (config_.use_spectral) {
+        count += static_cast<int>(config_.acf_lags.size()) + config_.spectral_bands;
+    }
+    count += static_cast<int>(external_.size());
     
     return count;
 }
@@ -187,7 +282,28 @@ vector<string> FeatureEngineer::get_feature_names() const {
     
     names.push_back("volatility_5d");
     
+    if (config_.use_spectral) {
+        for (int lag : config_.acf_lags) {
+            names.push_back("acf_lag_" + to_string(lag));
+        }
+        for (int b = 0; b < config_.spectral_bands; ++b) {
+            names.push_back("spectral_band_" + to_string(b + 1));
+        }
+    }
+    
+    for (const auto& col : external_) {
+        names.push_back(col.first);
+    }
+    
     return names;
 }
 
+void FeatureEngineer::add_external_column(const string& name, vector<double> values) {
+    external_.emplace_back(name, move(values));
+}
+
+void FeatureEngineer::clear_external_columns() {
+    external_.clear();
+}
+
 } 
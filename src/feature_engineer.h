@@ -5,9 +5,12 @@
 #include "indicator.h"
 #include <vector>
 #include <memory>
+#include <string>
 
 namespace sp {
 
+class AdjustedView;
+
 // controls which features to generate
 struct FeatureConfig {
     bool use_returns = true;
@@ -16,11 +19,22 @@ struct FeatureConfig {
     bool use_ema = true;
     bool use_rsi = true;
     bool use_volume = true;
+    bool use_spectral = false;
     
     int lag_days = 5;
     int sma_period = 20;
     int ema_period = 12;
     int rsi_period = 14;
+
+    // rolling autocorrelation / band power of daily returns, refreshed every hop days
+    int spectral_window = 256;
+    int spectral_hop = 16;
+    int spectral_bands = 4;
+    std::vector<int> acf_lags = {1, 5, 20};
+
+    // workers for one series (task_graph.h): indicators run side by side, then blocks of
+    // rows. 0 = one per core; series shorter than two blocks are built inline
+    unsigned threads = 0;
 };
 
 class FeatureEngineer {
@@ -32,6 +46,18 @@ public:
     std::pair<std::vector<std::vector<double>>, std::vector<double>>
     create_features(const std::vector<Bar>& bars, int prediction_horizon = 1);
     
+    // same rows, but only those built at bar index >= first_bar (indicators still see the
+    // whole history); bar_index, if given, receives the bar each row was built at
+    std::pair<std::vector<std::vector<double>>, std::vector<double>>
+    create_features(const std::vector<Bar>& bars, int prediction_horizon, size_t first_bar,
+                    std::vector<size_t>* bar_index = nullptr);
+
+    // from split/dividend adjusted prices and volumes (adjustments.h), read through the
+    // view's factors without an adjusted copy of the bars
+    std::pair<std::vector<std::vector<double>>, std::vector<double>>
+    create_features(const AdjustedView& bars, int prediction_horizon, size_t first_bar = 0,
+                    std::vector<size_t>* bar_index = nullptr);
+    
     // splits data into train and test sets
     std::tuple<std::vector<std::vector<double>>, std::vector<double>,
                std::vector<std::vector<double>>, std::vector<double>>
@@ -42,8 +68,23 @@ public:
     int get_feature_count() const;
     std::vector<std::string> get_feature_names() const;
     
+    // extra per-bar columns (one value per bar, NaN = unavailable) appended to every row,
+    // e.g. factor returns from a cross-sectional model
+    void add_external_column(const std::string& name, std::vector<double> values);
+    void clear_external_columns();
+    
+    const FeatureConfig& config() const { return config_; }
+    const std::vector<std::pair<std::string, std::vector<double>>>& external_columns() const {
+        return external_;
+    }
+    
 private:
     FeatureConfig config_;
+    std::vector<std::pair<std::string, std::vector<double>>> external_;
+
+    std::pair<std::vector<std::vector<double>>, std::vector<double>>
+    build_rows(const std::vector<double>& closes, const std::vector<double>& volumes,
+               int prediction_horizon, size_t first_bar, std::vector<size_t>* bar_index);
     
     std::vector<double> extract_returns(const std::vector<Bar>& bars, size_t idx) const;
     std::vector<double> extract_lagged_prices(const std::vector<Bar>& bars, size_t idx) const;
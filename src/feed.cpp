@@ -0,0 +1,310 @@
+// posix sockets; tcp messages are parsed straight out of a stream buffer that is only
+// compacted (moved to the front) once per recv, udp gets one message per datagram
+
+#include "feed.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace sp {
+using namespace std;
+
+FeedEndpoint FeedEndpoint::parse(const string& uri) {
+    FeedEndpoint e;
+    size_t scheme = uri.find("://");
+    string kind = scheme == string::npos ? "" : uri.substr(0, scheme);
+    if (kind != "tcp" && kind != "udp") {
+        throw invalid_argument("feed endpoint must be tcp://host:port or udp://host:port: " + uri);
+    }
+    e.udp = kind == "udp";
+    string rest = uri.substr(scheme + 3);
+    size_t colon = rest.rfind(':');
+    if (colon == string::npos || colon + 1 == rest.size()) {
+        throw invalid_argument("feed endpoint has no port: " + uri);
+    }
+    if (colon > 0) e.host = rest.substr(0, colon);
+    int port = stoi(rest.substr(colon + 1));
+    if (port <= 0 || port > 65535) throw invalid_argument("feed port out of range: " + uri);
+    e.port = static_cast<uint16_t>(port);
+    return e;
+}
+
+bool FeedEndpoint::multicast() const {
+    size_t dot = host.find('.');
+    int first = dot == string::npos ? -1 : atoi(host.substr(0, dot).c_str());
+    return udp && first >= 224 && first <= 239;
+}
+
+string FeedEndpoint::str() const {
+    return (udp ? "udp://" : "tcp://") + host + ":" + to_string(port);
+}
+
+#ifndef _WIN32
+
+namespace {
+
+sockaddr_in make_addr(const string& host, uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw invalid_argument("feed host must be an IPv4 address: " + host);
+    }
+    return addr;
+}
+
+[[noreturn]] void fail(const string& what) {
+    throw runtime_error(what + ": " + strerror(errno));
+}
+
+// 0 on timeout, otherwise > 0
+int wait_readable(int fd, int timeout_ms) {
+    pollfd p{fd, POLLIN, 0};
+    int r;
+    do {
+        r = poll(&p, 1, timeout_ms);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) fail("poll failed");
+    return r;
+}
+
+int64_t now_ns() {
+    return StreamingEngine::now_ns();
+}
+
+} // namespace
+
+FeedPublisher::FeedPublisher(const FeedEndpoint& endpoint, int accept_timeout_ms)
+    : endpoint_(endpoint) {
+    sockaddr_in addr = make_addr(endpoint.host, endpoint.port);
+    if (endpoint.udp) {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0) fail("socket failed");
+        if (endpoint.multicast()) {
+            // ttl 0 keeps the group on this host; loop delivers it to local members
+            in_addr loopback = make_addr("127.0.0.1", 0).sin_addr;
+            unsigned char ttl = 0, loop = 1;
+            setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+            setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+            setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        }
+        if (connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            int err = errno;
+            close(fd_);
+            errno = err;
+            fail("cannot send to " + endpoint.str());
+        }
+    } else {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) fail("socket failed");
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || listen(listener, 1) != 0) {
+            int err = errno;
+            close(listener);
+            errno = err;
+            fail("cannot listen on " + endpoint.str());
+        }
+        if (wait_readable(listener, accept_timeout_ms) > 0) fd_ = accept(listener, nullptr, nullptr);
+        close(listener);
+        if (fd_ < 0) throw runtime_error("no subscriber connected to " + endpoint.str());
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    buffer_.resize(feed_message_size(kFeedMaxRecords));
+}
+
+FeedPublisher::~FeedPublisher() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void FeedPublisher::send(const BarRecord* bars, size_t n) {
+    size_t per = endpoint_.udp ? kFeedUdpRecords : kFeedMaxRecords;
+    for (size_t i = 0; i < n; i += per) send_message(bars + i, min(per, n - i), 0);
+}
+
+void FeedPublisher::finish() {
+    // a lost udp end marker only costs the subscriber its idle timeout
+    send_message(nullptr, 0, kFeedEnd);
+}
+
+void FeedPublisher::send_message(const BarRecord* bars, size_t n, uint16_t flags) {
+    size_t size = encode_feed_message(buffer_.data(), bars, n, sequence_++, flags);
+    const char* p = buffer_.data();
+    size_t left = size;
+    while (left > 0) {
+        ssize_t sent = ::send(fd_, p, left, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            // udp: the local socket buffer is full or a previous datagram was refused
+            if (endpoint_.udp && (errno == ENOBUFS || errno == EAGAIN || errno == ECONNREFUSED)) {
+                this_thread::yield();
+                continue;
+            }
+            fail("feed send failed");
+        }
+        p += sent;
+        left -= static_cast<size_t>(sent);
+    }
+    int64_t now = now_ns();
+    if (stats_.messages == 0) first_ns_ = now;
+    stats_.messages++;
+    stats_.bars += n;
+    stats_.bytes += size;
+    stats_.seconds = (now - first_ns_) / 1e9;
+}
+
+FeedSubscriber::FeedSubscriber(const FeedEndpoint& endpoint, int connect_timeout_ms)
+    : endpoint_(endpoint) {
+    sockaddr_in addr = make_addr(endpoint.host, endpoint.port);
+    if (endpoint.udp) {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0) fail("socket failed");
+        int one = 1, rcvbuf = 8 << 20;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        sockaddr_in local = addr;
+        if (endpoint.multicast()) local.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+            int err = errno;
+            close(fd_);
+            errno = err;
+            fail("cannot bind " + endpoint.str());
+        }
+        if (endpoint.multicast()) {
+            ip_mreq group{};
+            group.imr_multiaddr = addr.sin_addr;
+            group.imr_interface = make_addr("127.0.0.1", 0).sin_addr;
+            if (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) != 0) {
+                int err = errno;
+                close(fd_);
+                errno = err;
+                fail("cannot join " + endpoint.str());
+            }
+        }
+    } else {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(connect_timeout_ms);
+        for (;;) {
+            fd_ = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd_ < 0) fail("socket failed");
+            if (connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) break;
+            int err = errno;
+            close(fd_);
+            fd_ = -1;
+            if (chrono::steady_clock::now() >= deadline) {
+                errno = err;
+                fail("cannot connect to " + endpoint.str());
+            }
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    buffer_.resize((size_t(1) << 20) / sizeof(uint64_t));
+}
+
+FeedSubscriber::~FeedSubscriber() {
+    if (fd_ >= 0) close(fd_);
+}
+
+FeedStats FeedSubscriber::run(const Handler& on_bars, int idle_timeout_ms) {
+    FeedStats stats;
+    char* buf = reinterpret_cast<char*>(buffer_.data());
+    size_t capacity = buffer_.size() * sizeof(uint64_t);
+    size_t filled = 0;
+    uint64_t expected = 0;
+    int64_t first_ns = 0;
+    bool done = false;
+
+    // handles every complete message in buf[0, len), returns the bytes consumed. a bad
+    // header ends a tcp stream, but anyone can send to a udp port: the rest of that
+    // datagram is counted and dropped
+    auto consume = [&](size_t len) {
+        size_t at = 0;
+        FeedMessage msg;
+        while (!done && at < len) {
+            size_t size;
+            try {
+                size = decode_feed_message(buf + at, len - at, msg);
+            } catch (const runtime_error&) {
+                if (!endpoint_.udp) throw;
+                stats.malformed++;
+                return len;
+            }
+            if (size == 0) break;
+            int64_t now = now_ns();
+            if (stats.messages == 0) {
+                first_ns = now;
+            } else if (msg.header->sequence > expected) {
+                stats.gaps += msg.header->sequence - expected;
+            }
+            expected = msg.header->sequence + 1;
+            stats.messages++;
+            stats.bars += msg.count;
+            stats.bytes += size;
+            stats.seconds = (now - first_ns) / 1e9;
+            if (msg.count) on_bars(msg.bars, msg.count);
+            done = (msg.header->flags & kFeedEnd) != 0;
+            at += size;
+        }
+        return at;
+    };
+
+    while (!done) {
+        if (wait_readable(fd_, idle_timeout_ms) == 0) break;
+        if (endpoint_.udp) {
+            ssize_t n = recv(fd_, buf, capacity, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                fail("feed receive failed");
+            }
+            // a datagram must be whole messages; a partial one at the end is dropped
+            if (consume(static_cast<size_t>(n)) != static_cast<size_t>(n) && !done) stats.malformed++;
+        } else {
+            ssize_t n = recv(fd_, buf + filled, capacity - filled, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                fail("feed receive failed");
+            }
+            if (n == 0) break;  // publisher closed
+            filled += static_cast<size_t>(n);
+            size_t used = consume(filled);
+            // message sizes are multiples of 8, so the tail moved to the front stays aligned
+            memmove(buf, buf + used, filled - used);
+            filled -= used;
+        }
+    }
+    return stats;
+}
+
+#else
+
+FeedPublisher::FeedPublisher(const FeedEndpoint& endpoint, int) : endpoint_(endpoint) {
+    throw runtime_error("the loopback feed needs posix sockets");
+}
+FeedPublisher::~FeedPublisher() {}
+void FeedPublisher::send(const BarRecord*, size_t) {}
+void FeedPublisher::finish() {}
+void FeedPublisher::send_message(const BarRecord*, size_t, uint16_t) {}
+
+FeedSubscriber::FeedSubscriber(const FeedEndpoint& endpoint, int) : endpoint_(endpoint) {
+    throw runtime_error("the loopback feed needs posix sockets");
+}
+FeedSubscriber::~FeedSubscriber() {}
+FeedStats FeedSubscriber::run(const Handler&, int) { return {}; }
+
+#endif
+
+} // namespace sp
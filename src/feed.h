@@ -0,0 +1,85 @@
+// loopback bar feed: a publisher that sends feed_protocol.h messages over tcp or udp
+// (unicast or multicast), and a subscriber that hands the records on in place
+
+#pragma once
+#include "feed_protocol.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+// tcp://host:port or udp://host:port; a udp host in 224.0.0.0/4 is a multicast group
+struct FeedEndpoint {
+    bool udp = false;
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+
+    static FeedEndpoint parse(const std::string& uri);  // throws invalid_argument
+    bool multicast() const;
+    std::string str() const;
+};
+
+struct FeedStats {
+    uint64_t messages = 0;
+    uint64_t bars = 0;
+    uint64_t bytes = 0;
+    uint64_t gaps = 0;     // messages missing from the sequence (udp drops)
+    uint64_t malformed = 0;  // udp datagrams dropped for a bad header or a partial message
+    double seconds = 0.0;  // first to last message
+};
+
+class FeedPublisher {
+public:
+    // tcp: listens on the endpoint and waits up to accept_timeout_ms for one subscriber;
+    // udp: sends datagrams, multicast looped back through 127.0.0.1. throws runtime_error
+    explicit FeedPublisher(const FeedEndpoint& endpoint, int accept_timeout_ms = 30000);
+    ~FeedPublisher();
+
+    FeedPublisher(const FeedPublisher&) = delete;
+    FeedPublisher& operator=(const FeedPublisher&) = delete;
+
+    // sends the records as one message per kFeedMaxRecords (kFeedUdpRecords over udp)
+    void send(const BarRecord* bars, size_t n);
+    // end-of-replay marker so subscribers stop without waiting for a timeout
+    void finish();
+
+    const FeedStats& stats() const { return stats_; }
+
+private:
+    FeedEndpoint endpoint_;
+    int fd_ = -1;
+    uint64_t sequence_ = 0;
+    std::vector<char> buffer_;
+    FeedStats stats_;
+    int64_t first_ns_ = 0;
+
+    void send_message(const BarRecord* bars, size_t n, uint16_t flags);
+};
+
+class FeedSubscriber {
+public:
+    // records of one message, pointing into the receive buffer; valid during the call
+    using Handler = std::function<void(const BarRecord* bars, size_t n)>;
+
+    // tcp: connects, retrying until connect_timeout_ms; udp: binds the port (joining the
+    // group for multicast), so it must exist before the publisher starts sending
+    explicit FeedSubscriber(const FeedEndpoint& endpoint, int connect_timeout_ms = 10000);
+    ~FeedSubscriber();
+
+    FeedSubscriber(const FeedSubscriber&) = delete;
+    FeedSubscriber& operator=(const FeedSubscriber&) = delete;
+
+    // receives until the end marker, the connection closing, or idle_timeout_ms without data.
+    // a malformed message throws runtime_error over tcp, where the stream cannot be
+    // resynchronised; over udp the datagram is counted and dropped
+    FeedStats run(const Handler& on_bars, int idle_timeout_ms = 5000);
+
+private:
+    FeedEndpoint endpoint_;
+    int fd_ = -1;
+    std::vector<uint64_t> buffer_;  // 8 byte aligned receive buffer
+};
+
+} // namespace sp
@@ -0,0 +1,69 @@
+// wire format of the bar feed: a 16 byte header followed by `count` BarRecords
+// (streaming.h) in host byte order. every message is a multiple of 8 bytes, so records
+// stay aligned in the receive buffer and are read in place, never unpacked
+
+#pragma once
+#include "streaming.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the feed protocol is defined for little-endian hosts"
+#endif
+
+namespace sp {
+
+const uint32_t kFeedMagic = 0x31465053;  // "SPF1"
+const uint16_t kFeedEnd = 1;             // flag: last message of a replay
+const size_t kFeedMaxRecords = 1024;     // per message
+const size_t kFeedUdpRecords = 25;       // 16 + 25 * 56 = 1416 bytes, one 1500 MTU datagram
+
+struct FeedHeader {
+    uint32_t magic;
+    uint16_t count;     // records after the header
+    uint16_t flags;
+    uint64_t sequence;  // per publisher, +1 per message; gaps mean lost datagrams
+};
+
+static_assert(sizeof(FeedHeader) == 16, "feed header layout");
+static_assert(sizeof(BarRecord) == 56 && alignof(BarRecord) == 8, "feed record layout");
+
+inline size_t feed_message_size(size_t count) {
+    return sizeof(FeedHeader) + count * sizeof(BarRecord);
+}
+
+// a message viewed in place; valid as long as the buffer it was decoded from
+struct FeedMessage {
+    const FeedHeader* header = nullptr;
+    const BarRecord* bars = nullptr;
+    size_t count = 0;
+};
+
+// decodes the message at data (8 byte aligned). returns its size, or 0 when len holds
+// only part of it; throws runtime_error on a bad magic or count
+inline size_t decode_feed_message(const char* data, size_t len, FeedMessage& out) {
+    if (len < sizeof(FeedHeader)) return 0;
+    const FeedHeader* h = reinterpret_cast<const FeedHeader*>(data);
+    if (h->magic != kFeedMagic || h->count > kFeedMaxRecords) {
+        throw std::runtime_error("malformed feed message");
+    }
+    size_t size = feed_message_size(h->count);
+    if (len < size) return 0;
+    out.header = h;
+    out.bars = reinterpret_cast<const BarRecord*>(data + sizeof(FeedHeader));
+    out.count = h->count;
+    return size;
+}
+
+// writes header + records to out (feed_message_size(count) bytes), returns the size
+inline size_t encode_feed_message(char* out, const BarRecord* bars, size_t count,
+                                  uint64_t sequence, uint16_t flags = 0) {
+    FeedHeader h{kFeedMagic, static_cast<uint16_t>(count), flags, sequence};
+    std::memcpy(out, &h, sizeof(h));
+    if (count) std::memcpy(out + sizeof(h), bars, count * sizeof(BarRecord));
+    return feed_message_size(count);
+}
+
+} // namespace sp
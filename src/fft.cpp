@@ -0,0 +1,146 @@
+// iterative radix-2 FFT; non power-of-two lengths go through bluestein's chirp-z
+
+#include "fft.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+bool is_pow2(size_t n) { return n && !(n & (n - 1)); }
+
+void fft_pow2(vector<cplx>& a, bool inverse) {
+    size_t n = a.size();
+    // bit reversal permutation
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) swap(a[i], a[j]);
+    }
+    double sign = inverse ? 1.0 : -1.0;
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double ang = sign * 2.0 * kPi / len;
+        size_t half = len / 2;
+        // twiddles for this stage computed once, not per butterfly group
+        vector<cplx> w(half);
+        for (size_t k = 0; k < half; ++k) w[k] = cplx(cos(ang * k), sin(ang * k));
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < half; ++k) {
+                cplx u = a[i + k];
+                cplx v = a[i + k + half] * w[k];
+                a[i + k] = u + v;
+                a[i + k + half] = u - v;
+            }
+        }
+    }
+}
+
+// DFT of arbitrary length as a power-of-two circular convolution
+void fft_bluestein(vector<cplx>& a, bool inverse) {
+    size_t n = a.size();
+    size_t m = next_pow2(2 * n - 1);
+    double sign = inverse ? 1.0 : -1.0;
+
+    vector<cplx> chirp(n);
+    for (size_t k = 0; k < n; ++k) {
+        // k^2 mod 2n keeps the angle small for long signals
+        size_t k2 = (k * k) % (2 * n);
+        double ang = sign * kPi * k2 / n;
+        chirp[k] = cplx(cos(ang), sin(ang));
+    }
+    vector<cplx> u(m), v(m);
+    for (size_t k = 0; k < n; ++k) u[k] = a[k] * chirp[k];
+    v[0] = conj(chirp[0]);
+    for (size_t k = 1; k < n; ++k) v[k] = v[m - k] = conj(chirp[k]);
+
+    fft_pow2(u, false);
+    fft_pow2(v, false);
+    for (size_t i = 0; i < m; ++i) u[i] *= v[i];
+    fft_pow2(u, true);
+    for (size_t k = 0; k < n; ++k) a[k] = u[k] / static_cast<double>(m) * chirp[k];
+}
+
+} // namespace
+
+size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void fft(vector<cplx>& a, bool inverse) {
+    size_t n = a.size();
+    if (n <= 1) return;
+    if (is_pow2(n)) fft_pow2(a, inverse);
+    else fft_bluestein(a, inverse);
+    if (inverse) {
+        for (auto& v : a) v /= static_cast<double>(n);
+    }
+}
+
+// even n: packs the signal into n/2 complex points and untangles the halves
+vector<cplx> rfft(const vector<double>& x) {
+    size_t n = x.size();
+    if (n == 0) return {};
+    if (n % 2 != 0) {
+        vector<cplx> a(x.begin(), x.end());
+        fft(a);
+        a.resize(n / 2 + 1);
+        return a;
+    }
+    size_t h = n / 2;
+    vector<cplx> z(h);
+    for (size_t j = 0; j < h; ++j) z[j] = cplx(x[2 * j], x[2 * j + 1]);
+    fft(z);
+
+    vector<cplx> out(h + 1);
+    for (size_t k = 0; k <= h; ++k) {
+        cplx zk = z[k % h];
+        cplx zr = conj(z[(h - k) % h]);
+        cplx even = (zk + zr) * 0.5;
+        cplx odd = (zk - zr) * cplx(0.0, -0.5);
+        double ang = -2.0 * kPi * k / n;
+        out[k] = even + cplx(cos(ang), sin(ang)) * odd;
+    }
+    return out;
+}
+
+vector<double> irfft(const vector<cplx>& spectrum, size_t n) {
+    if (n == 0) return {};
+    if (spectrum.size() != n / 2 + 1) {
+        throw invalid_argument("irfft: spectrum size does not match length");
+    }
+    if (n % 2 != 0) {
+        vector<cplx> a(n);
+        for (size_t k = 0; k < spectrum.size(); ++k) a[k] = spectrum[k];
+        for (size_t k = 1; k < spectrum.size(); ++k) a[n - k] = conj(spectrum[k]);
+        fft(a, true);
+        vector<double> out(n);
+        for (size_t i = 0; i < n; ++i) out[i] = a[i].real();
+        return out;
+    }
+    size_t h = n / 2;
+    vector<cplx> z(h);
+    for (size_t k = 0; k < h; ++k) {
+        cplx xk = spectrum[k];
+        cplx xr = conj(spectrum[h - k]);
+        cplx even = (xk + xr) * 0.5;
+        double ang = 2.0 * kPi * k / n;
+        cplx odd = (xk - xr) * 0.5 * cplx(cos(ang), sin(ang));
+        z[k] = even + cplx(0.0, 1.0) * odd;
+    }
+    fft(z, true);
+    vector<double> out(n);
+    for (size_t j = 0; j < h; ++j) {
+        out[2 * j] = z[j].real();
+        out[2 * j + 1] = z[j].imag();
+    }
+    return out;
+}
+
+} // namespace sp
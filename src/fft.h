@@ -0,0 +1,23 @@
+// fast fourier transform (radix-2, bluestein for other lengths), no dependencies
+
+#pragma once
+#include <complex>
+#include <vector>
+
+namespace sp {
+
+using cplx = std::complex<double>;
+
+// in-place complex DFT of any length; inverse transform is scaled by 1/n
+void fft(std::vector<cplx>& a, bool inverse = false);
+
+// DFT of a real signal, returns bins 0..n/2
+std::vector<cplx> rfft(const std::vector<double>& x);
+
+// inverse of rfft for a real signal of length n
+std::vector<double> irfft(const std::vector<cplx>& spectrum, size_t n);
+
+// smallest power of two >= n
+size_t next_pow2(size_t n);
+
+} // namespace sp
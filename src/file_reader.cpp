@@ -0,0 +1,437 @@
+// io_uring through raw syscalls (no liburing): one ring, one buffer per slot registered
+// with the kernel, READ_FIXED at the file offset, resubmitted until the file is read.
+// without the ring (old kernel, seccomp, other os) a few threads pread instead
+
+#include "file_reader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define SP_HAVE_URING 1
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+#ifndef _WIN32
+// opens and sizes a file, returns false with error set
+bool open_sized(const string& path, int& fd, uint64_t& size, string& error) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) ::close(fd);
+        error = "failed to open the file: " + path;
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+#endif
+
+bool read_whole(const string& path, string& data, string& error) {
+#ifdef _WIN32
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) {
+        error = "failed to open the file: " + path;
+        return false;
+    }
+    data.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(&data[0], static_cast<streamsize>(data.size()));
+    if (!in) {
+        error = "failed to read the file: " + path;
+        return false;
+    }
+    return true;
+#else
+    int fd;
+    uint64_t size;
+    if (!open_sized(path, fd, size, error)) return false;
+    data.resize(size);
+    uint64_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, &data[done], size - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<uint64_t>(n);
+    }
+    ::close(fd);
+    if (done != size) {
+        error = "failed to read the file: " + path;
+        return false;
+    }
+    return true;
+#endif
+}
+
+// release() for data the reader owns: it goes away with the last copy of the callback
+function<void()> hold(shared_ptr<string> data) {
+    return [data]() mutable { data.reset(); };
+}
+
+} // namespace
+
+#ifdef SP_HAVE_URING
+
+struct FileReader::Ring {
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_bytes = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_bytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqe_bytes = 0;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_cqe* cqes;
+
+    vector<char> buffers;
+    size_t buffer_bytes = 0;
+    bool fixed = false;  // buffers registered, READ_FIXED usable
+
+    ~Ring() {
+        if (sqes) munmap(sqes, sqe_bytes);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) munmap(cq_ptr, cq_bytes);
+        if (sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_bytes);
+        if (fd >= 0) ::close(fd);
+    }
+
+    char* buffer(unsigned slot) { return buffers.data() + slot * buffer_bytes; }
+
+    // null when the kernel (or a sandbox) refuses io_uring
+    static unique_ptr<Ring> open(unsigned depth, size_t buffer_bytes) {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        auto r = make_unique<Ring>();
+        r->fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &p));
+        if (r->fd < 0) return nullptr;
+
+        r->sq_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        r->cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) r->sq_bytes = r->cq_bytes = max(r->sq_bytes, r->cq_bytes);
+        r->sq_ptr = mmap(nullptr, r->sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->fd, IORING_OFF_SQ_RING);
+        if (r->sq_ptr == MAP_FAILED) return nullptr;
+        r->cq_ptr = single ? r->sq_ptr
+                           : mmap(nullptr, r->cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) return nullptr;
+        r->sqe_bytes = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, r->sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          r->fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return nullptr;
+        r->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(r->sq_ptr);
+        char* cq = static_cast<char*>(r->cq_ptr);
+        r->sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        r->sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        r->sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        r->sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        r->cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        r->cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        r->cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        r->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+        // registration pins the pages; under a small RLIMIT_MEMLOCK fall back to plain READ,
+        // which needs 5.6+ (READ_FIXED is 5.1), so without it the caller preads instead
+        r->buffer_bytes = buffer_bytes;
+        r->buffers.resize(size_t(depth) * buffer_bytes);
+        vector<iovec> iov(depth);
+        for (unsigned i = 0; i < depth; ++i) iov[i] = {r->buffer(i), buffer_bytes};
+        r->fixed = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS, iov.data(), depth) == 0;
+        if (!r->fixed && !r->supports(IORING_OP_READ)) return nullptr;
+        return r;
+    }
+
+    // IORING_REGISTER_PROBE itself is 5.6+; failing it means the op is too new as well
+    bool supports(unsigned op) const {
+        const unsigned ops = 256;
+        vector<uint64_t> storage((sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op)) / sizeof(uint64_t) + 1);
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, ops) != 0) return false;
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    void prepare(unsigned slot, int file, uint64_t offset, unsigned len) {
+        unsigned tail = *sq_tail;
+        unsigned idx = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = file;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer(slot));
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->buf_index = fixed ? static_cast<uint16_t>(slot) : 0;
+        sqe->user_data = slot;
+        sq_array[idx] = idx;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                                        IORING_ENTER_GETEVENTS, nullptr, 0));
+    }
+
+    // drops entries prepared but not taken by the kernel, so no later enter submits them
+    void discard_unsubmitted() {
+        __atomic_store_n(sq_tail, __atomic_load_n(sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+};
+
+#else
+
+struct FileReader::Ring {};
+
+#endif
+
+FileReader::FileReader(const FileReaderOptions& options) : options_(options) {
+    options_.queue_depth = max(1u, options_.queue_depth);
+    options_.buffer_bytes = max<size_t>(4096, options_.buffer_bytes);
+#ifdef SP_HAVE_URING
+    if (options_.use_uring) ring_ = Ring::open(options_.queue_depth, options_.buffer_bytes);
+#endif
+    if (ring_) {
+        threads_.emplace_back([this] {
+            if (options_.thread_init) options_.thread_init();
+            run_uring();
+        });
+    } else {
+        for (unsigned t = 0; t < max(1u, options_.fallback_threads); ++t) {
+            threads_.emplace_back([this] {
+                if (options_.thread_init) options_.thread_init();
+                run_pread();
+            });
+        }
+    }
+}
+
+FileReader::~FileReader() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void FileReader::submit(string path, Callback done) {
+    submit_borrowed(move(path), [done = move(done)](const char* data, size_t len, const string& error,
+                                                    function<void()> release) {
+        done(data, len, error);
+        release();
+    });
+}
+
+void FileReader::submit_borrowed(string path, BorrowCallback done) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        pending_.push_back({move(path), move(done)});
+    }
+    wake_.notify_one();
+}
+
+void FileReader::read_all(const vector<string>& paths,
+                          const function<void(size_t, const char*, size_t, const string&)>& on_read) {
+    mutex m;
+    condition_variable finished;
+    size_t remaining = paths.size();
+    exception_ptr failure;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        submit(paths[i], [&, i](const char* data, size_t len, const string& error) {
+            exception_ptr e;
+            try {
+                on_read(i, data, len, error);
+            } catch (...) {
+                e = current_exception();
+            }
+            lock_guard<mutex> lock(m);
+            if (e && !failure) failure = e;
+            if (--remaining == 0) finished.notify_all();
+        });
+    }
+    unique_lock<mutex> lock(m);
+    finished.wait(lock, [&] { return remaining == 0; });
+    if (failure) rethrow_exception(failure);
+}
+
+void FileReader::run_pread() {
+    for (;;) {
+        Request req;
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+            if (pending_.empty()) return;
+            req = move(pending_.front());
+            pending_.pop_front();
+        }
+        auto data = make_shared<string>();
+        string error;
+        read_whole(req.path, *data, error);
+        req.done(data->data(), error.empty() ? data->size() : 0, error, hold(data));
+    }
+}
+
+#ifdef SP_HAVE_URING
+
+void FileReader::run_uring() {
+    struct Slot {
+        Request req;
+        int fd = -1;
+        uint64_t size = 0;
+        uint64_t offset = 0;
+        string data;  // only used when the file needs more than one read
+    };
+    Ring& ring = *ring_;
+    vector<Slot> slots(options_.queue_depth);
+    vector<unsigned> free_slots;
+    for (unsigned s = options_.queue_depth; s-- > 0;) free_slots.push_back(s);
+    unsigned in_flight = 0, queued = 0;
+
+    auto next_len = [&](const Slot& s) {
+        return static_cast<unsigned>(min<uint64_t>(ring.buffer_bytes, s.size - s.offset));
+    };
+    // closes the slot's file and takes its callback; the slot itself is not free yet
+    auto retire = [&](unsigned slot) {
+        Slot& s = slots[slot];
+        ::close(s.fd);
+        BorrowCallback done = move(s.req.done);
+        s = Slot{};
+        --in_flight;
+        return done;
+    };
+    auto finish = [&](unsigned slot, shared_ptr<string> data, const string& error) {
+        BorrowCallback done = retire(slot);
+        free_slots.push_back(slot);
+        done(data->data(), error.empty() ? data->size() : 0, error, hold(data));
+    };
+    // the same file read with pread instead, for what the ring cannot do
+    auto fall_back = [&](unsigned slot) {
+        auto data = make_shared<string>();
+        string error;
+        read_whole(slots[slot].req.path, *data, error);
+        finish(slot, move(data), error);
+    };
+
+    for (;;) {
+        vector<Request> batch;
+        {
+            unique_lock<mutex> lock(mutex_);
+            // with every buffer borrowed, new reads wait for a release
+            wake_.wait(lock, [&] {
+                return (stop_ && pending_.empty()) || (!pending_.empty() && !free_slots.empty()) ||
+                       in_flight > 0 || !released_.empty();
+            });
+            free_slots.insert(free_slots.end(), released_.begin(), released_.end());
+            released_.clear();
+            if (stop_ && pending_.empty() && in_flight == 0) return;
+            while (!pending_.empty() && batch.size() < free_slots.size()) {
+                batch.push_back(move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+        for (auto& req : batch) {
+            int fd;
+            uint64_t size;
+            string error;
+            if (!open_sized(req.path, fd, size, error)) {
+                req.done(nullptr, 0, error, [] {});
+                continue;
+            }
+            if (size == 0) {
+                ::close(fd);
+                req.done("", 0, "", [] {});
+                continue;
+            }
+            unsigned slot = free_slots.back();
+            free_slots.pop_back();
+            Slot& s = slots[slot];
+            s.req = move(req);
+            s.fd = fd;
+            s.size = size;
+            ring.prepare(slot, fd, 0, next_len(s));
+            ++queued;
+            ++in_flight;
+        }
+        if (in_flight == 0) continue;
+
+        // everything prepared since the last round goes to the kernel in one call
+        int submitted = ring.enter(queued, 1);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            // the ring is unusable: nothing left in the queue may reach the kernel later, the
+            // open files are read again with pread and so is everything still to come
+            ring.discard_unsubmitted();
+            for (unsigned s = 0; s < slots.size(); ++s) {
+                if (slots[s].fd >= 0) fall_back(s);
+            }
+            run_pread();
+            return;
+        }
+        queued -= static_cast<unsigned>(submitted);
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring.cqes[head & *ring.cq_mask];
+            unsigned slot = static_cast<unsigned>(cqe.user_data);
+            Slot& s = slots[slot];
+            if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                fall_back(slot);  // the kernel rejected the request itself, not the file
+                continue;
+            }
+            if (cqe.res <= 0) {
+                finish(slot, make_shared<string>(), "failed to read the file: " + s.req.path);
+                continue;
+            }
+            size_t got = static_cast<size_t>(cqe.res);
+            const char* buf = ring.buffer(slot);
+            if (s.offset == 0 && got == s.size) {
+                // handed out in place; the slot rejoins the ring once released
+                retire(slot)(buf, got, "", [this, slot] {
+                    {
+                        lock_guard<mutex> lock(mutex_);
+                        released_.push_back(slot);
+                    }
+                    wake_.notify_all();
+                });
+                continue;
+            }
+            s.data.append(buf, got);
+            s.offset += got;
+            if (s.offset < s.size) {
+                ring.prepare(slot, s.fd, s.offset, next_len(s));
+                ++queued;
+            } else {
+                finish(slot, make_shared<string>(move(s.data)), "");
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+void FileReader::run_uring() {}
+
+#endif
+
+} // namespace sp
@@ -0,0 +1,75 @@
+// whole-file reads completed on a background thread: io_uring on linux, pread elsewhere
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sp {
+
+struct FileReaderOptions {
+    unsigned queue_depth = 64;       // reads in flight on the ring
+    size_t buffer_bytes = 256 << 10; // per-read registered buffer; bigger files take several reads
+    bool use_uring = true;           // false forces the pread path
+    unsigned fallback_threads = 2;   // pread threads when io_uring is unavailable
+    std::function<void()> thread_init;  // runs first on each reader thread, e.g. to pin it
+};
+
+class FileReader {
+public:
+    // data is only valid during the call; error is empty on success
+    using Callback = std::function<void(const char* data, size_t len, const std::string& error)>;
+    // data stays valid until release() is called, from any thread. a file read straight
+    // into a registered buffer keeps that buffer off the ring until then
+    using BorrowCallback = std::function<void(const char* data, size_t len, const std::string& error,
+                                              std::function<void()> release)>;
+
+    explicit FileReader(const FileReaderOptions& options = {});
+    // finishes every submitted read first; borrowed data must be released before
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // thread safe; done runs on a reader thread. with io_uring everything queued since
+    // the last round is submitted with a single io_uring_enter
+    void submit(std::string path, Callback done);
+    // same, but done may hand the data to another thread and release it later: a file
+    // that fits one buffer is passed straight from the registered buffer, without a copy.
+    // reads wait for a free buffer, so release promptly
+    void submit_borrowed(std::string path, BorrowCallback done);
+
+    // true when reads go through io_uring
+    bool uring() const { return ring_ != nullptr; }
+
+    // reads every path and waits; on_read(index, data, len, error) runs on the reader thread
+    void read_all(const std::vector<std::string>& paths,
+                  const std::function<void(size_t, const char*, size_t, const std::string&)>& on_read);
+
+private:
+    struct Request {
+        std::string path;
+        BorrowCallback done;
+    };
+    struct Ring;
+
+    FileReaderOptions options_;
+    std::unique_ptr<Ring> ring_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Request> pending_;
+    std::vector<unsigned> released_;  // ring slots given back by release()
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+
+    void run_uring();
+    void run_pread();
+};
+
+} // namespace sp
@@ -0,0 +1,120 @@
+// xxHash64 following the reference algorithm (32 byte stripes, 4 lanes)
+
+#include "hash.h"
+#include <cstring>
+
+using namespace sp;
+
+namespace {
+
+const uint64_t P1 = 11400714785074694791ULL;
+const uint64_t P2 = 14029467366897019727ULL;
+const uint64_t P3 = 1609587929392839161ULL;
+const uint64_t P4 = 9650029242287828579ULL;
+const uint64_t P5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * P1 + P4;
+}
+
+} // namespace
+
+XXHash64::XXHash64(uint64_t seed) : seed_(seed) {
+    acc_[0] = seed + P1 + P2;
+    acc_[1] = seed + P2;
+    acc_[2] = seed;
+    acc_[3] = seed - P1;
+}
+
+void XXHash64::update(const void* data, size_t len) {
+    if (len == 0) return;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    total_ += len;
+
+    if (buffered_ + len < 32) {
+        std::memcpy(buf_ + buffered_, p, len);
+        buffered_ += len;
+        return;
+    }
+    if (buffered_ > 0) {
+        size_t fill = 32 - buffered_;
+        std::memcpy(buf_ + buffered_, p, fill);
+        for (int i = 0; i < 4; ++i) acc_[i] = xxh_round(acc_[i], read64(buf_ + 8 * i));
+        p += fill;
+        len -= fill;
+        buffered_ = 0;
+    }
+    while (len >= 32) {
+        for (int i = 0; i < 4; ++i) acc_[i] = xxh_round(acc_[i], read64(p + 8 * i));
+        p += 32;
+        len -= 32;
+    }
+    std::memcpy(buf_, p, len);
+    buffered_ = len;
+}
+
+uint64_t XXHash64::digest() const {
+    uint64_t h;
+    if (total_ >= 32) {
+        h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+        for (int i = 0; i < 4; ++i) h = merge(h, acc_[i]);
+    } else {
+        h = seed_ + P5;
+    }
+    h += total_;
+
+    const unsigned char* p = buf_;
+    size_t len = buffered_;
+    while (len >= 8) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+        p += 8;
+        len -= 8;
+    }
+    if (len >= 4) {
+        h ^= static_cast<uint64_t>(read32(p)) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+        h ^= (*p) * P5;
+        h = rotl(h, 11) * P1;
+        ++p;
+        --len;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t sp::xxhash64(const void* data, size_t len, uint64_t seed) {
+    XXHash64 h(seed);
+    h.update(data, len);
+    return h.digest();
+}
@@ -0,0 +1,40 @@
+// xxHash64 (streaming), a fast non-cryptographic hash for cache keys and fingerprints
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace sp {
+
+class XXHash64 {
+public:
+    explicit XXHash64(uint64_t seed = 0);
+
+    void update(const void* data, size_t len);
+    void update(const std::string& s) {
+        uint64_t len = s.size();
+        update(&len, sizeof(len));
+        update(s.data(), s.size());
+    }
+    // raw bytes of a trivially copyable value (no padding-carrying structs)
+    template <class T>
+    void update_value(const T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "hash raw values only");
+        update(&v, sizeof(T));
+    }
+
+    uint64_t digest() const;
+
+private:
+    uint64_t seed_;
+    uint64_t acc_[4];
+    unsigned char buf_[32];
+    size_t buffered_ = 0;
+    uint64_t total_ = 0;
+};
+
+uint64_t xxhash64(const void* data, size_t len, uint64_t seed = 0);
+
+} // namespace sp
@@ -0,0 +1,149 @@
+// every block carries a 64 byte header (kind + mapped length) so huge_free needs no size
+// and stays correct if the policy or threshold changes in between
+
+#include "huge_pages.h"
+#include "numa_topology.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const size_t kAlign = 64;
+const size_t kHugePage = size_t(2) << 20;
+
+enum Kind : uint32_t { kSmall = 0, kAdvised = 1, kHugeTlb = 2 };
+
+struct alignas(64) Header {
+    uint32_t kind;
+    size_t mapped;    // whole mapping, 0 for kSmall
+    size_t payload;
+};
+static_assert(sizeof(Header) == kAlign, "header must keep the payload aligned");
+
+HugePagePolicy policy_from_env() {
+    const char* env = getenv("SP_HUGEPAGES");
+    if (!env) return HugePagePolicy::Advise;
+    if (!strcmp(env, "off") || !strcmp(env, "0")) return HugePagePolicy::Off;
+    if (!strcmp(env, "hugetlb")) return HugePagePolicy::Reserve;
+    return HugePagePolicy::Advise;
+}
+
+atomic<int> g_policy{static_cast<int>(policy_from_env())};
+atomic<size_t> g_threshold{size_t(4) << 20};
+atomic<uint64_t> g_bytes[3];
+
+size_t round_up(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+#ifndef _WIN32
+// anonymous mapping whose start is 2 MB aligned, so THP can back it from the first byte
+void* map_aligned(size_t len) {
+    size_t over = len + kHugePage;
+    void* raw = mmap(nullptr, over, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = round_up(base, kHugePage);
+    if (aligned > base) munmap(raw, aligned - base);
+    size_t tail = base + over - (aligned + len);
+    if (tail) munmap(reinterpret_cast<void*>(aligned + len), tail);
+    return reinterpret_cast<void*>(aligned);
+}
+
+// a thread pinned to a numa node (numa_topology.h) keeps its big buffers there even if
+// another thread touches them first; called before the header write faults the first page
+void bind_home_node(void* p, size_t len) {
+    int node = current_thread_node();
+    if (node >= 0) bind_to_node(p, len, node);
+}
+#endif
+
+} // namespace
+
+void set_huge_page_policy(HugePagePolicy policy) {
+    g_policy = static_cast<int>(policy);
+}
+
+HugePagePolicy huge_page_policy() {
+    return static_cast<HugePagePolicy>(g_policy.load());
+}
+
+void set_huge_page_threshold(size_t bytes) {
+    g_threshold = bytes;
+}
+
+size_t huge_page_threshold() {
+    return g_threshold;
+}
+
+HugePageStats huge_page_stats() {
+    return {g_bytes[kHugeTlb].load(), g_bytes[kAdvised].load(), g_bytes[kSmall].load()};
+}
+
+void* huge_alloc(size_t bytes) {
+    size_t total = bytes + sizeof(Header);
+    if (total < bytes) throw bad_alloc();
+    HugePagePolicy policy = huge_page_policy();
+    Header* h = nullptr;
+    Kind kind = kSmall;
+    size_t mapped = 0;
+
+#ifndef _WIN32
+    if (policy != HugePagePolicy::Off && bytes >= huge_page_threshold()) {
+        mapped = round_up(total, kHugePage);
+#ifdef MAP_HUGETLB
+        if (policy == HugePagePolicy::Reserve) {
+            void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                bind_home_node(p, mapped);
+                h = static_cast<Header*>(p);
+                kind = kHugeTlb;
+            }
+        }
+#endif
+        if (!h) {
+            void* p = map_aligned(mapped);
+            if (p) {
+#ifdef MADV_HUGEPAGE
+                madvise(p, mapped, MADV_HUGEPAGE);
+#endif
+                bind_home_node(p, mapped);
+                h = static_cast<Header*>(p);
+                kind = kAdvised;
+            }
+        }
+    }
+#endif
+    if (!h) {
+        h = static_cast<Header*>(::operator new(total, align_val_t(kAlign)));
+        kind = kSmall;
+        mapped = 0;
+    }
+    h->kind = kind;
+    h->mapped = mapped;
+    h->payload = bytes;
+    g_bytes[kind] += bytes;
+    return h + 1;
+}
+
+void huge_free(void* p) noexcept {
+    if (!p) return;
+    Header* h = static_cast<Header*>(p) - 1;
+    g_bytes[h->kind] -= h->payload;
+#ifndef _WIN32
+    if (h->kind != kSmall) {
+        munmap(h, h->mapped);
+        return;
+    }
+#endif
+    ::operator delete(h, align_val_t(kAlign));
+}
+
+} // namespace sp
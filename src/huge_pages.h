@@ -0,0 +1,61 @@
+// allocation policy for large buffers: 2 MB huge pages above a size threshold, 64 byte
+// alignment for every block so SIMD loads never split a cache line
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace sp {
+
+enum class HugePagePolicy {
+    Off,      // aligned operator new only
+    Advise,   // 2 MB aligned mmap + madvise(MADV_HUGEPAGE), transparent huge pages
+    Reserve,  // MAP_HUGETLB from the reserved pool, Advise when the pool is empty
+};
+
+// process wide; the initial value comes from SP_HUGEPAGES=off|thp|hugetlb (default thp).
+// changing it only affects later allocations, frees always match their allocation
+void set_huge_page_policy(HugePagePolicy policy);
+HugePagePolicy huge_page_policy();
+
+// blocks smaller than this (default 4 MB) never use huge pages
+void set_huge_page_threshold(size_t bytes);
+size_t huge_page_threshold();
+
+struct HugePageStats {
+    uint64_t hugetlb_bytes;  // live bytes backed by MAP_HUGETLB
+    uint64_t advised_bytes;  // live bytes in madvise(MADV_HUGEPAGE) mappings
+    uint64_t small_bytes;    // live bytes from operator new
+};
+HugePageStats huge_page_stats();
+
+// 64 byte aligned; throws std::bad_alloc
+void* huge_alloc(size_t bytes);
+void huge_free(void* p) noexcept;
+
+template <class T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    HugePageAllocator() noexcept = default;
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(huge_alloc(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) noexcept { huge_free(p); }
+
+    template <class U>
+    bool operator==(const HugePageAllocator<U>&) const noexcept { return true; }
+    template <class U>
+    bool operator!=(const HugePageAllocator<U>&) const noexcept { return false; }
+};
+
+template <class T>
+using huge_vector = std::vector<T, HugePageAllocator<T>>;
+
+} // namespace sp
@@ -1,67 +1,132 @@
 // technical indicators like SMA, EMA, RSI, MACD for price analysis
 
 #include "indicator.h"
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 
 using namespace sp;
 
-// simple moving average - just averages last N prices
-std::vector<double> SMAIndicator::compute(const std::vector<double>& x) {
+namespace {
+
+// the indicators below are written as kernels over a run of prices that keep their state
+// between calls, so a whole vector and the blocks of a compact series go through the same
+// arithmetic and give the same values
+template <class Kernel>
+std::vector<double> run(Kernel kernel, const std::vector<double>& x) {
     std::vector<double> out(x.size(), NAN);
-    if (period_ <= 0) return out;
-    double sum = 0.0;
-    for (std::size_t i = 0; i < x.size(); ++i) {
-        sum += x[i];
-        if (i >= static_cast<std::size_t>(period_))
-            sum -= x[i - period_];
-        if (i + 1 >= static_cast<std::size_t>(period_))
-            out[i] = sum / period_;
-    }
+    kernel.feed(x.data(), x.size(), out.data());
     return out;
 }
 
-// exponential moving average - gives more weight to recent prices
-std::vector<double> EMAIndicator::compute(const std::vector<double>& x) {
-    std::vector<double> out(x.size(), NAN);
-    if (period_ <= 0 || x.empty()) return out;
-    double alpha = 2.0 / (period_ + 1);
-    double prev = x[0];
-    out[0] = prev;
-    for (std::size_t i = 1; i < x.size(); ++i) {
-        prev = alpha * x[i] + (1 - alpha) * prev;
-        out[i] = prev;
-    }
+template <class Kernel>
+std::vector<double> run(Kernel kernel, const CompactBarSeries& bars, BarColumn column) {
+    std::vector<double> out(bars.size(), NAN);
+    bars.for_each_block(column, [&](const double* x, std::size_t n, std::size_t first) {
+        kernel.feed(x, n, out.data() + first);
+    });
     return out;
 }
 
-// RSI - shows if stock is overbought or oversold (0-100 range)
-std::vector<double> RSIIndicator::compute(const std::vector<double>& x) {
-    std::vector<double> out(x.size(), NAN);
-    if (period_ <= 0 || x.size() < 2) return out;
-    std::vector<double> gains(x.size(), 0.0), losses(x.size(), 0.0);
-    for (std::size_t i = 1; i < x.size(); ++i) {
-        double diff = x[i] - x[i - 1];
-        gains[i] = std::max(0.0, diff);
-        losses[i] = std::max(0.0, -diff);
-    }
-    double avg_gain = 0.0, avg_loss = 0.0;
-    for (int i = 1; i <= period_ && i < (int)gains.size(); ++i) {
-        avg_gain += gains[i];
-        avg_loss += losses[i];
+// simple moving average - just averages last N prices
+struct SMAKernel {
+    int period;
+    std::vector<double> ring;  // last period prices
+    std::size_t i = 0;
+    double sum = 0.0;
+
+    explicit SMAKernel(int p) : period(p), ring(std::max(p, 1)) {}
+    void feed(const double* x, std::size_t n, double* out) {
+        if (period <= 0) return;
+        for (std::size_t k = 0; k < n; ++k, ++i) {
+            double& slot = ring[i % period];
+            sum += x[k];
+            if (i >= static_cast<std::size_t>(period))
+                sum -= slot;
+            slot = x[k];
+            if (i + 1 >= static_cast<std::size_t>(period))
+                out[k] = sum / period;
+        }
     }
-    avg_gain /= period_;
-    avg_loss /= period_;
-    if (period_ < (int)gains.size()) {
-        out[period_] = 100.0 - (100.0 / (1.0 + avg_gain / (avg_loss == 0 ? 1e-12 : avg_loss)));
+};
+
+// exponential moving average - gives more weight to recent prices
+struct EMAKernel {
+    int period;
+    std::size_t i = 0;
+    double prev = 0.0;
+
+    explicit EMAKernel(int p) : period(p) {}
+    void feed(const double* x, std::size_t n, double* out) {
+        if (period <= 0) return;
+        double alpha = 2.0 / (period + 1);
+        for (std::size_t k = 0; k < n; ++k, ++i) {
+            prev = i == 0 ? x[k] : alpha * x[k] + (1 - alpha) * prev;
+            out[k] = prev;
+        }
     }
-    for (std::size_t i = period_ + 1; i < x.size(); ++i) {
-        avg_gain = (avg_gain * (period_ - 1) + gains[i]) / period_;
-        avg_loss = (avg_loss * (period_ - 1) + losses[i]) / period_;
-        double rs = avg_gain / (avg_loss == 0 ? 1e-12 : avg_loss);
-        out[i] = 100.0 - (100.0 / (1.0 + rs));
+};
+
+// RSI - shows if stock is overbought or oversold (0-100 range)
+struct RSIKernel {
+    int period;
+    std::size_t i = 0;
+    double last = 0.0;
+    double avg_gain = 0.0, avg_loss = 0.0;
+
+    explicit RSIKernel(int p) : period(p) {}
+    void feed(const double* x, std::size_t n, double* out) {
+        if (period <= 0) return;
+        std::size_t p = static_cast<std::size_t>(period);
+        for (std::size_t k = 0; k < n; ++k, ++i) {
+            double diff = i == 0 ? 0.0 : x[k] - last;
+            last = x[k];
+            if (i == 0) continue;
+            double gain = std::max(0.0, diff), loss = std::max(0.0, -diff);
+            if (i <= p) {
+                // the first period changes are a plain average
+                avg_gain += gain;
+                avg_loss += loss;
+                if (i < p) continue;
+                avg_gain /= period;
+                avg_loss /= period;
+            } else {
+                avg_gain = (avg_gain * (period - 1) + gain) / period;
+                avg_loss = (avg_loss * (period - 1) + loss) / period;
+            }
+            out[k] = 100.0 - (100.0 / (1.0 + avg_gain / (avg_loss == 0 ? 1e-12 : avg_loss)));
+        }
     }
-    return out;
+};
+
+} // namespace
+
+std::vector<double> Indicator::compute(const CompactBarSeries& bars, BarColumn column) {
+    return compute(bars.column(column));
+}
+
+std::vector<double> SMAIndicator::compute(const std::vector<double>& x) {
+    return run(SMAKernel(period_), x);
+}
+
+std::vector<double> SMAIndicator::compute(const CompactBarSeries& bars, BarColumn column) {
+    return run(SMAKernel(period_), bars, column);
+}
+
+std::vector<double> EMAIndicator::compute(const std::vector<double>& x) {
+    return run(EMAKernel(period_), x);
+}
+
+std::vector<double> EMAIndicator::compute(const CompactBarSeries& bars, BarColumn column) {
+    return run(EMAKernel(period_), bars, column);
+}
+
+std::vector<double> RSIIndicator::compute(const std::vector<double>& x) {
+    return run(RSIKernel(period_), x);
+}
+
+std::vector<double> RSIIndicator::compute(const CompactBarSeries& bars, BarColumn column) {
+    return run(RSIKernel(period_), bars, column);
 }
 
 // MACD - difference between fast and slow EMA, helps spot trend changes
@@ -1,6 +1,7 @@
 // defines technical indicators for analyzing price trends
 
 #pragma once
+#include "compact_bars.h"
 #include <vector>
 
 namespace sp {
@@ -10,12 +11,16 @@ class Indicator {
 public:
     virtual ~Indicator() = default;
     virtual std::vector<double> compute(const std::vector<double>& prices) = 0;
+    // same values for one column of a compact series; the default decodes the whole column
+    virtual std::vector<double> compute(const CompactBarSeries& bars, BarColumn column);
 };
 
 class SMAIndicator : public Indicator {
 public:
     explicit SMAIndicator(int period) : period_(period) {}
     std::vector<double> compute(const std::vector<double>& prices) override;
+    // fed from CompactBarSeries::for_each_block, one decoded block at a time
+    std::vector<double> compute(const CompactBarSeries& bars, BarColumn column) override;
 private:
     int period_;
 };
@@ -24,6 +29,8 @@ class EMAIndicator : public Indicator {
 public:
     explicit EMAIndicator(int period) : period_(period) {}
     std::vector<double> compute(const std::vector<double>& prices) override;
+    // fed from CompactBarSeries::for_each_block, one decoded block at a time
+    std::vector<double> compute(const CompactBarSeries& bars, BarColumn column) override;
 private:
     int period_;
 };
@@ -32,6 +39,8 @@ class RSIIndicator : public Indicator {
 public:
     explicit RSIIndicator(int period) : period_(period) {}
     std::vector<double> compute(const std::vector<double>& prices) override;
+    // fed from CompactBarSeries::for_each_block, one decoded block at a time
+    std::vector<double> compute(const CompactBarSeries& bars, BarColumn column) override;
 private:
     int period_;
 };
@@ -39,6 +48,7 @@ private:
 class MACDIndicator : public Indicator {
 public:
     MACDIndicator(int fast, int slow) : fast_(fast), slow_(slow) {}
+    using Indicator::compute;
     std::vector<double> compute(const std::vector<double>& prices) override;
 private:
     int fast_;
@@ -1,43 +1,191 @@
 // simple linear regression model for predicting stock prices
 
 #include "linear_regression.h"
+#include "task_graph.h"
+#include "hash.h"
 #include <cmath>
 #include <stdexcept>
 #include <algorithm>
 #include <numeric>
+#include <cstring>
+#include <fstream>
 
 namespace sp {
 using namespace std;
 
+namespace {
+// training rows per gram block
+constexpr size_t kGramBlock = 8192;
+}
+
 LinearRegression::LinearRegression() : trained_(false) {}
 
+void GramStats::reset(size_t features) {
+    n_features = features;
+    rows = 0;
+    xtx.assign((features + 1) * (features + 1), 0.0);
+    xty.assign(features + 1, 0.0);
+    yty = 0.0;
+    source = 0;
+}
+
+uint64_t GramStats::fingerprint(const vector<vector<double>>& features, const vector<double>& targets,
+                                size_t rows) {
+    XXHash64 h;
+    rows = min(rows, min(features.size(), targets.size()));
+    auto row = [&](size_t i) {
+        h.update(features[i].data(), features[i].size() * sizeof(double));
+        h.update_value(targets[i]);
+    };
+    if (rows > kFingerprintRows) row(0);
+    for (size_t i = rows - min(rows, kFingerprintRows); i < rows; ++i) row(i);
+    h.update_value(static_cast<uint64_t>(rows));
+    return h.digest();
+}
+
+void GramStats::add(const vector<double>& x, double y) {
+    accumulate(x, y, 1.0);
+    ++rows;
+}
+
+void GramStats::remove(const vector<double>& x, double y) {
+    accumulate(x, y, -1.0);
+    --rows;
+}
+
+void GramStats::merge(const GramStats& other) {
+    if (other.n_features != n_features) {
+        throw invalid_argument("Gram statistics feature count mismatch");
+    }
+    for (size_t i = 0; i < xtx.size(); ++i) xtx[i] += other.xtx[i];
+    for (size_t i = 0; i < xty.size(); ++i) xty[i] += other.xty[i];
+    yty += other.yty;
+    rows += other.rows;
+}
+
+// rank-1 update with the implicit leading 1 for the intercept
+void GramStats::accumulate(const vector<double>& x, double y, double w) {
+    size_t p = n_features + 1;
+    for (size_t i = 0; i < p; ++i) {
+        double xi = (i == 0 ? 1.0 : x[i - 1]) * w;
+        double* row = &xtx[i * p];
+        row[i] += xi * (i == 0 ? 1.0 : x[i - 1]);
+        for (size_t j = i + 1; j < p; ++j) {
+            row[j] += xi * x[j - 1];
+        }
+        xty[i] += xi * y;
+    }
+    yty += w * y * y;
+}
+
+namespace {
+const char kGramMagic[8] = {'S', 'P', 'G', 'R', 'A', 'M', '2', '\0'};
+}
+
+bool GramStats::save(const string& path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) return false;
+    uint64_t p = n_features;
+    out.write(kGramMagic, sizeof(kGramMagic));
+    out.write(reinterpret_cast<const char*>(&p), sizeof(p));
+    out.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    out.write(reinterpret_cast<const char*>(&source), sizeof(source));
+    out.write(reinterpret_cast<const char*>(xtx.data()), xtx.size() * sizeof(double));
+    out.write(reinterpret_cast<const char*>(xty.data()), xty.size() * sizeof(double));
+    out.write(reinterpret_cast<const char*>(&yty), sizeof(yty));
+    return static_cast<bool>(out);
+}
+
+bool GramStats::load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    char magic[8];
+    uint64_t p = 0, n = 0, source = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&p), sizeof(p));
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    in.read(reinterpret_cast<char*>(&source), sizeof(source));
+    if (!in || memcmp(magic, kGramMagic, sizeof(magic)) != 0 || p > 100000) return false;
+    GramStats s;
+    s.reset(p);
+    s.rows = n;
+    s.source = source;
+    in.read(reinterpret_cast<char*>(s.xtx.data()), s.xtx.size() * sizeof(double));
+    in.read(reinterpret_cast<char*>(s.xty.data()), s.xty.size() * sizeof(double));
+    in.read(reinterpret_cast<char*>(&s.yty), sizeof(s.yty));
+    if (!in) return false;
+    *this = move(s);
+    return true;
+}
+
 // train model using normal equation: (X^T X)^-1 X^T y
 bool LinearRegression::train(const vector<vector<double>>& features,
                              const vector<double>& targets) {
     if (features.empty() || targets.empty() || features.size() != targets.size()) {
         return false;
     }
-    size_t n_samples = features.size();
-    size_t n_features = features[0].size();
+    gram_.reset(features[0].size());
+    return update(features, targets);
+}
+
+bool LinearRegression::update(const vector<vector<double>>& features,
+                              const vector<double>& targets) {
+    if (features.size() != targets.size()) {
+        return false;
+    }
+    if (gram_.xtx.empty() && !features.empty()) {
+        gram_.reset(features[0].size());
+    }
     for (const auto& f : features) {
-        if (f.size() != n_features) {
+        if (f.size() != gram_.n_features) {
             return false;
         }
     }
-    // add intercept column (all 1s) to feature matrix
-    vector<vector<double>> X(n_samples, vector<double>(n_features + 1));
-    for (size_t i = 0; i < n_samples; ++i) {
-        X[i][0] = 1.0;
-        for (size_t j = 0; j < n_features; ++j) {
-            X[i][j + 1] = features[i][j];
+    // accumulate X^T X and X^T y one row at a time, no copy of X
+    size_t blocks = (features.size() + kGramBlock - 1) / kGramBlock;
+    if (blocks <= 1) {
+        for (size_t i = 0; i < features.size(); ++i) {
+            gram_.add(features[i], targets[i]);
+        }
+        return solve();
+    }
+    vector<GramStats> parts(blocks);
+    TaskGraph graph;
+    TaskGraph::Task accumulated = graph.add_range(blocks, [&](size_t b) {
+        GramStats& part = parts[b];
+        part.reset(gram_.n_features);
+        size_t end = min(features.size(), (b + 1) * kGramBlock);
+        for (size_t i = b * kGramBlock; i < end; ++i) {
+            part.add(features[i], targets[i]);
+        }
+    });
+    graph.then(accumulated, [&] {
+        for (const auto& part : parts) gram_.merge(part);
+    });
+    graph.run(threads_);
+    return solve();
+}
+
+bool LinearRegression::set_gram(const GramStats& stats) {
+    gram_ = stats;
+    return solve();
+}
+
+bool LinearRegression::solve() {
+    trained_ = false;
+    if (gram_.rows == 0) {
+        return false;
+    }
+    size_t p = gram_.n_features + 1;
+    vector<vector<double>> XtX(p, vector<double>(p));
+    for (size_t i = 0; i < p; ++i) {
+        for (size_t j = i; j < p; ++j) {
+            XtX[i][j] = XtX[j][i] = gram_.xtx[i * p + j];
         }
     }
     try {
-        auto Xt = transpose(X);
-        auto XtX = multiply(Xt, X);
         auto XtX_inv = inverse(XtX);
-        auto Xty = multiply_vector(Xt, targets);
-        coefficients_ = multiply_vector(XtX_inv, Xty);
+        coefficients_ = multiply_vector(XtX_inv, gram_.xty);
         trained_ = true;
         return true;
     } catch (const exception&) {
@@ -3,10 +3,44 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <cstdint>
 
 namespace sp {
 using namespace std;
 
+// sufficient statistics of the normal equation (intercept column included):
+// X^T X, X^T y and y^T y over every row seen so far
+struct GramStats {
+    size_t n_features = 0;
+    uint64_t rows = 0;
+    vector<double> xtx;   // (n_features + 1)^2, upper triangle filled while accumulating
+    vector<double> xty;
+    double yty = 0.0;
+    uint64_t source = 0;  // fingerprint() of the rows accumulated, 0 = not recorded
+    
+    // hash of the first `rows` rows of X and y, to tell whether saved statistics were built
+    // from the rows a later run starts with. only the first row, the last
+    // kFingerprintRows and the count are hashed, so checking costs the same at any length;
+    // a revision further back goes unnoticed
+    static constexpr size_t kFingerprintRows = 64;
+    static uint64_t fingerprint(const vector<vector<double>>& features, const vector<double>& targets,
+                                size_t rows);
+    
+    void reset(size_t features);
+    void add(const vector<double>& x, double y);
+    // takes back a row added earlier, e.g. one whose source bars were revised
+    void remove(const vector<double>& x, double y);
+    // adds statistics gathered over other rows with the same features
+    void merge(const GramStats& other);
+    
+    // binary file, overwritten on save; load returns false if missing or malformed
+    bool save(const string& path) const;
+    bool load(const string& path);
+    
+private:
+    void accumulate(const vector<double>& x, double y, double w);
+};
+
 class LinearRegression {
 public:
     LinearRegression();
@@ -14,6 +48,17 @@ public:
     bool train(const vector<vector<double>>& features, 
                const vector<double>& targets);
     
+    // adds rows to the stored statistics and re-solves the (p+1)x(p+1) system,
+    // O(new_rows * p^2 + p^3) no matter how many rows came before. rows past one block
+    // are accumulated a block per task (task_graph.h) and merged in block order, so the
+    // sums don't depend on the thread count
+    bool update(const vector<vector<double>>& features,
+                const vector<double>& targets);
+    
+    // replaces the statistics (e.g. loaded from disk) and solves them
+    bool set_gram(const GramStats& stats);
+    const GramStats& gram() const { return gram_; }
+    
     double predict(const vector<double>& features) const;
     vector<double> predict_batch(const vector<vector<double>>& features) const;
     
@@ -26,9 +71,16 @@ public:
     const vector<double>& coefficients() const { return coefficients_; }
     bool is_trained() const { return trained_; }
     
+    // workers for train/update, 0 = one per core
+    void set_threads(unsigned threads) { threads_ = threads; }
+    
 private:
     vector<double> coefficients_;
     bool trained_;
+    GramStats gram_;
+    unsigned threads_ = 0;
+    
+    bool solve();
     
     // matrix math helpers for computing coefficients
     vector<vector<double>> transpose(const vector<vector<double>>& matrix) const;
@@ -0,0 +1,33 @@
+// read-only memory mapping of a whole file
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace sp {
+
+class MappedFile {
+public:
+    // throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+    void release();
+};
+
+} // namespace sp
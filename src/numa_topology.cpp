@@ -0,0 +1,161 @@
+// topology from libnuma or /sys/devices/system/node/node<N>/cpulist, intersected with the
+// process affinity mask so containers and taskset only see the cpus they can use
+
+#include "numa_topology.h"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef SP_HAVE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#else
+#include <sys/syscall.h>
+#if __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#endif
+#endif
+#endif
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+thread_local int t_node = -1;
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+vector<int> parse_cpulist(const string& text) {
+    vector<int> cpus;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == string::npos) end = text.size();
+        string part = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (part.empty() || part[0] < '0' || part[0] > '9') continue;
+        size_t dash = part.find('-');
+        int lo = stoi(part.substr(0, dash));
+        int hi = dash == string::npos ? lo : stoi(part.substr(dash + 1));
+        for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+#ifdef __linux__
+bool allowed(const cpu_set_t& mask, int cpu) {
+    return cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &mask);
+}
+#endif
+
+vector<NumaNode> raw_topology() {
+    vector<NumaNode> nodes;
+#if defined(__linux__) && defined(SP_HAVE_LIBNUMA)
+    if (numa_available() >= 0) {
+        bitmask* mask = numa_allocate_cpumask();
+        for (int n = 0; n <= numa_max_node(); ++n) {
+            if (numa_node_to_cpus(n, mask) != 0) continue;
+            NumaNode node;
+            node.id = n;
+            for (unsigned c = 0; c < mask->size; ++c) {
+                if (numa_bitmask_isbitset(mask, c)) node.cpus.push_back(static_cast<int>(c));
+            }
+            nodes.push_back(move(node));
+        }
+        numa_free_cpumask(mask);
+        return nodes;
+    }
+#endif
+#ifdef __linux__
+    // "online" uses the same list format as cpulist, and node ids can have holes
+    string online;
+    getline(ifstream("/sys/devices/system/node/online"), online);
+    for (int n : parse_cpulist(online)) {
+        ifstream in("/sys/devices/system/node/node" + to_string(n) + "/cpulist");
+        string text;
+        if (!getline(in, text)) continue;
+        NumaNode node;
+        node.id = n;
+        node.cpus = parse_cpulist(text);
+        nodes.push_back(move(node));
+    }
+#endif
+    return nodes;
+}
+
+} // namespace
+
+vector<NumaNode> numa_topology() {
+    vector<NumaNode> nodes = raw_topology();
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (auto& node : nodes) {
+            node.cpus.erase(remove_if(node.cpus.begin(), node.cpus.end(),
+                                      [&](int c) { return !allowed(mask, c); }),
+                            node.cpus.end());
+        }
+    }
+#endif
+    nodes.erase(remove_if(nodes.begin(), nodes.end(),
+                          [](const NumaNode& n) { return n.cpus.empty(); }),
+                nodes.end());
+    if (nodes.empty()) {
+        NumaNode node;
+        unsigned n = max(1u, thread::hardware_concurrency());
+        for (unsigned c = 0; c < n; ++c) node.cpus.push_back(static_cast<int>(c));
+        nodes.push_back(move(node));
+    }
+    return nodes;
+}
+
+bool pin_thread_to_node(const NumaNode& node) {
+    t_node = node.id;
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int c : node.cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &mask);
+    }
+    if (CPU_COUNT(&mask) == 0) return false;
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+}
+
+int current_thread_node() {
+    return t_node;
+}
+
+bool bind_to_node(void* p, size_t bytes, int node) {
+#if defined(__linux__) && (defined(SP_HAVE_LIBNUMA) || defined(MPOL_PREFERRED))
+    if (!p || bytes == 0 || node < 0 || node >= 1024) return false;
+    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(p) / page * page;
+    uintptr_t end = reinterpret_cast<uintptr_t>(p) + bytes;
+    unsigned long nodemask[1024 / (8 * sizeof(unsigned long))] = {};
+    const size_t bits = 8 * sizeof(unsigned long);
+    nodemask[node / bits] = 1ul << (node % bits);
+#ifdef SP_HAVE_LIBNUMA
+    return mbind(reinterpret_cast<void*>(begin), end - begin, MPOL_PREFERRED, nodemask,
+                 1024 + 1, 0) == 0;
+#else
+    // the kernel reads maxnode - 1 bits
+    return syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, nodemask, 1024 + 1, 0) == 0;
+#endif
+#else
+    (void)p;
+    (void)bytes;
+    (void)node;
+    return false;
+#endif
+}
+
+} // namespace sp
@@ -0,0 +1,31 @@
+// numa nodes and placement: which cpus belong to which node, pinning a thread to its
+// node and binding memory there. libnuma when built with it, sysfs + mbind otherwise;
+// without either (or on a single-socket box) everything is one node 0
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace sp {
+
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;  // only cpus this process may run on
+};
+
+// nodes that have at least one usable cpu, by id; never empty
+std::vector<NumaNode> numa_topology();
+
+// restricts the calling thread to the node's cpus and records it as the thread's node,
+// so memory it touches first (and huge_alloc mappings, huge_pages.h) land there.
+// false if the affinity could not be set; the node is recorded either way
+bool pin_thread_to_node(const NumaNode& node);
+
+// node recorded by pin_thread_to_node on this thread, -1 if none
+int current_thread_node();
+
+// prefers node for the pages covering [p, p + bytes) that are not yet touched;
+// false where unsupported or on failure, which is harmless
+bool bind_to_node(void* p, size_t bytes, int node);
+
+} // namespace sp
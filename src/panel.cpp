@@ -0,0 +1,111 @@
+// builds the unified date index with a heap-based k-way merge
+
+#include "panel.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+Panel Panel::build(const vector<string>& symbols, const vector<vector<Bar>>& series) {
+    if (symbols.size() != series.size()) {
+        throw invalid_argument("Symbols and series size mismatch");
+    }
+    size_t k = series.size();
+
+    // date keys once per bar, checked for order since the merge relies on it
+    vector<vector<int32_t>> keys(k);
+    for (size_t s = 0; s < k; ++s) {
+        keys[s].reserve(series[s].size());
+        for (const auto& b : series[s]) {
+            int32_t key = date_to_key(b.date);
+            if (!keys[s].empty() && key <= keys[s].back()) {
+                throw invalid_argument("Bars not sorted by unique date for symbol " + symbols[s]);
+            }
+            keys[s].push_back(key);
+        }
+    }
+
+    Panel p;
+    p.names_ = symbols;
+
+    // min-heap of (next date, symbol) cursors
+    using Cursor = pair<int32_t, size_t>;
+    priority_queue<Cursor, vector<Cursor>, greater<Cursor>> heap;
+    vector<size_t> pos(k, 0);
+    for (size_t s = 0; s < k; ++s) {
+        if (!keys[s].empty()) heap.emplace(keys[s][0], s);
+    }
+    while (!heap.empty()) {
+        auto [date, s] = heap.top();
+        heap.pop();
+        if (p.index_.empty() || p.index_.back() != date) p.index_.push_back(date);
+        if (++pos[s] < keys[s].size()) heap.emplace(keys[s][pos[s]], s);
+    }
+
+    size_t T = p.index_.size();
+    p.words_ = (T + 63) / 64;
+    for (auto& col : p.data_) col.assign(k * T, NAN);
+    p.observed_.assign(k * p.words_, 0);
+    p.valid_.assign(k * p.words_, 0);
+
+    // lay each symbol on the index, carrying its last prices forward; nothing traded on
+    // a date without a bar, so its volume is 0
+    for (size_t s = 0; s < k; ++s) {
+        const auto& bars = series[s];
+        size_t j = 0;
+        for (size_t t = 0; t < T; ++t) {
+            size_t word = s * p.words_ + t / 64;
+            uint64_t bit = uint64_t(1) << (t % 64);
+            if (j < bars.size() && keys[s][j] == p.index_[t]) {
+                const Bar& b = bars[j++];
+                size_t at = s * T + t;
+                p.data_[0][at] = b.open;
+                p.data_[1][at] = b.high;
+                p.data_[2][at] = b.low;
+                p.data_[3][at] = b.close;
+                p.data_[4][at] = b.volume;
+                p.observed_[word] |= bit;
+                p.valid_[word] |= bit;
+            } else if (j > 0) {
+                size_t at = s * T + t;
+                for (size_t f = 0; f < 4; ++f) p.data_[f][at] = p.data_[f][at - 1];
+                p.data_[4][at] = 0.0;
+                p.valid_[word] |= bit;
+            }
+        }
+    }
+    return p;
+}
+
+size_t Panel::position(int32_t date) const {
+    auto it = upper_bound(index_.begin(), index_.end(), date);
+    if (it == index_.begin()) return npos;
+    return static_cast<size_t>(it - index_.begin()) - 1;
+}
+
+double Panel::asof(PanelField f, size_t s, int32_t date) const {
+    size_t t = position(date);
+    if (t == npos) return NAN;
+    return at(f, s, t);
+}
+
+huge_vector<double> Panel::returns(size_t first, size_t rows) const {
+    size_t T = index_.size();
+    if (first + rows > T) throw out_of_range("Return rows past end of panel");
+    huge_vector<double> out(symbols() * rows, 0.0);
+    for (size_t s = 0; s < symbols(); ++s) {
+        const double* c = column(PanelField::Close, s);
+        for (size_t r = 0; r < rows; ++r) {
+            size_t t = first + r;
+            if (t == 0 || !valid(s, t) || !valid(s, t - 1) || c[t - 1] == 0.0) continue;
+            out[s * rows + r] = c[t] / c[t - 1] - 1.0;
+        }
+    }
+    return out;
+}
+
+} // namespace sp
@@ -0,0 +1,63 @@
+// symbols x dates panel aligned on one date index, with as-of (last known value) semantics
+
+#pragma once
+#include "csv_loader.h"
+#include "huge_pages.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+enum class PanelField { Open = 0, High, Low, Close, Volume };
+
+class Panel {
+public:
+    // k-way merge of every symbol's (sorted, unique) dates into one index, then each
+    // symbol's bars are laid on it; gaps and post-delisting dates carry the last prices
+    // forward with a volume of 0
+    static Panel build(const std::vector<std::string>& symbols,
+                       const std::vector<std::vector<Bar>>& series);
+
+    size_t symbols() const { return names_.size(); }
+    size_t dates() const { return index_.size(); }
+    const std::string& symbol(size_t s) const { return names_[s]; }
+    const std::vector<int32_t>& date_index() const { return index_; }
+
+    // one symbol's column for a field, dates() values; NaN before the first bar
+    const double* column(PanelField f, size_t s) const {
+        return &data_[static_cast<size_t>(f)][s * index_.size()];
+    }
+    double at(PanelField f, size_t s, size_t t) const { return column(f, s)[t]; }
+
+    // a bar for this symbol exists on date t
+    bool observed(size_t s, size_t t) const { return test(observed_, s, t); }
+    // a value exists at t, observed or carried forward
+    bool valid(size_t s, size_t t) const { return test(valid_, s, t); }
+
+    // position of the last index date <= date, or npos if date precedes the index
+    size_t position(int32_t date) const;
+    // as-of join: value of the field at the last date <= date (NaN if none); a volume is
+    // 0 unless the symbol has a bar on that index date
+    double asof(PanelField f, size_t s, int32_t date) const;
+
+    // simple close-to-close returns for rows [first, first + rows), column-major per
+    // symbol (ld = rows) as CorrelationEngine / FactorModel expect; missing values give 0
+    huge_vector<double> returns(size_t first, size_t rows) const;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    std::vector<std::string> names_;
+    std::vector<int32_t> index_;
+    huge_vector<double> data_[5];
+    // one bit per (symbol, date), each symbol's row padded to whole words
+    std::vector<uint64_t> observed_, valid_;
+    size_t words_ = 0;
+
+    bool test(const std::vector<uint64_t>& m, size_t s, size_t t) const {
+        return (m[s * words_ + t / 64] >> (t % 64)) & 1u;
+    }
+};
+
+} // namespace sp
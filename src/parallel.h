@@ -0,0 +1,38 @@
+// minimal thread helpers for the data-parallel kernels
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace sp {
+
+inline unsigned default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// runs f(i) for every i in [0, n); items are handed out one at a time so
+// uneven work (e.g. triangular tiles) still balances across threads
+template <class F>
+void parallel_for(size_t n, F&& f, unsigned threads = 0) {
+    if (threads == 0) threads = default_threads();
+    threads = static_cast<unsigned>(std::min<size_t>(threads, n));
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; ++i) f(i);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < n; i = next++) f(i);
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+} // namespace sp
@@ -0,0 +1,242 @@
+// segment layout: a 64 byte header, then one 64 byte slot per symbol. a slot's sequence
+// is odd while it is being written; readers copy the fields and keep the copy only if
+// the sequence was even and unchanged around it
+
+#include "prediction_table.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const uint64_t kTableMagic = 0x3154505053ull;  // "SPPT1"
+
+struct alignas(64) TableHeader {
+    atomic<uint64_t> magic;  // stored last by create(), so open() never sees a half-made table
+    uint32_t capacity;
+    uint32_t slot_size;
+};
+
+struct alignas(64) Slot {
+    atomic<uint64_t> sequence;
+    atomic<uint64_t> prediction;  // double bits
+    atomic<int64_t> date;
+    atomic<int64_t> timestamp_ns;
+    atomic<uint64_t> model_version;
+};
+
+static_assert(sizeof(TableHeader) == 64 && sizeof(Slot) == 64, "one cache line each");
+static_assert(atomic<uint64_t>::is_always_lock_free, "slots are shared between processes");
+
+size_t segment_size(uint32_t capacity) {
+    return sizeof(TableHeader) + size_t(capacity) * sizeof(Slot);
+}
+
+Slot* slots(void* base) {
+    return reinterpret_cast<Slot*>(static_cast<char*>(base) + sizeof(TableHeader));
+}
+
+string segment_name(const string& name) {
+    if (name.empty() || name.find_first_of("/\\") != string::npos) {
+        throw invalid_argument("shared memory name must be a plain identifier: " + name);
+    }
+#ifdef _WIN32
+    return "Local\\sp_" + name;
+#else
+    return "/sp_" + name;
+#endif
+}
+
+uint64_t bits(double v) {
+    uint64_t b;
+    memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+double from_bits(uint64_t b) {
+    double v;
+    memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+} // namespace
+
+int64_t PredictionTable::now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+}
+
+PredictionTable PredictionTable::create(const string& name, uint32_t capacity) {
+    string shm = segment_name(name);
+    size_t size = segment_size(capacity);
+    PredictionTable t;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(uint64_t(size) >> 32),
+                                        static_cast<DWORD>(size), shm.c_str());
+    if (!mapping) throw runtime_error("failed to create shared memory: " + name);
+    void* base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!base) {
+        CloseHandle(mapping);
+        throw runtime_error("failed to map shared memory: " + name);
+    }
+    t.mapping_ = mapping;
+#else
+    int fd = shm_open(shm.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) throw runtime_error("failed to create shared memory: " + name);
+    // shrink to nothing first so a reused segment starts zeroed
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        throw runtime_error("failed to size shared memory: " + name);
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) throw runtime_error("failed to map shared memory: " + name);
+#endif
+    t.base_ = base;
+    t.size_ = size;
+    t.capacity_ = capacity;
+    t.writable_ = true;
+    auto* header = new (base) TableHeader{};
+    for (uint32_t i = 0; i < capacity; ++i) new (&slots(base)[i]) Slot{};
+    header->capacity = capacity;
+    header->slot_size = sizeof(Slot);
+    header->magic.store(kTableMagic, memory_order_release);
+    return t;
+}
+
+PredictionTable PredictionTable::open(const string& name) {
+    string shm = segment_name(name);
+    PredictionTable t;
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, shm.c_str());
+    if (!mapping) throw runtime_error("no prediction table named " + name);
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info{};
+    if (!base || !VirtualQuery(base, &info, sizeof(info))) {
+        if (base) UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        throw runtime_error("failed to map shared memory: " + name);
+    }
+    t.mapping_ = mapping;
+    size_t size = info.RegionSize;
+#else
+    int fd = shm_open(shm.c_str(), O_RDONLY, 0);
+    if (fd < 0) throw runtime_error("no prediction table named " + name);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(TableHeader))) {
+        close(fd);
+        throw runtime_error("not a prediction table: " + name);
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) throw runtime_error("failed to map shared memory: " + name);
+#endif
+    t.base_ = base;
+    t.size_ = size;
+    const auto* header = static_cast<const TableHeader*>(base);
+    if (header->magic.load(memory_order_acquire) != kTableMagic || header->slot_size != sizeof(Slot)
+        || segment_size(header->capacity) > size) {
+        throw runtime_error("not a prediction table: " + name);
+    }
+    t.capacity_ = header->capacity;
+    return t;
+}
+
+bool PredictionTable::remove(const string& name) {
+#ifdef _WIN32
+    (void)segment_name(name);
+    return true;  // the mapping goes away with its last handle
+#else
+    return shm_unlink(segment_name(name).c_str()) == 0;
+#endif
+}
+
+PredictionTable::PredictionTable(PredictionTable&& other) noexcept {
+    *this = move(other);
+}
+
+PredictionTable& PredictionTable::operator=(PredictionTable&& other) noexcept {
+    if (this != &other) {
+        release();
+        base_ = other.base_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        writable_ = other.writable_;
+        other.base_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+#ifdef _WIN32
+        mapping_ = other.mapping_;
+        other.mapping_ = nullptr;
+#endif
+    }
+    return *this;
+}
+
+PredictionTable::~PredictionTable() {
+    release();
+}
+
+void PredictionTable::release() {
+    if (!base_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    if (mapping_) CloseHandle(mapping_);
+    mapping_ = nullptr;
+#else
+    munmap(base_, size_);
+#endif
+    base_ = nullptr;
+}
+
+void PredictionTable::publish(uint32_t symbol, const PredictionValue& value) {
+    if (!writable_) throw logic_error("prediction table opened read-only");
+    if (symbol >= capacity_) throw out_of_range("symbol id past the table capacity");
+    Slot& s = slots(base_)[symbol];
+    uint64_t seq = s.sequence.load(memory_order_relaxed);
+    s.sequence.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s.prediction.store(bits(value.prediction), memory_order_relaxed);
+    s.date.store(value.date, memory_order_relaxed);
+    s.timestamp_ns.store(value.timestamp_ns, memory_order_relaxed);
+    s.model_version.store(value.model_version, memory_order_relaxed);
+    s.sequence.store(seq + 2, memory_order_release);
+}
+
+bool PredictionTable::read(uint32_t symbol, PredictionValue& out) const {
+    if (symbol >= capacity_) return false;
+    const Slot& s = slots(base_)[symbol];
+    for (;;) {
+        uint64_t before = s.sequence.load(memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) continue;
+        PredictionValue v;
+        v.prediction = from_bits(s.prediction.load(memory_order_relaxed));
+        v.date = static_cast<int32_t>(s.date.load(memory_order_relaxed));
+        v.timestamp_ns = s.timestamp_ns.load(memory_order_relaxed);
+        v.model_version = s.model_version.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (s.sequence.load(memory_order_relaxed) == before) {
+            out = v;
+            return true;
+        }
+    }
+}
+
+} // namespace sp
@@ -0,0 +1,59 @@
+// latest prediction per symbol in a named shared-memory segment, for other processes on
+// the same host. every entry is its own seqlock on its own cache line: the writer never
+// waits, readers retry only while that entry is being written, neither makes a syscall
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sp {
+
+struct PredictionValue {
+    double prediction = 0.0;
+    int32_t date = 0;            // yyyymmdd of the bar the prediction was made at
+    int64_t timestamp_ns = 0;    // system clock (unix epoch) when it was published
+    uint64_t model_version = 0;  // identifies the coefficients that produced it
+};
+
+class PredictionTable {
+public:
+    // creates the segment, or resets an existing one, for symbol ids [0, capacity).
+    // name is a plain identifier; throws runtime_error
+    static PredictionTable create(const std::string& name, uint32_t capacity);
+    // maps an existing segment read-only; throws runtime_error if missing or not a table
+    static PredictionTable open(const std::string& name);
+    // the segment outlives its writer until removed
+    static bool remove(const std::string& name);
+
+    PredictionTable(PredictionTable&& other) noexcept;
+    PredictionTable& operator=(PredictionTable&& other) noexcept;
+    PredictionTable(const PredictionTable&) = delete;
+    PredictionTable& operator=(const PredictionTable&) = delete;
+    ~PredictionTable();  // unmaps, leaves the segment
+
+    uint32_t capacity() const { return capacity_; }
+
+    // one writer per symbol at a time; throws out_of_range past capacity
+    void publish(uint32_t symbol, const PredictionValue& value);
+
+    // latest complete value; false if the symbol was never published or is out of range
+    bool read(uint32_t symbol, PredictionValue& out) const;
+
+    static int64_t now_ns();  // timestamp_ns clock
+
+private:
+    PredictionTable() = default;
+
+    void* base_ = nullptr;
+    size_t size_ = 0;
+    uint32_t capacity_ = 0;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+
+    void release();
+};
+
+} // namespace sp
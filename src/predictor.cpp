@@ -3,25 +3,189 @@
 #include "csv_loader.h"
 #include "feature_engineer.h"
 #include "linear_regression.h"
+#include "feature_cache.h"
+#include "bar_cache.h"
+#include "bar_normalize.h"
+#include "adjustments.h"
+#include "range_index.h"
+#include "batch.h"
+#include "refresh.h"
+#include "feed.h"
+#include "streaming.h"
+#include "prediction_table.h"
+#include "hash.h"
+#include "task_graph.h"
 #include <iostream>
 #include <iomanip>
 #include <cmath>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
 
 using namespace sp;
 using namespace std;
 
+// --quality and its thresholds, shared by single-file and batch runs
+QualityRules quality_rules(map<string, string>& options) {
+    QualityRules rules;
+    if (options.count("quality")) rules.policy = parse_quality_policy(options["quality"].empty() ? "flag" : options["quality"]);
+    if (options.count("max-gap")) rules.max_gap = stod(options["max-gap"]);
+    if (options.count("volume-spike")) rules.volume_spike = stod(options["volume-spike"]);
+    return rules;
+}
+
+// --batch: every file in the directory is one symbol, loaded concurrently
+int run_batch(const string& dir, int prediction_days, double train_ratio,
+              map<string, string>& options) {
+    BatchConfig config;
+    config.features.lag_days = 5;
+    config.features.sma_period = 20;
+    config.features.ema_period = 12;
+    config.features.rsi_period = 14;
+    config.horizon = prediction_days;
+    config.train_ratio = train_ratio;
+    config.load.load.start_date = options["start"];
+    config.load.load.end_date = options["end"];
+    if (options.count("normalize")) {
+        config.load.load.normalize = true;
+        if (!options["normalize"].empty()) config.load.load.duplicates = parse_duplicate_policy(options["normalize"]);
+    }
+    config.load.load.quality = quality_rules(options);
+    if (options.count("in-flight")) config.load.in_flight = stoul(options["in-flight"]);
+    config.numa = options.count("numa") > 0;
+
+    auto paths = BatchRunner::list_files(dir);
+    if (paths.empty()) {
+        cerr << "Error: no .csv, .spb or .spa files in " << dir << "\n";
+        return 1;
+    }
+    cout << "[Batch] " << paths.size() << " symbols from " << dir << "\n";
+    vector<SymbolResult> results;
+    if (options.count("refresh")) {
+        if (config.numa) cerr << "Warning: --numa is not supported with --refresh, loading unsharded\n";
+        RefreshStats stats;
+        results = BatchRunner(config).refresh(paths, options["refresh"], &stats);
+        cout << "  Refresh: " << stats.unchanged << " unchanged, " << stats.updated << " updated, "
+             << stats.rebuilt << " rebuilt, " << stats.rows_computed << " feature rows computed\n";
+    } else {
+        vector<NodeThroughput> nodes;
+        results = BatchRunner(config).run(paths, &nodes);
+        for (const auto& n : nodes) {
+            double secs = max(n.seconds, 1e-9);
+            cout << "  Node " << n.node << ": " << n.threads << " threads, " << n.symbols
+                 << " symbols, " << n.bars << " bars in " << fixed << setprecision(3) << n.seconds
+                 << " s (" << setprecision(0) << n.symbols / secs << " symbols/s, "
+                 << n.bars / secs << " bars/s)\n";
+        }
+    }
+    size_t failed = 0;
+    for (const auto& r : results) {
+        if (!r.error.empty()) {
+            ++failed;
+            cerr << "  " << r.symbol << ": " << r.error << "\n";
+        }
+    }
+    BatchRunner::write_csv("output/batch_metrics.csv", results);
+    cout << "  " << results.size() - failed << " succeeded, " << failed << " failed\n";
+    cout << "Metrics saved to output/batch_metrics.csv\n";
+    return failed == results.size() ? 1 : 0;
+}
+
+// --subscribe: streams bars from a feed_publisher through the trained model; symbol 0
+// uses the model, other symbols only keep their features current. --publish-shm puts
+// every prediction into a shared-memory table (prediction_table.h) as it is made
+int run_subscriber(const string& uri, const FeatureConfig& config, const LinearRegression& model,
+                   map<string, string>& options) {
+    FeedEndpoint endpoint = FeedEndpoint::parse(uri);
+    cout << "\n[Live] Subscribing to " << endpoint.str() << "\n";
+    unique_ptr<PredictionTable> table;
+    if (options.count("publish-shm")) {
+        uint32_t symbols = options.count("shm-symbols") ? stoul(options["shm-symbols"]) : 4096;
+        table = make_unique<PredictionTable>(PredictionTable::create(options["publish-shm"], symbols));
+        cout << "  Publishing predictions to shared memory '" << options["publish-shm"] << "' ("
+             << symbols << " symbols)\n";
+    }
+    const auto& coeffs = model.coefficients();
+    uint64_t model_version = xxhash64(coeffs.data(), coeffs.size() * sizeof(double));
+    StreamingEngine engine(config, 1);
+    engine.set_model(0, model);
+    BarRecord last_bar;
+    double last_prediction = 0.0;
+    engine.start([&](const BarRecord& bar, double prediction) {
+        last_bar = bar;
+        last_prediction = prediction;
+        if (table && bar.symbol < table->capacity()) {
+            table->publish(bar.symbol, {prediction, bar.date, PredictionTable::now_ns(), model_version});
+        }
+    });
+    FeedSubscriber subscriber(endpoint);
+    // records go from the receive buffer straight into the compute thread's ring
+    FeedStats feed = subscriber.run([&](const BarRecord* bars, size_t n) { engine.push(bars, n); });
+    engine.stop();
+    StreamStats live = engine.stats();
+    double secs = max(feed.seconds, 1e-9);
+    cout << "  Received " << feed.bars << " bars in " << feed.messages << " messages ("
+         << feed.gaps << " lost";
+    if (feed.malformed) cout << ", " << feed.malformed << " malformed dropped";
+    cout << "), " << fixed << setprecision(3) << feed.seconds << " s, "
+         << setprecision(0) << feed.bars / secs << " bars/s\n";
+    cout << "  Predictions: " << live.predictions << ", publish to compute latency p50 "
+         << setprecision(1) << live.p50_latency_us << " us, p99 " << live.p99_latency_us << " us\n";
+    if (live.predictions) {
+        cout << "  Latest: " << key_to_date(last_bar.date) << " close $" << setprecision(2)
+             << last_bar.close << " -> predicted $" << last_prediction << "\n";
+    }
+    return feed.bars ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
+    // split args into positionals and --name=value options
+    vector<string> args;
+    map<string, string> options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            size_t eq = arg.find('=');
+            string name = arg.substr(2, eq == string::npos ? string::npos : eq - 2);
+            options[name] = eq == string::npos ? "" : arg.substr(eq + 1);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    
     // check command line args
-    if (argc < 2) {
-        cerr << "Usage: predictor <csv-path> [prediction_days=1] [train_ratio=0.8]\n";
+    if (args.empty()) {
+        cerr << "Usage: predictor <csv-path> [prediction_days=1] [train_ratio=0.8] [options]\n";
+        cerr << "\nOptions:\n";
+        cerr << "  --feature-cache=<dir>      reuse feature matrices across runs\n";
+        cerr << "  --feature-cache-mb=<n>     cache size limit in MB (default 256)\n";
+        cerr << "  --start=<YYYY-MM-DD>       first date to load\n";
+        cerr << "  --end=<YYYY-MM-DD>         last date to load\n";
+        cerr << "  --save-bars=<file.spb>     write the loaded bars as a binary cache\n";
+        cerr << "  --range-index              with --save-bars: store the range index in the cache\n";
+        cerr << "  --range-query=<start>:<end>  high, low, volume and vwap between two dates\n";
+        cerr << "  --normalize[=<policy>]     sort bars by time; same-time rows: keep, first, last (default), merge\n";
+        cerr << "  --adjustments=<file.csv>   split/dividend table (Date,Split,Dividend) applied when reading bars\n";
+        cerr << "  --quality[=<policy>]       check rows while parsing; flagged rows: flag (default), drop, clamp, ffill\n";
+        cerr << "  --max-gap=<fraction>       quality: largest move from the previous close (default 0.5)\n";
+        cerr << "  --volume-spike=<x>         quality: largest multiple of the average volume (default 20)\n";
+        cerr << "  --threads=<n>              workers for features, training and metrics (default: one per core)\n";
+        cerr << "  --gram-state=<file>        keep X^T X / X^T y between runs, add only new rows\n";
+        cerr << "  --batch                    <csv-path> is a directory, one symbol per file\n";
+        cerr << "  --in-flight=<n>            files loading at once in batch mode (default 64)\n";
+        cerr << "  --refresh=<dir>            batch mode: keep per-symbol state, redo only changed data\n";
+        cerr << "  --numa                     batch mode: shard symbols per numa node, report per node (not with --refresh)\n";
+        cerr << "  --subscribe=<tcp|udp://host:port>  after training, predict live from a feed_publisher\n";
+        cerr << "  --publish-shm=<name>       with --subscribe: latest prediction per symbol in shared memory\n";
+        cerr << "  --shm-symbols=<n>          symbol ids the shared table holds (default 4096)\n";
         cerr << "\nExample: predictor data/sample.csv 1 0.8\n";
         return 1;
     }
     
-    string csv_path = argv[1];
-    int prediction_days = argc > 2 ? stoi(argv[2]) : 1;
-    double train_ratio = argc > 3 ? stod(argv[3]) : 0.8;
+    string csv_path = args[0];
+    int prediction_days = args.size() > 1 ? stoi(args[1]) : 1;
+    double train_ratio = args.size() > 2 ? stod(args[2]) : 0.8;
     
     cout << "\n=== Stock Price Predictor ===\n\n";
     
@@ -32,10 +196,21 @@ int main(int argc, char* argv[]) {
               << ((1 - train_ratio) * 100) << "%\n\n";
     
     try {
+        if (options.count("batch")) {
+            return run_batch(csv_path, prediction_days, train_ratio, options);
+        }
+        
         // load csv data
         cout << "[Step 1/5] Loading Historical Data\n";
         CSVLoader loader(csv_path);
-        auto bars = loader.load();
+        LoadOptions load_options;
+        load_options.start_date = options["start"];
+        load_options.end_date = options["end"];
+        QualityRules rules = quality_rules(options);
+        // with --normalize the rows are checked once they are in order
+        if (!options.count("normalize")) load_options.quality = rules;
+        QualityReport quality;
+        auto bars = loader.load(load_options, &quality);
         
         if (bars.empty()) {
             cerr << "Error: No data found in CSV file\n";
@@ -43,7 +218,60 @@ int main(int argc, char* argv[]) {
         }
         
         cout << "  Loaded " << bars.size() << " trading days\n";
-        cout << "  Period: " << bars.front().date << " to " << bars.back().date << "\n\n";
+        if (options.count("normalize")) {
+            DuplicatePolicy policy = options["normalize"].empty() ? DuplicatePolicy::KeepLast
+                                                                  : parse_duplicate_policy(options["normalize"]);
+            NormalizeStats ns;
+            normalize_bars(bars, policy, &ns);
+            cout << "  Normalized: " << (ns.was_sorted ? "already in order" : "re-sorted by time") << ", "
+                 << ns.duplicates << " duplicate rows "
+                 << (policy == DuplicatePolicy::Merge ? "merged" : "dropped") << "\n";
+        }
+        if (options.count("normalize") && rules.policy != QualityPolicy::Off) {
+            quality = check_bars(bars, rules, kAllColumns);
+        }
+        if (rules.policy != QualityPolicy::Off) {
+            const char* names[kQualityRuleCount] = {"non-positive", "non-finite", "high<low", "gap", "volume spike"};
+            cout << "  Quality: " << quality.flagged << " of " << quality.rows << " rows flagged";
+            const char* sep = " (";
+            for (unsigned r = 0; r < kQualityRuleCount; ++r) {
+                if (!quality.rule_counts[r]) continue;
+                cout << sep << quality.rule_counts[r] << " " << names[r];
+                sep = ", ";
+            }
+            if (quality.flagged) cout << ")";
+            cout << ", " << quality.dropped << " dropped, " << quality.repaired << " repaired\n";
+        }
+        if (bars.empty()) {
+            cerr << "Error: No rows left after quality checks\n";
+            return 1;
+        }
+        cout << "  Period: " << bars.front().date << " to " << bars.back().date << "\n";
+        if (options.count("save-bars")) {
+            BarCache::write(options["save-bars"], bars, 1024, options.count("range-index") > 0);
+            cout << "  Binary bar cache written to " << options["save-bars"]
+                 << (options.count("range-index") ? " (with range index)" : "") << "\n";
+        }
+        if (options.count("range-query")) {
+            string spec = options["range-query"];
+            size_t colon = spec.find(':');
+            if (colon == string::npos) {
+                cerr << "Error: --range-query takes <start>:<end>\n";
+                return 1;
+            }
+            bool spb = csv_path.size() > 4 && csv_path.compare(csv_path.size() - 4, 4, ".spb") == 0;
+            RangeIndex index = spb ? BarCache::range_index(csv_path) : RangeIndex::build(bars);
+            RangeStats r = index.query(date_to_key(spec.substr(0, colon)), date_to_key(spec.substr(colon + 1)));
+            cout << "  Range " << spec << ": " << r.rows << " bars";
+            if (r.rows) {
+                cout << " (" << key_to_date(r.first_date) << " to " << key_to_date(r.last_date) << "), "
+                     << fixed << setprecision(2) << "open " << r.open << ", high " << r.high << ", low "
+                     << r.low << ", close " << r.close << ", volume " << setprecision(0) << r.volume
+                     << ", vwap " << setprecision(4) << r.vwap << defaultfloat << setprecision(6);
+            }
+            cout << "\n";
+        }
+        cout << "\n";
         
         // set up features (returns, lagged prices, indicators, etc)
         cout << "[Step 2/5] Engineering Features\n";
@@ -52,9 +280,32 @@ int main(int argc, char* argv[]) {
         config.sma_period = 20;
         config.ema_period = 12;
         config.rsi_period = 14;
+        unsigned threads = options.count("threads") ? stoul(options["threads"]) : 0;
+        config.threads = threads;
         
         FeatureEngineer engineer(config);
-        auto [features, targets] = engineer.create_features(bars, prediction_days);
+        vector<vector<double>> features;
+        vector<double> targets;
+        unique_ptr<AdjustedView> adjusted;
+        if (options.count("adjustments")) {
+            AdjustmentTable table = AdjustmentTable::load(options["adjustments"]);
+            adjusted = make_unique<AdjustedView>(bars, table);
+            cout << "  Adjusted for " << table.actions().size() << " corporate action(s), "
+                 << adjusted->segments().size() << " factor segment(s)\n";
+        }
+        if (options.count("feature-cache")) {
+            uint64_t limit_mb = options.count("feature-cache-mb") ? stoull(options["feature-cache-mb"]) : 256;
+            FeatureCache cache(options["feature-cache"], limit_mb << 20);
+            bool hit = false;
+            // the cache keys on the bars it is given, so it sees the adjusted ones
+            tie(features, targets) = cache.get_or_create(engineer, adjusted ? adjusted->to_bars() : bars,
+                                                         prediction_days, &hit);
+            cout << "  Feature cache " << (hit ? "hit" : "miss") << " (" << options["feature-cache"] << ")\n";
+        } else if (adjusted) {
+            tie(features, targets) = engineer.create_features(*adjusted, prediction_days);
+        } else {
+            tie(features, targets) = engineer.create_features(bars, prediction_days);
+        }
         
         if (features.empty()) {
             cerr << "Error: Insufficient data for feature creation\n";
@@ -83,11 +334,37 @@ int main(int argc, char* argv[]) {
         // train the model
         cout << "[Step 4/5] Training Model\n";
         LinearRegression model;
+        model.set_threads(threads);
         
-        if (!model.train(train_X, train_y)) {
+        // with --gram-state only the training rows past the saved row count are added;
+        // a state that doesn't fit this run (other features, fewer rows, or first rows that
+        // differ from the ones it was built on) is rebuilt
+        bool trained = false;
+        GramStats state;
+        bool loaded = options.count("gram-state") && state.load(options["gram-state"]);
+        if (loaded && !train_X.empty() && state.n_features == train_X[0].size()
+            && state.rows <= train_X.size()
+            && state.source == GramStats::fingerprint(train_X, train_y, state.rows) && model.set_gram(state)) {
+            size_t seen = state.rows;
+            vector<vector<double>> new_X(train_X.begin() + seen, train_X.end());
+            vector<double> new_y(train_y.begin() + seen, train_y.end());
+            trained = model.update(new_X, new_y);
+            cout << "  Incremental update: " << new_X.size() << " new rows ("
+                 << model.gram().rows << " total)\n";
+        } else if (loaded) {
+            cout << "  Saved statistics do not match these rows, refitting\n";
+        }
+        if (!trained && !model.train(train_X, train_y)) {
             cerr << "Error: Model training failed\n";
             return 1;
         }
+        if (options.count("gram-state")) {
+            GramStats saved = model.gram();
+            saved.source = GramStats::fingerprint(train_X, train_y, train_X.size());
+            if (!saved.save(options["gram-state"])) {
+                cerr << "Warning: could not write " << options["gram-state"] << "\n";
+            }
+        }
         
         cout << "  Model trained successfully\n\n";
         
@@ -104,9 +381,19 @@ int main(int argc, char* argv[]) {
         // check how well the model performs
         cout << "[Step 5/5] Evaluating Performance\n\n";
         
-        double train_mse = model.evaluate(train_X, train_y);
+        // the metrics and the test predictions are independent passes over the rows;
+        // small sets are not worth starting threads for
+        double train_mse = 0.0, train_r2 = 0.0, test_mse = 0.0, test_r2 = 0.0;
+        vector<double> test_pred;
+        TaskGraph metrics;
+        metrics.add([&] { train_mse = model.evaluate(train_X, train_y); });
+        metrics.add([&] { train_r2 = model.r_squared(train_X, train_y); });
+        metrics.add([&] { test_mse = model.evaluate(test_X, test_y); });
+        metrics.add([&] { test_r2 = model.r_squared(test_X, test_y); });
+        metrics.add([&] { test_pred = model.predict_batch(test_X); });
+        metrics.run(train_X.size() < 16384 ? 1 : threads);
+        
         double train_rmse = sqrt(train_mse);
-        double train_r2 = model.r_squared(train_X, train_y);
         
         cout << "Training Set Performance:\n";
         cout << "  Mean Squared Error:  " << fixed << setprecision(4) << train_mse << "\n";
@@ -114,9 +401,7 @@ int main(int argc, char* argv[]) {
         cout << "  R² Score:            " << setprecision(4) << train_r2 
                   << " (" << (train_r2 * 100) << "%)\n\n";
         
-        double test_mse = model.evaluate(test_X, test_y);
         double test_rmse = sqrt(test_mse);
-        double test_r2 = model.r_squared(test_X, test_y);
         
         cout << "Test Set Performance:\n";
         cout << "  Mean Squared Error:  " << fixed << setprecision(4) << test_mse << "\n";
@@ -135,7 +420,7 @@ int main(int argc, char* argv[]) {
         
         for (size_t i = 0; i < min(size_t(10), test_X.size()); ++i) {
             double actual = test_y[i];
-            double predicted = model.predict(test_X[i]);
+            double predicted = test_pred[i];
             double error = predicted - actual;
             double error_pct = (error / actual) * 100.0;
             
@@ -148,7 +433,7 @@ int main(int argc, char* argv[]) {
         
         for (size_t i = 0; i < test_X.size(); ++i) {
             double actual = test_y[i];
-            double predicted = model.predict(test_X[i]);
+            double predicted = test_pred[i];
             double error = predicted - actual;
             double error_pct = (error / actual) * 100.0;
             
@@ -183,6 +468,10 @@ int main(int argc, char* argv[]) {
             cout << "\n";
         }
         
+        if (options.count("subscribe") && run_subscriber(options["subscribe"], config, model, options) != 0) {
+            cerr << "Warning: no bars received from " << options["subscribe"] << "\n";
+        }
+        
         cout << "\n=== Analysis Complete ===\n\n";
         
     } catch (const exception& e) {
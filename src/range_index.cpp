@@ -0,0 +1,156 @@
+// range index tables; level k of a block table holds the extreme of 2^k blocks starting
+// at each block, so any run of whole blocks is covered by two overlapping entries
+
+#include "range_index.h"
+#include "bar_normalize.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+// floor(log2(v)) for v > 0
+uint32_t log2_floor(size_t v) {
+    uint32_t k = 0;
+    while (v >>= 1) ++k;
+    return k;
+}
+
+} // namespace
+
+RangeIndex RangeIndex::build(const vector<Bar>& bars) {
+    RangeIndex index;
+    size_t n = bars.size();
+    index.keys_.resize(n);
+    index.open_.resize(n);
+    index.high_.resize(n);
+    index.low_.resize(n);
+    index.close_.resize(n);
+    vector<double> volume(n);
+    for (size_t i = 0; i < n; ++i) {
+        index.keys_[i] = bar_time_key(bars[i].date);
+        if (i > 0 && index.keys_[i] <= index.keys_[i - 1]) {
+            throw invalid_argument("bars must be sorted by unique date and time: " + bars[i].date);
+        }
+        index.open_[i] = bars[i].open;
+        index.high_[i] = bars[i].high;
+        index.low_[i] = bars[i].low;
+        index.close_[i] = bars[i].close;
+        volume[i] = bars[i].volume;
+    }
+    index.build_tables(volume);
+    return index;
+}
+
+void RangeIndex::build_tables(const vector<double>& volume) {
+    size_t n = keys_.size();
+    volume_sum_.assign(n + 1, 0.0);
+    pv_sum_.assign(n + 1, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        double typical = (high_[i] + low_[i] + close_[i]) / 3.0;
+        volume_sum_[i + 1] = volume_sum_[i] + volume[i];
+        pv_sum_[i + 1] = pv_sum_[i] + typical * volume[i];
+    }
+
+    blocks_ = n / kBlock;
+    levels_ = blocks_ ? log2_floor(blocks_) + 1 : 0;
+    block_high_.assign(size_t(levels_) * blocks_, 0.0);
+    block_low_.assign(size_t(levels_) * blocks_, 0.0);
+    for (size_t b = 0; b < blocks_; ++b) {
+        const double* h = &high_[b * kBlock];
+        const double* l = &low_[b * kBlock];
+        block_high_[b] = *max_element(h, h + kBlock);
+        block_low_[b] = *min_element(l, l + kBlock);
+    }
+    for (uint32_t k = 1; k < levels_; ++k) {
+        size_t half = size_t(1) << (k - 1);
+        double* hi = &block_high_[k * blocks_];
+        double* lo = &block_low_[k * blocks_];
+        const double* hi_prev = hi - blocks_;
+        const double* lo_prev = lo - blocks_;
+        for (size_t b = 0; b + (half << 1) <= blocks_; ++b) {
+            hi[b] = max(hi_prev[b], hi_prev[b + half]);
+            lo[b] = min(lo_prev[b], lo_prev[b + half]);
+        }
+    }
+}
+
+double RangeIndex::extreme(const vector<double>& column, const vector<double>& table, size_t first,
+                           size_t last, bool want_max) const {
+    if (first >= last) return NAN;
+    if (last > size()) throw out_of_range("range past the end of the index");
+    double best = column[first];
+    auto take = [&](double v) { best = want_max ? max(best, v) : min(best, v); };
+    // whole blocks [fb, lb); the partial blocks at either end are scanned
+    size_t fb = (first + kBlock - 1) / kBlock, lb = last / kBlock;
+    if (fb >= lb) {
+        for (size_t i = first + 1; i < last; ++i) take(column[i]);
+        return best;
+    }
+    for (size_t i = first + 1; i < fb * kBlock; ++i) take(column[i]);
+    for (size_t i = lb * kBlock; i < last; ++i) take(column[i]);
+    uint32_t k = log2_floor(lb - fb);
+    const double* level = &table[k * blocks_];
+    take(level[fb]);
+    take(level[lb - (size_t(1) << k)]);
+    return best;
+}
+
+pair<size_t, size_t> RangeIndex::rows(int32_t start, int32_t end) const {
+    auto b = lower_bound(keys_.begin(), keys_.end(), day_time_key(start));
+    auto e = partition_point(b, keys_.end(), [&](uint64_t k) { return time_key_day(k) <= end; });
+    return {size_t(b - keys_.begin()), size_t(e - keys_.begin())};
+}
+
+pair<size_t, size_t> RangeIndex::rows_between(uint64_t start, uint64_t end) const {
+    auto b = lower_bound(keys_.begin(), keys_.end(), start);
+    auto e = upper_bound(b, keys_.end(), end);
+    return {size_t(b - keys_.begin()), size_t(e - keys_.begin())};
+}
+
+double RangeIndex::max_high(size_t first, size_t last) const {
+    return extreme(high_, block_high_, first, last, true);
+}
+
+double RangeIndex::min_low(size_t first, size_t last) const {
+    return extreme(low_, block_low_, first, last, false);
+}
+
+double RangeIndex::volume(size_t first, size_t last) const {
+    if (first >= last) return 0.0;
+    if (last > size()) throw out_of_range("range past the end of the index");
+    return volume_sum_[last] - volume_sum_[first];
+}
+
+double RangeIndex::vwap(size_t first, size_t last) const {
+    double v = volume(first, last);
+    return v > 0.0 ? (pv_sum_[last] - pv_sum_[first]) / v : NAN;
+}
+
+RangeStats RangeIndex::query_rows(size_t first, size_t last) const {
+    RangeStats s;
+    if (first >= last) {
+        s.open = s.high = s.low = s.close = s.vwap = NAN;
+        return s;
+    }
+    s.rows = last - first;
+    s.first_date = time_key_day(keys_.at(first));
+    s.last_date = time_key_day(keys_.at(last - 1));
+    s.open = open_[first];
+    s.close = close_[last - 1];
+    s.high = max_high(first, last);
+    s.low = min_low(first, last);
+    s.volume = volume(first, last);
+    s.vwap = vwap(first, last);
+    return s;
+}
+
+RangeStats RangeIndex::query(int32_t start, int32_t end) const {
+    auto [first, last] = rows(start, end);
+    return query_rows(first, last);
+}
+
+} // namespace sp
@@ -0,0 +1,64 @@
+// constant-time aggregates over any row or date range of a bar series: block sparse
+// tables for the highest high / lowest low, prefix sums for volume and vwap
+
+#pragma once
+#include "csv_loader.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+struct RangeStats {
+    size_t rows = 0;  // 0 when the range holds no bars; the prices are then NaN
+    int32_t first_date = 0, last_date = 0;  // yyyymmdd days of the first and last row
+    double open = 0.0, high = 0.0, low = 0.0, close = 0.0;
+    double volume = 0.0;
+    double vwap = 0.0;  // volume weighted typical price (high + low + close) / 3
+};
+
+// min/max use a sparse table over blocks of kBlock rows plus a scan of at most two
+// partial blocks; the table is (n / kBlock) log(n / kBlock) per column, so it stays
+// small enough to store next to the bars (BarCache::write)
+class RangeIndex {
+public:
+    static constexpr size_t kBlock = 32;
+
+    // daily or intraday bars sorted by unique bar_time_key (bar_normalize.h);
+    // O(n + (n / kBlock) log n). throws invalid_argument
+    static RangeIndex build(const std::vector<Bar>& bars);
+
+    size_t size() const { return keys_.size(); }
+
+    // rows [first, last) on the days in [start, end], yyyymmdd, inclusive
+    std::pair<size_t, size_t> rows(int32_t start, int32_t end) const;
+    // rows [first, last) with bar_time_key in [start, end], e.g. part of a trading day
+    std::pair<size_t, size_t> rows_between(uint64_t start, uint64_t end) const;
+
+    // row ranges [first, last); empty ranges give NaN (max/min) or 0 (sums)
+    double max_high(size_t first, size_t last) const;
+    double min_low(size_t first, size_t last) const;
+    double volume(size_t first, size_t last) const;
+    double vwap(size_t first, size_t last) const;
+
+    // everything above at once, for rows [first, last) or for dates in [start, end]
+    RangeStats query_rows(size_t first, size_t last) const;
+    RangeStats query(int32_t start, int32_t end) const;
+
+private:
+    friend class BarCache;  // stores and restores the tables
+
+    std::vector<uint64_t> keys_;  // bar_time_key of each row
+    std::vector<double> open_, high_, low_, close_;
+    std::vector<double> volume_sum_, pv_sum_;     // n + 1 prefix sums
+    size_t blocks_ = 0;
+    uint32_t levels_ = 0;
+    std::vector<double> block_high_, block_low_;  // levels_ rows of blocks_
+
+    void build_tables(const std::vector<double>& volume);
+    double extreme(const std::vector<double>& column, const std::vector<double>& table, size_t first,
+                   size_t last, bool want_max) const;
+};
+
+} // namespace sp
@@ -0,0 +1,376 @@
+// batch refresh: manifest.tsv (fingerprint + last result per source file) and one <file>.sps
+// state file each, both under the state directory
+
+#include "refresh.h"
+#include "feature_cache.h"
+#include "hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[8] = {'S', 'P', 'S', 'Y', 'M', 'S', '1', '\0'};
+const size_t kTailBytes = 4096;
+
+template <class T>
+void put(ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <class T>
+void put_vector(ostream& out, const vector<T>& v) {
+    put<uint64_t>(out, v.size());
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+void put_string(ostream& out, const string& s) {
+    put<uint64_t>(out, s.size());
+    out.write(s.data(), s.size());
+}
+
+template <class T>
+bool get(istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+template <class T>
+bool get_vector(istream& in, vector<T>& v, uint64_t limit = 1ull << 32) {
+    uint64_t n;
+    if (!get(in, n) || n > limit) return false;
+    v.resize(n);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()), n * sizeof(T)));
+}
+
+bool get_string(istream& in, string& s) {
+    uint64_t n;
+    if (!get(in, n) || n > (1u << 20)) return false;
+    s.resize(n);
+    return static_cast<bool>(in.read(&s[0], n));
+}
+
+struct ManifestEntry {
+    SourceFingerprint source;
+    uint64_t config_key = 0;
+    SymbolResult result;
+};
+
+// state is kept per file name, not per symbol: AAPL.csv and AAPL.spb in one directory
+// are two sources with their own fingerprints and states
+string state_key(const string& path) {
+    return fs::path(path).filename().string();
+}
+
+// file size mtime tail config bars train test rmse r2 last, tab separated
+map<string, ManifestEntry> read_manifest(const fs::path& path) {
+    map<string, ManifestEntry> entries;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        string key;
+        ManifestEntry e;
+        SymbolResult& r = e.result;
+        fields >> key >> e.source.size >> e.source.mtime_ns >> hex >> e.source.tail_hash
+               >> e.config_key >> dec >> r.bars >> r.train_rows >> r.test_rows >> r.test_rmse
+               >> r.test_r2 >> r.last_prediction;
+        r.symbol = fs::path(key).stem().string();
+        if (fields) entries[key] = e;
+    }
+    return entries;
+}
+
+void write_manifest(const fs::path& path, const map<string, ManifestEntry>& entries) {
+    fs::path tmp = path.string() + ".tmp";
+    {
+        ofstream out(tmp);
+        if (!out) throw runtime_error("failed to open the file: " + tmp.string());
+        out.precision(17);
+        for (const auto& [key, e] : entries) {
+            const SymbolResult& r = e.result;
+            out << key << '\t' << e.source.size << '\t' << e.source.mtime_ns << '\t' << hex
+                << e.source.tail_hash << '\t' << e.config_key << dec << '\t' << r.bars << '\t'
+                << r.train_rows << '\t' << r.test_rows << '\t' << r.test_rmse << '\t' << r.test_r2
+                << '\t' << r.last_prediction << '\n';
+        }
+        if (!out) throw runtime_error("failed to write the file: " + tmp.string());
+    }
+    fs::rename(tmp, path);
+}
+
+} // namespace
+
+SourceFingerprint fingerprint_file(const string& path) {
+    SourceFingerprint fp;
+    error_code ec;
+    fp.size = fs::file_size(path, ec);
+    if (ec) throw runtime_error("failed to open the file: " + path);
+    auto mtime = fs::last_write_time(path, ec);
+    fp.mtime_ns = chrono::duration_cast<chrono::nanoseconds>(mtime.time_since_epoch()).count();
+
+    size_t tail = static_cast<size_t>(min<uint64_t>(fp.size, kTailBytes));
+    string buf(tail, '\0');
+    ifstream in(path, ios::binary);
+    in.seekg(static_cast<streamoff>(fp.size - tail));
+    if (!in || !in.read(&buf[0], tail)) throw runtime_error("failed to read the file: " + path);
+    fp.tail_hash = xxhash64(buf.data(), buf.size());
+    return fp;
+}
+
+vector<uint64_t> SymbolState::hash_blocks(const vector<Bar>& bars) {
+    vector<uint64_t> hashes;
+    for (size_t b0 = 0; b0 < bars.size(); b0 += kBlock) {
+        XXHash64 h;
+        for (size_t i = b0; i < min(bars.size(), b0 + kBlock); ++i) {
+            const Bar& b = bars[i];
+            h.update(b.date);
+            h.update_value(b.open);
+            h.update_value(b.high);
+            h.update_value(b.low);
+            h.update_value(b.close);
+            h.update_value(b.volume);
+        }
+        hashes.push_back(h.digest());
+    }
+    return hashes;
+}
+
+bool SymbolState::save(const string& path) const {
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) return false;
+        out.write(kMagic, sizeof(kMagic));
+        put(out, config_key);
+        put(out, source.size);
+        put(out, source.mtime_ns);
+        put(out, source.tail_hash);
+        put(out, n_bars);
+        put(out, cols);
+        put_vector(out, block_hashes);
+        put_vector(out, features);
+        put_vector(out, targets);
+        put_vector(out, bar_index);
+        put<uint64_t>(out, gram.n_features);
+        put(out, gram.rows);
+        put_vector(out, gram.xtx);
+        put_vector(out, gram.xty);
+        put(out, gram.yty);
+        put_string(out, result.symbol);
+        put<uint64_t>(out, result.bars);
+        put<uint64_t>(out, result.train_rows);
+        put<uint64_t>(out, result.test_rows);
+        put(out, result.test_rmse);
+        put(out, result.test_r2);
+        put(out, result.last_prediction);
+        if (!out) return false;
+    }
+    error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool SymbolState::load(const string& path) {
+    ifstream in(path, ios::binary);
+    char magic[8];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(magic)) != 0) return false;
+    SymbolState s;
+    uint64_t n_features = 0, bars = 0, train = 0, test = 0;
+    bool ok = get(in, s.config_key) && get(in, s.source.size) && get(in, s.source.mtime_ns)
+              && get(in, s.source.tail_hash) && get(in, s.n_bars) && get(in, s.cols)
+              && get_vector(in, s.block_hashes) && get_vector(in, s.features)
+              && get_vector(in, s.targets) && get_vector(in, s.bar_index)
+              && get(in, n_features) && get(in, s.gram.rows) && get_vector(in, s.gram.xtx)
+              && get_vector(in, s.gram.xty) && get(in, s.gram.yty)
+              && get_string(in, s.result.symbol) && get(in, bars) && get(in, train) && get(in, test)
+              && get(in, s.result.test_rmse) && get(in, s.result.test_r2)
+              && get(in, s.result.last_prediction);
+    s.gram.n_features = n_features;
+    if (!ok || s.features.size() != s.targets.size() * s.cols || s.bar_index.size() != s.targets.size()
+        || s.gram.xtx.size() != (n_features + 1) * (n_features + 1) || s.gram.xty.size() != n_features + 1) {
+        return false;
+    }
+    s.result.bars = bars;
+    s.result.train_rows = train;
+    s.result.test_rows = test;
+    *this = move(s);
+    return true;
+}
+
+vector<SymbolResult> BatchRunner::refresh(const vector<string>& paths, const string& state_dir,
+                                          RefreshStats* stats) const {
+    fs::create_directories(state_dir);
+    fs::path manifest_path = fs::path(state_dir) / "manifest.tsv";
+    auto manifest = read_manifest(manifest_path);
+    uint64_t config_key = feature_config_key(FeatureEngineer(config_.features), config_.horizon);
+    // the split ratio decides which rows the statistics cover, the load options which bars
+    // a file yields
+    XXHash64 h(config_key);
+    const LoadOptions& load = config_.load.load;
+    h.update_value(config_.train_ratio);
+    h.update(load.start_date);
+    h.update(load.end_date);
+    h.update_value(load.columns);
+    h.update_value(static_cast<uint8_t>(load.normalize));
+    h.update_value(load.duplicates);
+    h.update_value(load.quality.policy);
+    h.update_value(load.quality.max_gap);
+    h.update_value(load.quality.volume_spike);
+    h.update_value(static_cast<uint64_t>(load.quality.volume_window));
+    h.update_value(static_cast<uint64_t>(load.quality.reanchor_rows));
+    config_key = h.digest();
+
+    RefreshStats local;
+    RefreshStats& st = stats ? *stats : local;
+    st = RefreshStats{};
+    vector<SymbolResult> results(paths.size());
+    vector<SourceFingerprint> fingerprints(paths.size());
+    vector<string> changed;
+    vector<size_t> changed_index;
+    map<string, ManifestEntry> next;
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        string key = state_key(paths[i]);
+        try {
+            fingerprints[i] = fingerprint_file(paths[i]);
+        } catch (const exception& e) {
+            results[i].symbol = fs::path(paths[i]).stem().string();
+            results[i].error = e.what();
+            continue;
+        }
+        auto it = manifest.find(key);
+        if (it != manifest.end() && it->second.source == fingerprints[i]
+            && it->second.config_key == config_key) {
+            results[i] = it->second.result;
+            next[key] = it->second;
+            ++st.unchanged;
+        } else {
+            changed.push_back(paths[i]);
+            changed_index.push_back(i);
+        }
+    }
+
+    mutex m;
+    load_many_async(changed, [&](size_t c, LoadedSeries& series) {
+        size_t i = changed_index[c];
+        string key = state_key(series.path);
+        SymbolResult& r = results[i];
+        r.symbol = fs::path(series.path).stem().string();
+        if (!series.error.empty()) {
+            r.error = series.error;
+            return;
+        }
+        const vector<Bar>& bars = series.bars;
+        string state_path = (fs::path(state_dir) / (key + ".sps")).string();
+        SymbolState s;
+        bool have = s.load(state_path) && s.config_key == config_key;
+
+        // first bar that differs from what the state was built on
+        auto blocks = SymbolState::hash_blocks(bars);
+        size_t changed_bar = 0;
+        if (have) {
+            size_t b = 0, nb = min(blocks.size(), s.block_hashes.size());
+            while (b < nb && blocks[b] == s.block_hashes[b]) ++b;
+            changed_bar = min<size_t>(b * SymbolState::kBlock, min<size_t>(s.n_bars, bars.size()));
+        }
+        // a row built at bar i reads bars up to i and its target at i + horizon
+        size_t h = static_cast<size_t>(config_.horizon);
+        size_t first_bar = changed_bar > h ? changed_bar - h : 0;
+
+        FeatureConfig features_config = config_.features;
+        features_config.threads = 1;  // one symbol per loader worker already
+        FeatureEngineer engineer(features_config);
+        vector<size_t> idx;
+        auto [X, y] = engineer.create_features(bars, config_.horizon, have ? first_bar : 0, &idx);
+        if (have && !X.empty() && X[0].size() != s.cols) {
+            have = false;
+            tie(X, y) = engineer.create_features(bars, config_.horizon, 0, &idx);
+        }
+        if (!have) {
+            s = SymbolState{};
+            s.config_key = config_key;
+            s.cols = X.empty() ? 0 : X[0].size();
+            s.gram.reset(s.cols);
+        }
+        size_t keep = have ? lower_bound(s.bar_index.begin(), s.bar_index.end(), first_bar)
+                                 - s.bar_index.begin()
+                           : 0;
+        size_t cols = s.cols;
+        size_t total = keep + X.size();
+        size_t t = static_cast<size_t>(total * config_.train_ratio);
+
+        // statistics cover rows [0, g); take back the ones that changed, then add up to t
+        size_t g = s.gram.rows;
+        size_t from = min({g, keep, t});
+        vector<double> row(cols);
+        for (size_t k = from; k < g; ++k) {
+            row.assign(s.features.begin() + k * cols, s.features.begin() + (k + 1) * cols);
+            s.gram.remove(row, s.targets[k]);
+        }
+        s.features.resize(keep * cols);
+        s.targets.resize(keep);
+        s.bar_index.resize(keep);
+        for (size_t k = 0; k < X.size(); ++k) {
+            s.features.insert(s.features.end(), X[k].begin(), X[k].end());
+            s.targets.push_back(y[k]);
+            s.bar_index.push_back(static_cast<uint32_t>(idx[k]));
+        }
+        for (size_t k = from; k < t; ++k) {
+            row.assign(s.features.begin() + k * cols, s.features.begin() + (k + 1) * cols);
+            s.gram.add(row, s.targets[k]);
+        }
+        s.n_bars = bars.size();
+        s.block_hashes = move(blocks);
+        s.source = fingerprints[i];
+
+        r.bars = bars.size();
+        r.train_rows = t;
+        r.test_rows = total - t;
+        LinearRegression model;
+        if (t == 0 || t == total) {
+            r.error = "insufficient data";
+        } else if (!model.set_gram(s.gram)) {
+            r.error = "training failed";
+        } else {
+            vector<vector<double>> test_X;
+            for (size_t k = t; k < total; ++k) {
+                test_X.emplace_back(s.features.begin() + k * cols, s.features.begin() + (k + 1) * cols);
+            }
+            vector<double> test_y(s.targets.begin() + t, s.targets.end());
+            r.test_rmse = sqrt(model.evaluate(test_X, test_y));
+            r.test_r2 = model.r_squared(test_X, test_y);
+            r.last_prediction = model.predict(test_X.back());
+        }
+        s.result = r;
+        bool saved = r.error.empty() && s.save(state_path);
+
+        lock_guard<mutex> lock(m);
+        st.rows_computed += X.size();
+        ++(have ? st.updated : st.rebuilt);
+        if (saved) next[key] = {s.source, config_key, r};
+    }, config_.load);
+
+    // states of files that are gone
+    for (const auto& [key, e] : manifest) {
+        if (!next.count(key)) {
+            error_code ec;
+            fs::remove(fs::path(state_dir) / (key + ".sps"), ec);
+        }
+    }
+    write_manifest(manifest_path, next);
+    return results;
+}
+
+} // namespace sp
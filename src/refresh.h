@@ -0,0 +1,61 @@
+// per-symbol state that lets a batch run redo only the symbols (and bars) that changed
+
+#pragma once
+#include "batch.h"
+#include "linear_regression.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+// cheap identity of a source file: size, modification time and a hash of its last 4 KiB,
+// so appended or rewritten files are caught without reading them whole
+struct SourceFingerprint {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t tail_hash = 0;
+
+    bool operator==(const SourceFingerprint& o) const {
+        return size == o.size && mtime_ns == o.mtime_ns && tail_hash == o.tail_hash;
+    }
+    bool operator!=(const SourceFingerprint& o) const { return !(*this == o); }
+};
+
+// throws runtime_error if the file can't be read
+SourceFingerprint fingerprint_file(const std::string& path);
+
+// everything needed to continue a symbol: hashes of its bars in blocks (to find the
+// first revised bar), the feature rows with the bar each was built at, and the
+// normal-equation statistics of the training rows
+struct SymbolState {
+    static constexpr size_t kBlock = 256;
+
+    uint64_t config_key = 0;
+    SourceFingerprint source;
+    uint64_t n_bars = 0;
+    std::vector<uint64_t> block_hashes;  // last block may be partial
+    uint64_t cols = 0;
+    std::vector<double> features;        // row-major
+    std::vector<double> targets;
+    std::vector<uint32_t> bar_index;
+    GramStats gram;
+    SymbolResult result;
+
+    size_t rows() const { return targets.size(); }
+
+    static std::vector<uint64_t> hash_blocks(const std::vector<Bar>& bars);
+
+    // binary, written to a temp file and renamed; load returns false if missing or malformed
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+struct RefreshStats {
+    size_t unchanged = 0;     // fingerprint matched, nothing read
+    size_t updated = 0;       // continued from the first changed bar
+    size_t rebuilt = 0;       // no usable state, full run
+    size_t rows_computed = 0; // feature rows built this run
+};
+
+} // namespace sp
@@ -0,0 +1,178 @@
+// small vector kernels with AVX2 / SSE2 paths and a scalar fallback. built for baseline
+// x86-64 (SP_ENABLE_NATIVE off), the AVX2 kernels of the archive decoder are compiled for
+// that target alone and picked at run time
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SP_AVX2 1
+#define SP_AVX2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SP_AVX2 1
+#define SP_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SP_SSE2 1
+#endif
+
+namespace sp {
+namespace simd {
+
+namespace detail {
+
+#if defined(SP_AVX2)
+inline bool avx2() {
+#if defined(__AVX2__)
+    return true;
+#else
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#endif
+}
+
+// the vector parts below return how many leading elements they handled
+
+SP_AVX2_TARGET inline size_t prefix_sum_i64_avx2(int64_t* v, size_t n, int64_t start) {
+    // log-step scan inside each 4-lane vector, then add the running carry
+    size_t i = 0;
+    __m256i carry = _mm256_set1_epi64x(start);
+    __m256i zero = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        __m256i s1 = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), zero, 0x03);
+        x = _mm256_add_epi64(x, s1);
+        __m256i s2 = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x40), zero, 0x0F);
+        x = _mm256_add_epi64(_mm256_add_epi64(x, s2), carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i), x);
+        carry = _mm256_permute4x64_epi64(x, 0xFF);
+    }
+    return i;
+}
+
+SP_AVX2_TARGET inline size_t i64_div_to_f64_avx2(const int64_t* in, size_t n, double divisor,
+                                                  double* out) {
+    // int64 -> double without AVX-512: add the 1.5 * 2^52 bias in the integer domain
+    size_t i = 0;
+    const __m256i magic_i = _mm256_set1_epi64x(0x4338000000000000LL);
+    const __m256d magic_d = _mm256_set1_pd(6755399441055744.0);
+    __m256d div = _mm256_set1_pd(divisor);
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256d d = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(x, magic_i)), magic_d);
+        _mm256_storeu_pd(out + i, _mm256_div_pd(d, div));
+    }
+    return i;
+}
+#endif
+
+#if defined(SP_SSE2)
+inline size_t prefix_sum_i64_sse2(int64_t* v, size_t n, int64_t start) {
+    size_t i = 0;
+    __m128i carry = _mm_set1_epi64x(start);
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        x = _mm_add_epi64(_mm_add_epi64(x, _mm_slli_si128(x, 8)), carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), x);
+        carry = _mm_unpackhi_epi64(x, x);
+    }
+    return i;
+}
+
+inline size_t i64_div_to_f64_sse2(const int64_t* in, size_t n, double divisor, double* out) {
+    size_t i = 0;
+    const __m128i magic_i = _mm_set1_epi64x(0x4338000000000000LL);
+    const __m128d magic_d = _mm_set1_pd(6755399441055744.0);
+    __m128d div = _mm_set1_pd(divisor);
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128d d = _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(x, magic_i)), magic_d);
+        _mm_storeu_pd(out + i, _mm_div_pd(d, div));
+    }
+    return i;
+}
+#endif
+
+} // namespace detail
+
+// out[i] = (base + in[i]) * scale; the add is exact for integer inputs, so every
+// path gives bit-identical results
+inline void i32_affine(const int32_t* in, size_t n, double base, double scale, double* out) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256d vb = _mm256_set1_pd(base), vs = _mm256_set1_pd(scale);
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m256d v = _mm256_add_pd(_mm256_cvtepi32_pd(x), vb);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(v, vs));
+    }
+#elif defined(SP_SSE2)
+    __m128d vb = _mm_set1_pd(base), vs = _mm_set1_pd(scale);
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        __m128d v = _mm_add_pd(_mm_cvtepi32_pd(x), vb);
+        _mm_storeu_pd(out + i, _mm_mul_pd(v, vs));
+    }
+#endif
+    for (; i < n; ++i) out[i] = (base + static_cast<double>(in[i])) * scale;
+}
+
+// out[i] = double(in[i]) for unsigned 32-bit values
+inline void u32_to_f64(const uint32_t* in, size_t n, double* out) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    // signed convert, then add 2^32 where the top bit made the value negative
+    __m256d two32 = _mm256_set1_pd(4294967296.0), zero = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m256d v = _mm256_cvtepi32_pd(x);
+        __m256d fix = _mm256_and_pd(_mm256_cmp_pd(v, zero, _CMP_LT_OQ), two32);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(v, fix));
+    }
+#elif defined(SP_SSE2)
+    __m128d two32 = _mm_set1_pd(4294967296.0), zero = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        __m128d v = _mm_cvtepi32_pd(x);
+        __m128d fix = _mm_and_pd(_mm_cmplt_pd(v, zero), two32);
+        _mm_storeu_pd(out + i, _mm_add_pd(v, fix));
+    }
+#endif
+    for (; i < n; ++i) out[i] = static_cast<double>(in[i]);
+}
+
+// in-place inclusive prefix sum, v[i] = start + v[0] + ... + v[i]
+inline void prefix_sum_i64(int64_t* v, size_t n, int64_t start) {
+    size_t i = 0;
+#if defined(SP_AVX2)
+    if (detail::avx2()) i = detail::prefix_sum_i64_avx2(v, n, start);
+#endif
+#if defined(SP_SSE2)
+    if (i == 0) i = detail::prefix_sum_i64_sse2(v, n, start);
+#endif
+    if (i > 0) start = v[i - 1];
+    for (; i < n; ++i) {
+        start += v[i];
+        v[i] = start;
+    }
+}
+
+// out[i] = double(in[i]) / divisor for |in[i]| < 2^51; division (not a reciprocal
+// multiply) keeps decimal prices exact
+inline void i64_div_to_f64(const int64_t* in, size_t n, double divisor, double* out) {
+    size_t i = 0;
+#if defined(SP_AVX2)
+    if (detail::avx2()) i = detail::i64_div_to_f64_avx2(in, n, divisor, out);
+#endif
+#if defined(SP_SSE2)
+    if (i == 0) i = detail::i64_div_to_f64_sse2(in, n, divisor, out);
+#endif
+    for (; i < n; ++i) out[i] = static_cast<double>(in[i]) / divisor;
+}
+
+} // namespace simd
+} // namespace sp
@@ -0,0 +1,271 @@
+// libsp: C entry points over FeatureEngineer + LinearRegression, no exception crosses the boundary
+
+#include "sp_api.h"
+#include "csv_loader.h"
+#include "bar_cache.h"
+#include "range_index.h"
+#include "feature_engineer.h"
+#include "huge_pages.h"
+#include "linear_regression.h"
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace sp;
+using namespace std;
+
+struct sp_pipeline {
+    int prediction_days = 1;
+    double train_ratio = 0.8;
+    FeatureConfig config;
+    vector<Bar> bars;
+
+    // results, flat so callers can wrap them without copying
+    huge_vector<double> features;
+    size_t rows = 0, cols = 0;
+    vector<double> targets;
+    vector<double> predictions;
+    vector<double> coefficients;
+    vector<string> names;
+    sp_metrics metrics{};
+    bool ran = false;
+    string error;
+    unique_ptr<RangeIndex> range;  // built on demand over bars
+
+    void reset_results() {
+        range.reset();
+        features.clear();
+        targets.clear();
+        predictions.clear();
+        coefficients.clear();
+        names.clear();
+        rows = cols = 0;
+        metrics = sp_metrics{};
+        ran = false;
+    }
+
+    int fail(int code, string message) {
+        error = move(message);
+        return code;
+    }
+};
+
+struct sp_range_index {
+    RangeIndex index;
+};
+
+namespace {
+
+void copy_stats(const RangeStats& s, sp_range_stats* out) {
+    out->rows = s.rows;
+    out->first_date = s.first_date;
+    out->last_date = s.last_date;
+    out->open = s.open;
+    out->high = s.high;
+    out->low = s.low;
+    out->close = s.close;
+    out->volume = s.volume;
+    out->vwap = s.vwap;
+}
+
+double rmse(const vector<double>& pred, const vector<double>& y, size_t a, size_t b) {
+    double s = 0.0;
+    for (size_t i = a; i < b; ++i) s += (pred[i] - y[i]) * (pred[i] - y[i]);
+    return b > a ? sqrt(s / (b - a)) : 0.0;
+}
+
+double r2(const vector<double>& pred, const vector<double>& y, size_t a, size_t b) {
+    if (b <= a) return 0.0;
+    double mean = 0.0;
+    for (size_t i = a; i < b; ++i) mean += y[i];
+    mean /= (b - a);
+    double ss_res = 0.0, ss_tot = 0.0;
+    for (size_t i = a; i < b; ++i) {
+        ss_res += (y[i] - pred[i]) * (y[i] - pred[i]);
+        ss_tot += (y[i] - mean) * (y[i] - mean);
+    }
+    return ss_tot == 0.0 ? 0.0 : 1.0 - ss_res / ss_tot;
+}
+
+} // namespace
+
+extern "C" {
+
+int sp_api_version(void) {
+    return SP_API_VERSION;
+}
+
+sp_pipeline* sp_pipeline_create(int prediction_days, double train_ratio) {
+    if (prediction_days < 1 || !(train_ratio > 0.0 && train_ratio < 1.0)) return nullptr;
+    sp_pipeline* p = new (nothrow) sp_pipeline;
+    if (!p) return nullptr;
+    p->prediction_days = prediction_days;
+    p->train_ratio = train_ratio;
+    p->config.lag_days = 5;
+    p->config.sma_period = 20;
+    p->config.ema_period = 12;
+    p->config.rsi_period = 14;
+    return p;
+}
+
+void sp_pipeline_free(sp_pipeline* p) {
+    delete p;
+}
+
+int sp_pipeline_push_bars(sp_pipeline* p, const int32_t* dates, const double* open,
+                          const double* high, const double* low, const double* close,
+                          const double* volume, size_t n) {
+    if (!p) return SP_ERR_ARGUMENT;
+    if (n > 0 && (!dates || !open || !high || !low || !close)) {
+        return p->fail(SP_ERR_ARGUMENT, "null column pointer");
+    }
+    try {
+        int32_t prev = p->bars.empty() ? INT32_MIN : date_to_key(p->bars.back().date);
+        for (size_t i = 0; i < n; ++i) {
+            if (dates[i] <= prev) {
+                return p->fail(SP_ERR_ARGUMENT, "dates must increase: " + to_string(dates[i]));
+            }
+            prev = dates[i];
+        }
+        p->reset_results();
+        p->bars.reserve(p->bars.size() + n);
+        for (size_t i = 0; i < n; ++i) {
+            p->bars.push_back({key_to_date(dates[i]), open[i], high[i], low[i], close[i],
+                               volume ? volume[i] : 0.0});
+        }
+    } catch (const exception& e) {
+        return p->fail(SP_ERR_ARGUMENT, e.what());
+    }
+    p->error.clear();
+    return SP_OK;
+}
+
+void sp_pipeline_clear(sp_pipeline* p) {
+    if (!p) return;
+    p->bars.clear();
+    p->reset_results();
+    p->error.clear();
+}
+
+int sp_pipeline_run(sp_pipeline* p) {
+    if (!p) return SP_ERR_ARGUMENT;
+    p->reset_results();
+    try {
+        FeatureEngineer engineer(p->config);
+        auto [X, y] = engineer.create_features(p->bars, p->prediction_days);
+        if (X.empty()) return p->fail(SP_ERR_DATA, "insufficient data for feature creation");
+
+        size_t n_train = static_cast<size_t>(X.size() * p->train_ratio);
+        LinearRegression model;
+        if (n_train == 0
+            || !model.train(vector<vector<double>>(X.begin(), X.begin() + n_train),
+                            vector<double>(y.begin(), y.begin() + n_train))) {
+            return p->fail(SP_ERR_TRAIN, "model training failed");
+        }
+
+        p->rows = X.size();
+        p->cols = X[0].size();
+        p->features.reserve(p->rows * p->cols);
+        for (const auto& row : X) p->features.insert(p->features.end(), row.begin(), row.end());
+        p->predictions = model.predict_batch(X);
+        p->targets = move(y);
+        p->coefficients = model.coefficients();
+        p->names = engineer.get_feature_names();
+
+        auto& m = p->metrics;
+        m.train_rows = n_train;
+        m.test_rows = p->rows - n_train;
+        m.train_rmse = rmse(p->predictions, p->targets, 0, n_train);
+        m.train_r2 = r2(p->predictions, p->targets, 0, n_train);
+        m.test_rmse = rmse(p->predictions, p->targets, n_train, p->rows);
+        m.test_r2 = r2(p->predictions, p->targets, n_train, p->rows);
+        p->ran = true;
+    } catch (const bad_alloc&) {
+        return p->fail(SP_ERR_INTERNAL, "out of memory");
+    } catch (const exception& e) {
+        return p->fail(SP_ERR_INTERNAL, e.what());
+    }
+    p->error.clear();
+    return SP_OK;
+}
+
+const double* sp_pipeline_features(const sp_pipeline* p, size_t* rows, size_t* cols) {
+    if (rows) *rows = p ? p->rows : 0;
+    if (cols) *cols = p ? p->cols : 0;
+    return p && p->ran ? p->features.data() : nullptr;
+}
+
+const double* sp_pipeline_targets(const sp_pipeline* p, size_t* n) {
+    if (n) *n = p ? p->targets.size() : 0;
+    return p && p->ran ? p->targets.data() : nullptr;
+}
+
+const double* sp_pipeline_predictions(const sp_pipeline* p, size_t* n) {
+    if (n) *n = p ? p->predictions.size() : 0;
+    return p && p->ran ? p->predictions.data() : nullptr;
+}
+
+const double* sp_pipeline_coefficients(const sp_pipeline* p, size_t* n) {
+    if (n) *n = p ? p->coefficients.size() : 0;
+    return p && p->ran ? p->coefficients.data() : nullptr;
+}
+
+const char* sp_pipeline_feature_name(const sp_pipeline* p, size_t index) {
+    return p && index < p->names.size() ? p->names[index].c_str() : nullptr;
+}
+
+int sp_pipeline_metrics(const sp_pipeline* p, sp_metrics* out) {
+    if (!p || !out) return SP_ERR_ARGUMENT;
+    if (!p->ran) return SP_ERR_DATA;
+    *out = p->metrics;
+    return SP_OK;
+}
+
+const char* sp_pipeline_error(const sp_pipeline* p) {
+    return p ? p->error.c_str() : "null pipeline";
+}
+
+int sp_pipeline_range_query(sp_pipeline* p, int32_t start_date, int32_t end_date, sp_range_stats* out) {
+    if (!p) return SP_ERR_ARGUMENT;
+    if (!out) return p->fail(SP_ERR_ARGUMENT, "null stats pointer");
+    try {
+        if (!p->range) p->range = make_unique<RangeIndex>(RangeIndex::build(p->bars));
+        copy_stats(p->range->query(start_date, end_date), out);
+    } catch (const bad_alloc&) {
+        return p->fail(SP_ERR_INTERNAL, "out of memory");
+    } catch (const exception& e) {
+        return p->fail(SP_ERR_INTERNAL, e.what());
+    }
+    p->error.clear();
+    return SP_OK;
+}
+
+sp_range_index* sp_range_index_open(const char* path) {
+    if (!path) return nullptr;
+    try {
+        string file = path;
+        bool spb = file.size() > 4 && file.compare(file.size() - 4, 4, ".spb") == 0;
+        return new sp_range_index{spb ? BarCache::range_index(file) : RangeIndex::build(CSVLoader(file).load())};
+    } catch (const exception&) {
+        return nullptr;
+    }
+}
+
+void sp_range_index_free(sp_range_index* index) {
+    delete index;
+}
+
+int sp_range_index_query(const sp_range_index* index, int32_t start_date, int32_t end_date, sp_range_stats* out) {
+    if (!index || !out) return SP_ERR_ARGUMENT;
+    try {
+        copy_stats(index->index.query(start_date, end_date), out);
+    } catch (const exception&) {
+        return SP_ERR_INTERNAL;
+    }
+    return SP_OK;
+}
+
+} // extern "C"
@@ -0,0 +1,104 @@
+/* C interface to the prediction pipeline (libsp), usable from ctypes and other FFIs.
+ * every pointer returned by a getter points into the pipeline and stays valid until
+ * the next push, run or free on it. functions returning int give SP_OK or an SP_ERR_* code */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(SP_BUILDING_LIBRARY)
+#    define SP_API __declspec(dllexport)
+#  else
+#    define SP_API __declspec(dllimport)
+#  endif
+#else
+#  define SP_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 2: range queries (sp_range_stats, sp_pipeline_range_query, sp_range_index_*) */
+#define SP_API_VERSION 2
+
+enum {
+    SP_OK = 0,
+    SP_ERR_ARGUMENT = -1,   /* null pointer, bad size or date */
+    SP_ERR_DATA = -2,       /* too few bars for the feature windows */
+    SP_ERR_TRAIN = -3,      /* singular system */
+    SP_ERR_INTERNAL = -4
+};
+
+typedef struct sp_pipeline sp_pipeline;
+
+typedef struct sp_metrics {
+    double train_rmse;
+    double train_r2;
+    double test_rmse;
+    double test_r2;
+    size_t train_rows;
+    size_t test_rows;
+} sp_metrics;
+
+SP_API int sp_api_version(void);
+
+/* default feature set, as the predictor executable uses it */
+SP_API sp_pipeline* sp_pipeline_create(int prediction_days, double train_ratio);
+SP_API void sp_pipeline_free(sp_pipeline* p);
+
+/* appends n bars; dates are yyyymmdd integers and must increase. the arrays stay owned
+ * by the caller and are only read during the call; volume may be null */
+SP_API int sp_pipeline_push_bars(sp_pipeline* p, const int32_t* dates, const double* open,
+                                 const double* high, const double* low, const double* close,
+                                 const double* volume, size_t n);
+SP_API void sp_pipeline_clear(sp_pipeline* p);
+
+/* builds features, fits on the first train_ratio of the rows and predicts every row */
+SP_API int sp_pipeline_run(sp_pipeline* p);
+
+/* row-major rows x cols */
+SP_API const double* sp_pipeline_features(const sp_pipeline* p, size_t* rows, size_t* cols);
+SP_API const double* sp_pipeline_targets(const sp_pipeline* p, size_t* n);
+/* one prediction per feature row; the first train_rows are in-sample */
+SP_API const double* sp_pipeline_predictions(const sp_pipeline* p, size_t* n);
+/* intercept first, then one weight per feature */
+SP_API const double* sp_pipeline_coefficients(const sp_pipeline* p, size_t* n);
+SP_API const char* sp_pipeline_feature_name(const sp_pipeline* p, size_t index);
+SP_API int sp_pipeline_metrics(const sp_pipeline* p, sp_metrics* out);
+
+/* message for the last failed call on p, "" if none */
+SP_API const char* sp_pipeline_error(const sp_pipeline* p);
+
+/* aggregates over the bars dated [start_date, end_date] (yyyymmdd, inclusive). rows is 0
+ * and the prices NaN when no bar falls in the range. vwap weights the typical price
+ * (high + low + close) / 3 by volume */
+typedef struct sp_range_stats {
+    size_t rows;
+    int32_t first_date;
+    int32_t last_date;
+    double open;
+    double high;
+    double low;
+    double close;
+    double volume;
+    double vwap;
+} sp_range_stats;
+
+/* constant time per query over the pushed bars; the index is built on the first query
+ * after a push or clear */
+SP_API int sp_pipeline_range_query(sp_pipeline* p, int32_t start_date, int32_t end_date,
+                                   sp_range_stats* out);
+
+/* a range index over a file: a .spb bar cache (its stored index, or built from its
+ * columns) or any file the loader reads. NULL on failure */
+typedef struct sp_range_index sp_range_index;
+SP_API sp_range_index* sp_range_index_open(const char* path);
+SP_API void sp_range_index_free(sp_range_index* index);
+SP_API int sp_range_index_query(const sp_range_index* index, int32_t start_date, int32_t end_date,
+                                sp_range_stats* out);
+
+#ifdef __cplusplus
+}
+#endif
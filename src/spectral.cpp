@@ -0,0 +1,172 @@
+// FFT based autocorrelation, periodogram and their rolling-window versions
+
+#include "spectral.h"
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <numeric>
+
+namespace sp {
+using namespace std;
+
+namespace {
+const double kPi = 3.14159265358979323846;
+} // namespace
+
+vector<double> autocovariance_fft(const vector<double>& x, int max_lag) {
+    size_t n = x.size();
+    if (n == 0 || max_lag < 0) return {};
+    double mu = accumulate(x.begin(), x.end(), 0.0) / n;
+
+    // zero padding past n + max_lag keeps the circular correlation linear
+    size_t m = next_pow2(n + max_lag + 1);
+    vector<double> d(m, 0.0);
+    for (size_t i = 0; i < n; ++i) d[i] = x[i] - mu;
+    auto spec = rfft(d);
+    for (auto& c : spec) c = cplx(norm(c), 0.0);
+    auto corr = irfft(spec, m);
+
+    vector<double> r(max_lag + 1, 0.0);
+    for (int k = 0; k <= max_lag && static_cast<size_t>(k) < n; ++k) r[k] = corr[k] / n;
+    return r;
+}
+
+vector<double> periodogram(const vector<double>& x) {
+    size_t n = x.size();
+    if (n == 0) return {};
+    double mu = accumulate(x.begin(), x.end(), 0.0) / n;
+    vector<double> d(n);
+    for (size_t i = 0; i < n; ++i) d[i] = x[i] - mu;
+    auto spec = rfft(d);
+    vector<double> p(spec.size());
+    for (size_t k = 0; k < spec.size(); ++k) p[k] = norm(spec[k]) / n;
+    return p;
+}
+
+SpectralColumns rolling_spectral(const vector<double>& x, int window, int hop,
+                                 const vector<int>& lags, int bands) {
+    size_t n = x.size();
+    SpectralColumns out;
+    out.acf.assign(lags.size(), vector<double>(n, NAN));
+    out.band_power.assign(max(bands, 0), vector<double>(n, NAN));
+    if (window <= 1 || hop <= 0) return out;
+
+    // windows are made of whole blocks
+    size_t H = static_cast<size_t>(hop);
+    size_t blocks_per_window = (static_cast<size_t>(window) + H - 1) / H;
+    size_t W = blocks_per_window * H;
+    size_t L = 0;
+    for (int lag : lags) L = max(L, static_cast<size_t>(max(lag, 0)));
+
+    // every lag uses W products x_t * x_{t-k} with t inside the window,
+    // so block b starts at L + b*H and needs L points of history before it
+    if (n < L + W) return out;
+    size_t n_blocks = (n - L) / H;
+
+    vector<double> prefix(n + 1, 0.0);
+    for (size_t i = 0; i < n; ++i) prefix[i + 1] = prefix[i] + x[i];
+    auto range_sum = [&](size_t a, size_t b) { return prefix[b] - prefix[a]; };
+
+    // cross-correlation of one block with its L-extended segment, all lags at once
+    size_t fft_n = next_pow2(2 * H + L);
+    auto block_lag_sums = [&](size_t start) {
+        vector<double> seg(fft_n, 0.0), blk(fft_n, 0.0);
+        for (size_t u = 0; u < H + L; ++u) seg[u] = x[start - L + u];
+        for (size_t u = 0; u < H; ++u) blk[u] = x[start + u];
+        auto A = rfft(seg);
+        auto B = rfft(blk);
+        for (size_t k = 0; k < A.size(); ++k) A[k] *= conj(B[k]);
+        auto c = irfft(A, fft_n);
+        vector<double> s(L + 1);
+        for (size_t k = 0; k <= L; ++k) s[k] = c[L - k];
+        return s;
+    };
+
+    // the window's DFT at bins k = 2*pi*k/W is the sum of its blocks' DFTs when every point
+    // is phased by its absolute position t mod W; that only rotates the window's spectrum,
+    // and demeaning only moves the DC bin, so |S_k|^2 / W is the periodogram for k >= 1
+    size_t K = W / 2 + 1;
+    vector<cplx> twiddle(W);
+    for (size_t j = 0; j < W; ++j) twiddle[j] = polar(1.0, -2.0 * kPi * j / W);
+    auto block_spectrum = [&](size_t start) {
+        vector<cplx> s(K);
+        if (H * H <= 4 * W) {
+            // short blocks: direct sums beat a transform of the whole window
+            for (size_t u = 0; u < H; ++u) {
+                size_t step = (start + u) % W, idx = step;
+                for (size_t k = 1; k < K; ++k) {
+                    s[k] += x[start + u] * twiddle[idx];
+                    idx += step;
+                    if (idx >= W) idx -= W;
+                }
+            }
+            return s;
+        }
+        vector<double> seg(W, 0.0);
+        for (size_t u = 0; u < H; ++u) seg[(start + u) % W] = x[start + u];
+        auto f = rfft(seg);
+        copy(f.begin() + 1, f.end(), s.begin() + 1);
+        return s;
+    };
+
+    deque<vector<double>> history;  // lag sums of the blocks in the current window
+    deque<vector<cplx>> spectra;    // and their spectra when bands are wanted
+    vector<double> running(L + 1, 0.0);
+    vector<cplx> spectrum(K);
+
+    for (size_t b = 0; b < n_blocks; ++b) {
+        size_t start = L + b * H;
+        auto s = block_lag_sums(start);
+        for (size_t k = 0; k <= L; ++k) running[k] += s[k];
+        history.push_back(move(s));
+        if (history.size() > blocks_per_window) {
+            for (size_t k = 0; k <= L; ++k) running[k] -= history.front()[k];
+            history.pop_front();
+        }
+        if (bands > 0) {
+            auto f = block_spectrum(start);
+            for (size_t k = 1; k < K; ++k) spectrum[k] += f[k];
+            spectra.push_back(move(f));
+            if (spectra.size() > blocks_per_window) {
+                for (size_t k = 1; k < K; ++k) spectrum[k] -= spectra.front()[k];
+                spectra.pop_front();
+            }
+        }
+        if (b + 1 < blocks_per_window) continue;
+
+        size_t win_end = start + H;     // exclusive
+        size_t win_start = win_end - W;
+        size_t fill_end = min(n, win_end - 1 + H);
+        double mu = range_sum(win_start, win_end) / W;
+        double sum_t = range_sum(win_start, win_end);
+
+        auto centered = [&](size_t k) {
+            double sum_lagged = range_sum(win_start - k, win_end - k);
+            return running[k] - mu * (sum_t + sum_lagged) + W * mu * mu;
+        };
+        double c0 = centered(0);
+        for (size_t j = 0; j < lags.size(); ++j) {
+            double v = (c0 > 0.0 && lags[j] >= 0) ? centered(lags[j]) / c0 : NAN;
+            for (size_t i = win_end - 1; i < fill_end; ++i) out.acf[j][i] = v;
+        }
+
+        if (bands > 0) {
+            vector<double> p(K);
+            for (size_t k = 1; k < K; ++k) p[k] = norm(spectrum[k]) / W;
+            // DC bin left out, the rest split into equal-width bands
+            size_t bins = K - 1;
+            double total = accumulate(p.begin() + 1, p.end(), 0.0);
+            for (int band = 0; band < bands; ++band) {
+                size_t lo = 1 + bins * band / bands;
+                size_t hi = 1 + bins * (band + 1) / bands;
+                double v = total > 0.0 ? accumulate(p.begin() + lo, p.begin() + hi, 0.0) / total : NAN;
+                for (size_t i = win_end - 1; i < fill_end; ++i) out.band_power[band][i] = v;
+            }
+        }
+    }
+
+    return out;
+}
+
+} // namespace sp
@@ -0,0 +1,27 @@
+// autocorrelation and power spectrum features computed with the FFT
+
+#pragma once
+#include <vector>
+
+namespace sp {
+
+// same result as autocovariance() but O(n log n), worth it for long lag ranges
+std::vector<double> autocovariance_fft(const std::vector<double>& x, int max_lag);
+
+// |X_k|^2 / n of the demeaned signal for k = 0..n/2
+std::vector<double> periodogram(const std::vector<double>& x);
+
+// rolling autocorrelation and relative band power, one column per lag / band.
+// windows end every `hop` points and each block of `hop` new points is folded
+// into running lag sums and a running window spectrum, so only the new block is
+// transformed per step.
+// column values at i come from the latest window ending at or before i (NaN before the first)
+struct SpectralColumns {
+    std::vector<std::vector<double>> acf;
+    std::vector<std::vector<double>> band_power;
+};
+
+SpectralColumns rolling_spectral(const std::vector<double>& x, int window, int hop,
+                                 const std::vector<int>& lags, int bands);
+
+} // namespace sp
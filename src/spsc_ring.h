@@ -0,0 +1,100 @@
+// bounded single-producer / single-consumer ring of trivially copyable records, lock free.
+// each side keeps its index and a cached copy of the other side's on its own cache line,
+// so a batch push or pop touches the shared indices once instead of once per record
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace sp {
+
+template <class T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "ring records are copied with memcpy");
+
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_.reset(new T[cap]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // producer only: copies up to n records, returns how many fit
+    size_t push(const T* items, size_t n) {
+        size_t tail = producer_.tail.load(std::memory_order_relaxed);
+        size_t free = capacity() - (tail - producer_.head_cache);
+        if (free < n) {
+            producer_.head_cache = consumer_.head.load(std::memory_order_acquire);
+            free = capacity() - (tail - producer_.head_cache);
+        }
+        n = std::min(n, free);
+        copy_in(tail, items, n);
+        producer_.tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    bool try_push(const T& item) { return push(&item, 1) == 1; }
+
+    // consumer only: moves up to max records into out, returns how many
+    size_t pop(T* out, size_t max) {
+        size_t head = consumer_.head.load(std::memory_order_relaxed);
+        size_t ready = consumer_.tail_cache - head;
+        if (ready < max) {
+            consumer_.tail_cache = producer_.tail.load(std::memory_order_acquire);
+            ready = consumer_.tail_cache - head;
+        }
+        size_t n = std::min(max, ready);
+        copy_out(head, out, n);
+        consumer_.head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    bool try_pop(T& item) { return pop(&item, 1) == 1; }
+
+    // either side; exact only when the other side is idle
+    size_t size() const {
+        return producer_.tail.load(std::memory_order_acquire)
+               - consumer_.head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    struct alignas(64) Producer {
+        std::atomic<size_t> tail{0};
+        size_t head_cache = 0;
+    };
+    struct alignas(64) Consumer {
+        std::atomic<size_t> head{0};
+        size_t tail_cache = 0;
+    };
+
+    // at most two memcpys, split where the range wraps
+    void copy_in(size_t at, const T* items, size_t n) {
+        size_t first = std::min(n, capacity() - (at & mask_));
+        std::memcpy(&slots_[at & mask_], items, first * sizeof(T));
+        std::memcpy(&slots_[0], items + first, (n - first) * sizeof(T));
+    }
+    void copy_out(size_t at, T* out, size_t n) const {
+        size_t first = std::min(n, capacity() - (at & mask_));
+        std::memcpy(out, &slots_[at & mask_], first * sizeof(T));
+        std::memcpy(out + first, &slots_[0], (n - first) * sizeof(T));
+    }
+
+    Producer producer_;
+    Consumer consumer_;
+    alignas(64) size_t mask_ = 0;
+    std::unique_ptr<T[]> slots_;
+};
+
+} // namespace sp
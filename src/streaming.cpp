@@ -0,0 +1,236 @@
+// incremental features follow create_features operation for operation (same sums in the
+// same order), so a streamed row is bit-identical to the batch row for that bar
+
+#include "streaming.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+const size_t kMaxSamples = size_t(1) << 20;
+const size_t kPushBatch = 64;
+}
+
+StreamingFeatures::StreamingFeatures(const FeatureConfig& config) : config_(config) {
+    if (config_.use_spectral) {
+        throw invalid_argument("streaming features do not support spectral columns");
+    }
+    window_ = static_cast<size_t>(max({config_.lag_days, config_.sma_period, 5})) + 1;
+    closes_.assign(window_, 0.0);
+    volumes_.assign(window_, 0.0);
+}
+
+bool StreamingFeatures::push(double close, double volume, vector<double>& row) {
+    size_t i = count_++;
+    closes_[i % window_] = close;
+    volumes_[i % window_] = volume;
+
+    // indicators, as SMAIndicator / EMAIndicator / RSIIndicator compute them
+    double sma = NAN, ema = NAN, rsi = NAN;
+    size_t sma_period = static_cast<size_t>(max(config_.sma_period, 0));
+    if (sma_period > 0) {
+        sma_sum_ += close;
+        if (i >= sma_period) sma_sum_ -= close_at(i - sma_period);
+        if (i + 1 >= sma_period) sma = sma_sum_ / config_.sma_period;
+    }
+    if (config_.ema_period > 0) {
+        double alpha = 2.0 / (config_.ema_period + 1);
+        ema_ = i == 0 ? close : alpha * close + (1 - alpha) * ema_;
+        ema = ema_;
+    }
+    int period = config_.rsi_period;
+    if (period > 0 && i >= 1) {
+        double diff = close - close_at(i - 1);
+        double gain = max(0.0, diff), loss = max(0.0, -diff);
+        size_t p = static_cast<size_t>(period);
+        if (i <= p) {
+            avg_gain_ += gain;
+            avg_loss_ += loss;
+            if (i == p) {
+                avg_gain_ /= period;
+                avg_loss_ /= period;
+            }
+        } else {
+            avg_gain_ = (avg_gain_ * (period - 1) + gain) / period;
+            avg_loss_ = (avg_loss_ * (period - 1) + loss) / period;
+        }
+        if (i >= p) rsi = 100.0 - (100.0 / (1.0 + avg_gain_ / (avg_loss_ == 0 ? 1e-12 : avg_loss_)));
+    }
+
+    if (i < static_cast<size_t>(max(config_.lag_days, 50))) return false;
+    row.clear();
+    if (config_.use_returns) {
+        for (int lag = 1; lag <= config_.lag_days; ++lag) {
+            row.push_back((close - close_at(i - lag)) / close_at(i - lag));
+        }
+    }
+    if (config_.use_lagged_prices) {
+        for (int lag = 1; lag <= config_.lag_days; ++lag) {
+            row.push_back(close_at(i - lag) / close);
+        }
+    }
+    if (config_.use_sma && !isnan(sma)) row.push_back(sma / close);
+    if (config_.use_ema && !isnan(ema)) row.push_back(ema / close);
+    if (config_.use_rsi && !isnan(rsi)) row.push_back(rsi / 100.0);
+    if (config_.use_volume) {
+        double prev = volume_at(i - 1);
+        row.push_back(prev > 0 ? (volume - prev) / prev : 0.0);
+        double avg_vol = 0.0;
+        for (int lag = 1; lag <= 5; ++lag) avg_vol += volume_at(i - lag);
+        avg_vol /= 5.0;
+        row.push_back(avg_vol > 0 ? volume / avg_vol : 1.0);
+    }
+    double rets[5];
+    for (int lag = 1; lag <= 5; ++lag) {
+        rets[lag - 1] = (close_at(i - lag + 1) - close_at(i - lag)) / close_at(i - lag);
+    }
+    double mean_ret = accumulate(rets, rets + 5, 0.0) / 5;
+    double variance = 0.0;
+    for (double r : rets) variance += (r - mean_ret) * (r - mean_ret);
+    variance /= 5;
+    row.push_back(std::sqrt(variance));
+
+    for (double v : row) {
+        if (!isfinite(v)) return false;
+    }
+    return true;
+}
+
+StreamingEngine::StreamingEngine(const FeatureConfig& features, unsigned threads, size_t ring_capacity)
+    : config_(features) {
+    StreamingFeatures check(config_);  // reject unsupported configs up front
+    for (unsigned t = 0; t < max(1u, threads); ++t) {
+        auto w = make_unique<Worker>();
+        w->ring = make_unique<SpscRing<BarRecord>>(ring_capacity);
+        w->staged.reserve(kPushBatch);
+        workers_.push_back(move(w));
+    }
+}
+
+StreamingEngine::~StreamingEngine() {
+    stop();
+}
+
+int64_t StreamingEngine::now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+StreamingEngine::Symbol& StreamingEngine::symbol(Worker& w, uint32_t id) {
+    auto it = w.symbols.find(id);
+    if (it == w.symbols.end()) {
+        it = w.symbols.emplace(id, Symbol{StreamingFeatures(config_), LinearRegression(), false}).first;
+    }
+    return it->second;
+}
+
+void StreamingEngine::set_model(uint32_t id, const LinearRegression& model) {
+    if (running_) throw logic_error("set_model after start");
+    Symbol& s = symbol(*workers_[id % workers_.size()], id);
+    s.model = model;
+    s.has_model = model.is_trained();
+}
+
+void StreamingEngine::start(Sink on_prediction) {
+    if (running_) throw logic_error("engine already started");
+    sink_ = move(on_prediction);
+    stop_ = false;
+    running_ = true;
+    for (auto& w : workers_) {
+        Worker* worker = w.get();
+        w->thread = thread([this, worker] { run(*worker); });
+    }
+}
+
+void StreamingEngine::push(const BarRecord* bars, size_t n) {
+    int64_t stamp = 0;
+    for (size_t i = 0; i < n; ++i) {
+        Worker& w = *workers_[bars[i].symbol % workers_.size()];
+        w.staged.push_back(bars[i]);
+        if (w.staged.back().stamp_ns == 0) {
+            if (stamp == 0) stamp = now_ns();
+            w.staged.back().stamp_ns = stamp;
+        }
+        if (w.staged.size() == kPushBatch) flush(w);
+    }
+    for (auto& w : workers_) {
+        if (!w->staged.empty()) flush(*w);
+    }
+}
+
+void StreamingEngine::flush(Worker& w) {
+    size_t done = 0;
+    while (done < w.staged.size()) {
+        done += w.ring->push(w.staged.data() + done, w.staged.size() - done);
+        if (done < w.staged.size()) this_thread::yield();
+    }
+    w.staged.clear();
+}
+
+void StreamingEngine::run(Worker& w) {
+    vector<BarRecord> batch(256);
+    vector<double> row;
+    for (;;) {
+        size_t n = w.ring->pop(batch.data(), batch.size());
+        if (n == 0) {
+            // everything pushed before stop_ is visible once stop_ is
+            if (stop_.load(memory_order_acquire) && w.ring->empty()) return;
+            this_thread::yield();
+            continue;
+        }
+        int64_t now = now_ns();
+        for (size_t k = 0; k < n; ++k) {
+            const BarRecord& bar = batch[k];
+            uint32_t latency = static_cast<uint32_t>(min<int64_t>(max<int64_t>(now - bar.stamp_ns, 0), UINT32_MAX));
+            if (w.latency_ns.size() < kMaxSamples) {
+                w.latency_ns.push_back(latency);
+            } else {
+                w.latency_ns[w.bars % kMaxSamples] = latency;
+            }
+            ++w.bars;
+            Symbol& s = symbol(w, bar.symbol);
+            if (!s.features.push(bar.close, bar.volume, row) || !s.has_model) continue;
+            if (row.size() + 1 != s.model.coefficients().size()) continue;
+            double prediction = s.model.predict(row);
+            ++w.predictions;
+            if (sink_) sink_(bar, prediction);
+        }
+    }
+}
+
+void StreamingEngine::stop() {
+    if (!running_) return;
+    for (auto& w : workers_) {
+        if (!w->staged.empty()) flush(*w);
+    }
+    stop_.store(true, memory_order_release);
+    for (auto& w : workers_) w->thread.join();
+    running_ = false;
+}
+
+StreamStats StreamingEngine::stats() const {
+    StreamStats s;
+    vector<uint32_t> all;
+    for (const auto& w : workers_) {
+        s.bars += w->bars;
+        s.predictions += w->predictions;
+        all.insert(all.end(), w->latency_ns.begin(), w->latency_ns.end());
+    }
+    if (all.empty()) return s;
+    auto at = [&](double q) {
+        size_t k = min(all.size() - 1, static_cast<size_t>(q * all.size()));
+        nth_element(all.begin(), all.begin() + k, all.end());
+        return all[k] / 1000.0;
+    };
+    s.p50_latency_us = at(0.50);
+    s.p99_latency_us = at(0.99);
+    s.max_latency_us = *max_element(all.begin(), all.end()) / 1000.0;
+    return s;
+}
+
+} // namespace sp
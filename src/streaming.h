@@ -0,0 +1,113 @@
+// live path: bars arrive one at a time from a feed thread, are handed to compute threads
+// through spsc rings, and each updates its symbol's features and prediction in place
+
+#pragma once
+#include "feature_engineer.h"
+#include "linear_regression.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sp {
+
+// fixed size record passed through the rings
+struct BarRecord {
+    uint32_t symbol = 0;   // caller's symbol id
+    int32_t date = 0;      // yyyymmdd
+    int64_t stamp_ns = 0;  // steady clock when handed over, for the handoff latency
+    double open = 0.0, high = 0.0, low = 0.0, close = 0.0, volume = 0.0;
+};
+
+// the row create_features builds for the newest bar, kept up to date one bar at a time:
+// running sums for SMA/RSI, the EMA recurrence, and a short window of closes and volumes.
+// values match the batch rows exactly. spectral and external columns are batch only
+class StreamingFeatures {
+public:
+    explicit StreamingFeatures(const FeatureConfig& config);  // throws invalid_argument for spectral
+
+    // adds a bar; true and row filled when the bar has a complete row (create_features
+    // starts at bar max(lag_days, 50) and skips rows with NaN)
+    bool push(double close, double volume, std::vector<double>& row);
+    size_t bars() const { return count_; }
+
+private:
+    FeatureConfig config_;
+    size_t count_ = 0;
+    size_t window_;
+    std::vector<double> closes_;   // last window_ bars, circular
+    std::vector<double> volumes_;
+    double sma_sum_ = 0.0;
+    double ema_ = 0.0;
+    double avg_gain_ = 0.0, avg_loss_ = 0.0;
+
+    double close_at(size_t i) const { return closes_[i % window_]; }
+    double volume_at(size_t i) const { return volumes_[i % window_]; }
+};
+
+struct StreamStats {
+    uint64_t bars = 0;
+    uint64_t predictions = 0;
+    double p50_latency_us = 0.0;  // push to pop, over a sample of the records
+    double p99_latency_us = 0.0;
+    double max_latency_us = 0.0;
+};
+
+class StreamingEngine {
+public:
+    // runs on a compute thread for every bar that produced a prediction
+    using Sink = std::function<void(const BarRecord& bar, double prediction)>;
+
+    // symbol s is always handled by compute thread s % threads, so its state needs no lock
+    StreamingEngine(const FeatureConfig& features, unsigned threads = 1, size_t ring_capacity = 4096);
+    ~StreamingEngine();
+
+    StreamingEngine(const StreamingEngine&) = delete;
+    StreamingEngine& operator=(const StreamingEngine&) = delete;
+
+    // before start(); symbols without a model only keep their features current
+    void set_model(uint32_t symbol, const LinearRegression& model);
+    void start(Sink on_prediction);
+
+    // feed thread only. records with stamp_ns == 0 are stamped now; blocks (yielding)
+    // while a compute thread's ring is full
+    void push(const BarRecord* bars, size_t n);
+    void push(const BarRecord& bar) { push(&bar, 1); }
+
+    // drains the rings and joins the compute threads
+    void stop();
+    StreamStats stats() const;  // complete after stop()
+
+    static int64_t now_ns();
+
+private:
+    struct Symbol {
+        StreamingFeatures features;
+        LinearRegression model;
+        bool has_model = false;
+    };
+    struct Worker {
+        std::unique_ptr<SpscRing<BarRecord>> ring;
+        std::vector<BarRecord> staged;  // feed side, flushed per push() call
+        std::unordered_map<uint32_t, Symbol> symbols;
+        std::vector<uint32_t> latency_ns;
+        uint64_t bars = 0, predictions = 0;
+        std::thread thread;
+    };
+
+    FeatureConfig config_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stop_{false};
+    bool running_ = false;
+    Sink sink_;
+
+    Symbol& symbol(Worker& w, uint32_t id);
+    void flush(Worker& w);
+    void run(Worker& w);
+};
+
+} // namespace sp
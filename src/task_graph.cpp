@@ -0,0 +1,162 @@
+// task graph executor; remaining counts tasks not yet finished, queued the tasks sitting
+// in some deque, and idle workers sleep until either changes
+
+#include "task_graph.h"
+#include "parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+struct WorkQueue {
+    mutex m;
+    deque<size_t> tasks;
+};
+
+constexpr size_t kNone = ~size_t(0);
+
+} // namespace
+
+TaskGraph::Task TaskGraph::add(function<void()> fn, const vector<Task>& after) {
+    Task id = nodes_.size();
+    for (Task a : after) {
+        if (a >= id) throw out_of_range("task graph dependency on an unknown task");
+    }
+    nodes_.push_back({move(fn), {}, static_cast<uint32_t>(after.size())});
+    for (Task a : after) nodes_[a].successors.push_back(id);
+    return id;
+}
+
+TaskGraph::Task TaskGraph::add_range(size_t n, function<void(size_t)> fn, const vector<Task>& after) {
+    auto shared = make_shared<function<void(size_t)>>(move(fn));
+    vector<Task> parts;
+    parts.reserve(n);
+    for (size_t i = 0; i < n; ++i) parts.push_back(add([shared, i] { (*shared)(i); }, after));
+    return n ? add(nullptr, parts) : add(nullptr, after);
+}
+
+void TaskGraph::run(unsigned threads) {
+    size_t n = nodes_.size();
+    if (n == 0) return;
+    if (threads == 0) threads = default_threads();
+    threads = static_cast<unsigned>(min<size_t>(threads, n));
+    unique_ptr<atomic<uint32_t>[]> pending(new atomic<uint32_t>[n]);
+    for (size_t i = 0; i < n; ++i) pending[i].store(nodes_[i].deps, memory_order_relaxed);
+
+    if (threads <= 1) {
+        vector<Task> ready;
+        ready.reserve(n);
+        for (Task t = 0; t < n; ++t) {
+            if (nodes_[t].deps == 0) ready.push_back(t);
+        }
+        for (size_t head = 0; head < ready.size(); ++head) {
+            const Node& node = nodes_[ready[head]];
+            if (node.fn) node.fn();
+            for (Task s : node.successors) {
+                if (pending[s].fetch_sub(1, memory_order_relaxed) == 1) ready.push_back(s);
+            }
+        }
+        return;
+    }
+
+    unique_ptr<WorkQueue[]> queues(new WorkQueue[threads]);
+    atomic<size_t> remaining{n};
+    atomic<int64_t> queued{0};
+    atomic<unsigned> sleepers{0};
+    atomic<bool> failed{false};
+    exception_ptr error;
+    mutex error_m, sleep_m;
+    condition_variable wake;
+
+    unsigned next_queue = 0;
+    for (Task t = 0; t < n; ++t) {
+        if (nodes_[t].deps != 0) continue;
+        queues[next_queue].tasks.push_back(t);
+        next_queue = (next_queue + 1) % threads;
+        ++queued;
+    }
+
+    auto push = [&](unsigned w, Task t) {
+        {
+            lock_guard<mutex> lock(queues[w].m);
+            queues[w].tasks.push_back(t);
+        }
+        ++queued;
+        // pairs with the sleeper count taken under sleep_m before waiting on queued
+        if (sleepers.load() > 0) {
+            lock_guard<mutex> lock(sleep_m);
+            wake.notify_one();
+        }
+    };
+    auto pop = [&](unsigned w, Task& t) {
+        for (unsigned k = 0; k < threads; ++k) {
+            WorkQueue& q = queues[(w + k) % threads];
+            lock_guard<mutex> lock(q.m);
+            if (q.tasks.empty()) continue;
+            if (k == 0) {
+                t = q.tasks.back();
+                q.tasks.pop_back();
+            } else {
+                t = q.tasks.front();
+                q.tasks.pop_front();
+            }
+            --queued;
+            return true;
+        }
+        return false;
+    };
+    auto worker = [&](unsigned w) {
+        Task t;
+        for (;;) {
+            if (!pop(w, t)) {
+                unique_lock<mutex> lock(sleep_m);
+                ++sleepers;
+                wake.wait(lock, [&] { return queued.load() > 0 || remaining.load() == 0; });
+                --sleepers;
+                if (remaining.load() == 0) return;
+                continue;
+            }
+            while (t != kNone) {
+                const Node& node = nodes_[t];
+                if (node.fn && !failed.load(memory_order_relaxed)) {
+                    try {
+                        node.fn();
+                    } catch (...) {
+                        lock_guard<mutex> lock(error_m);
+                        if (!error) error = current_exception();
+                        failed = true;
+                    }
+                }
+                Task next = kNone;
+                for (Task s : node.successors) {
+                    if (pending[s].fetch_sub(1, memory_order_acq_rel) != 1) continue;
+                    if (next == kNone) next = s;
+                    else push(w, s);
+                }
+                if (remaining.fetch_sub(1) == 1) {
+                    lock_guard<mutex> lock(sleep_m);
+                    wake.notify_all();
+                }
+                t = next;
+            }
+        }
+    };
+
+    vector<thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned w = 1; w < threads; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto& th : pool) th.join();
+    if (error) rethrow_exception(error);
+}
+
+} // namespace sp
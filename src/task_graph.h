@@ -0,0 +1,49 @@
+// dependency graph of coarse tasks on a work-stealing pool, so the independent stages of
+// one symbol's pipeline (indicators, row blocks, gram blocks, metrics) share the cores
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace sp {
+
+// a task is added together with the tasks it waits for, so the graph is acyclic by
+// construction. run() deals the tasks without dependencies round-robin onto one deque
+// per worker; a worker pops its own deque from the back (newest first, still warm in
+// its cache) and, once empty, steals from the front of the others. a finishing task
+// runs its first ready successor directly, continuation style, and pushes the rest
+// onto its own deque. tasks are expected to be thousands of rows of work each, so the
+// deques are plain locked ones
+class TaskGraph {
+public:
+    using Task = size_t;
+
+    // fn runs once every task in after has finished; an empty fn is a join point.
+    // throws out_of_range for a task not in the graph
+    Task add(std::function<void()> fn, const std::vector<Task>& after = {});
+    // continuation of a single task
+    Task then(Task after, std::function<void()> fn) { return add(std::move(fn), {after}); }
+    // fn(0) .. fn(n - 1) as n tasks after the given ones; returns a join that finishes
+    // once all n have
+    Task add_range(size_t n, std::function<void(size_t)> fn, const std::vector<Task>& after = {});
+
+    size_t size() const { return nodes_.size(); }
+
+    // runs every task once on threads workers, the caller being one of them (0 = one per
+    // core, 1 = inline in dependency order). the first exception a task throws is
+    // rethrown after the running tasks finish; tasks not started by then are skipped.
+    // the graph is left as it was and can be run again
+    void run(unsigned threads = 0);
+
+private:
+    struct Node {
+        std::function<void()> fn;
+        std::vector<Task> successors;
+        uint32_t deps = 0;
+    };
+    std::vector<Node> nodes_;
+};
+
+} // namespace sp
@@ -0,0 +1,432 @@
+// the aggregator keeps one small state per (symbol, spec) in a flat array indexed by
+// symbol id, so a tick costs a few compares and adds per spec and no lookups; the
+// sink only runs when a bar closes
+
+#include "tick_aggregator.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace sp {
+using namespace std;
+
+namespace {
+
+const char kTickMagic[8] = {'S', 'P', 'T', 'I', 'C', 'K', '1', '\0'};
+const int64_t kSecond = 1000000000;
+
+int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// days since 1970-01-01 for a proleptic gregorian date, and back (Howard Hinnant)
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civil_from_days(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+[[noreturn]] void bad_field(const char* b, const char* e, const string& what) {
+    throw runtime_error("invalid " + what + " in tick CSV: '" + string(b, e) + "'");
+}
+
+// digits at p (advanced past them), exactly n of them
+unsigned fixed_digits(const char*& p, const char* e, int n) {
+    unsigned v = 0;
+    for (int i = 0; i < n; ++i, ++p) {
+        if (p >= e || *p < '0' || *p > '9') throw invalid_argument("digit");
+        v = v * 10 + static_cast<unsigned>(*p - '0');
+    }
+    return v;
+}
+
+int64_t parse_timestamp(const char* b, const char* e) {
+    if (b == e) bad_field(b, e, "timestamp");
+    if (memchr(b, '-', static_cast<size_t>(e - b)) == nullptr || *b == '-') {
+        int64_t v = 0;
+        auto res = from_chars(b, e, v);
+        if (res.ec != errc() || res.ptr != e) bad_field(b, e, "timestamp");
+        return v;
+    }
+    try {
+        const char* p = b;
+        int64_t y = fixed_digits(p, e, 4);
+        if (p >= e || *p++ != '-') throw invalid_argument("-");
+        unsigned mo = fixed_digits(p, e, 2);
+        if (p >= e || *p++ != '-') throw invalid_argument("-");
+        unsigned d = fixed_digits(p, e, 2);
+        int64_t ns = 0;
+        if (p < e) {
+            if (*p != ' ' && *p != 'T') throw invalid_argument("sep");
+            ++p;
+            unsigned h = fixed_digits(p, e, 2);
+            if (p >= e || *p++ != ':') throw invalid_argument(":");
+            unsigned mi = fixed_digits(p, e, 2);
+            if (p >= e || *p++ != ':') throw invalid_argument(":");
+            unsigned s = fixed_digits(p, e, 2);
+            ns = (int64_t(h) * 3600 + mi * 60 + s) * kSecond;
+            if (p < e && *p == '.') {
+                ++p;
+                int64_t scale = kSecond / 10;
+                for (; p < e && *p >= '0' && *p <= '9'; ++p, scale /= 10) ns += (*p - '0') * scale;
+            }
+            if (p < e && *p == 'Z') ++p;
+        }
+        if (p != e || mo < 1 || mo > 12 || d < 1 || d > 31) throw invalid_argument("range");
+        return days_from_civil(y, mo, d) * 86400 * kSecond + ns;
+    } catch (const invalid_argument&) {
+        bad_field(b, e, "timestamp");
+    }
+}
+
+double parse_number(const char* b, const char* e) {
+    double v = 0.0;
+    auto res = from_chars(b, e, v);
+    if (res.ec != errc() || res.ptr == b) bad_field(b, e, "number");
+    return v;
+}
+
+string lower_trim(const char* b, const char* e) {
+    while (b < e && (*b == ' ' || *b == '"' || *b == '\r')) ++b;
+    while (e > b && (e[-1] == ' ' || e[-1] == '"' || e[-1] == '\r')) --e;
+    string s(b, e);
+    for (char& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+void read_csv_ticks(const string& path, SymbolTable& symbols,
+                    const function<void(const Tick*, size_t)>& on_batch, size_t batch) {
+    MappedFile file(path);
+    const char* p = file.data();
+    const char* end = p + file.size();
+    const char* eol = static_cast<const char*>(memchr(p, '\n', file.size()));
+    if (!eol) eol = end;
+
+    // header: which field holds what
+    int col_symbol = -1, col_time = -1, col_price = -1, col_size = -1, columns = 0;
+    for (const char* f = p; f <= eol && f < end;) {
+        const char* comma = find(f, eol, ',');
+        string name = lower_trim(f, comma);
+        if (name == "symbol" || name == "ticker") col_symbol = columns;
+        if (name == "timestamp" || name == "time") col_time = columns;
+        if (name == "price") col_price = columns;
+        if (name == "size" || name == "qty" || name == "quantity" || name == "volume") col_size = columns;
+        ++columns;
+        f = comma + 1;
+    }
+    if (col_time < 0 || col_price < 0 || col_size < 0) {
+        throw runtime_error("tick CSV needs timestamp, price and size columns: " + path);
+    }
+    uint32_t file_symbol = col_symbol < 0 ? symbols.id(filesystem::path(path).stem().string()) : 0;
+    p = eol < end ? eol + 1 : end;
+
+    // ticks usually come in runs of one symbol: remember the last name and its id
+    string last_name;
+    bool have_last = false;
+    uint32_t last_id = file_symbol;
+    vector<Tick> out;
+    out.reserve(batch);
+    const char* fields[64][2];
+    int used = max({col_symbol, col_time, col_price, col_size}) + 1;
+    if (used > 64) throw runtime_error("too many columns in tick CSV: " + path);
+    while (p < end) {
+        const char* line_end = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!line_end) line_end = end;
+        const char* le = line_end;
+        if (le > p && le[-1] == '\r') --le;
+        if (le > p) {
+            const char* f = p;
+            int n = 0;
+            while (n < used) {
+                const char* comma = static_cast<const char*>(memchr(f, ',', static_cast<size_t>(le - f)));
+                fields[n][0] = f;
+                fields[n][1] = comma ? comma : le;
+                ++n;
+                if (!comma) break;
+                f = comma + 1;
+            }
+            if (n < used) throw runtime_error("short line in tick CSV: " + string(p, le));
+            Tick t;
+            t.time_ns = parse_timestamp(fields[col_time][0], fields[col_time][1]);
+            t.price = parse_number(fields[col_price][0], fields[col_price][1]);
+            t.size = parse_number(fields[col_size][0], fields[col_size][1]);
+            if (col_symbol >= 0) {
+                const char* sb = fields[col_symbol][0];
+                size_t len = static_cast<size_t>(fields[col_symbol][1] - sb);
+                if (!have_last || len != last_name.size() || memcmp(sb, last_name.data(), len) != 0) {
+                    have_last = true;
+                    last_name.assign(sb, len);
+                    last_id = symbols.id(last_name);
+                }
+            }
+            t.symbol = last_id;
+            out.push_back(t);
+            if (out.size() == batch) {
+                on_batch(out.data(), out.size());
+                out.clear();
+            }
+        }
+        p = line_end + 1;
+    }
+    if (!out.empty()) on_batch(out.data(), out.size());
+}
+
+size_t align8(size_t v) { return (v + 7) & ~size_t(7); }
+
+void read_binary_ticks(const string& path, SymbolTable& symbols,
+                       const function<void(const Tick*, size_t)>& on_batch, size_t batch) {
+    MappedFile file(path);
+    const char* data = file.data();
+    size_t size = file.size();
+    uint64_t count = 0;
+    uint32_t n_symbols = 0, names_bytes = 0;
+    if (size < 24 || memcmp(data, kTickMagic, 8) != 0) throw runtime_error("not a tick file: " + path);
+    memcpy(&count, data + 8, 8);
+    memcpy(&n_symbols, data + 16, 4);
+    memcpy(&names_bytes, data + 20, 4);
+    size_t ticks_at = align8(24 + size_t(names_bytes));
+    if (ticks_at > size || (size - ticks_at) / sizeof(Tick) < count) {
+        throw runtime_error("truncated tick file: " + path);
+    }
+    // file ids -> ids in the caller's table; identical in the common case of a fresh table
+    vector<uint32_t> remap(n_symbols);
+    bool identity = true;
+    const char* p = data + 24;
+    const char* names_end = p + names_bytes;
+    for (uint32_t i = 0; i < n_symbols; ++i) {
+        uint16_t len = 0;
+        if (p + 2 > names_end) throw runtime_error("truncated tick file: " + path);
+        memcpy(&len, p, 2);
+        p += 2;
+        if (p + len > names_end) throw runtime_error("truncated tick file: " + path);
+        remap[i] = symbols.id(string(p, len));
+        identity = identity && remap[i] == i;
+        p += len;
+    }
+    const Tick* ticks = reinterpret_cast<const Tick*>(data + ticks_at);
+    vector<Tick> copy;
+    for (uint64_t at = 0; at < count; at += batch) {
+        size_t n = static_cast<size_t>(min<uint64_t>(batch, count - at));
+        if (identity) {
+            for (size_t i = 0; i < n; ++i) {
+                if (ticks[at + i].symbol >= n_symbols) throw runtime_error("bad symbol id in " + path);
+            }
+            on_batch(ticks + at, n);
+            continue;
+        }
+        copy.assign(ticks + at, ticks + at + n);
+        for (auto& t : copy) {
+            if (t.symbol >= n_symbols) throw runtime_error("bad symbol id in " + path);
+            t.symbol = remap[t.symbol];
+        }
+        on_batch(copy.data(), n);
+    }
+}
+
+} // namespace
+
+string BarSpec::label() const {
+    char buf[64];
+    switch (kind) {
+    case BarKind::Time: snprintf(buf, sizeof(buf), "time%gs", threshold); break;
+    case BarKind::Volume: snprintf(buf, sizeof(buf), "volume%g", threshold); break;
+    case BarKind::Dollar: snprintf(buf, sizeof(buf), "dollar%g", threshold); break;
+    }
+    return buf;
+}
+
+BarSpec BarSpec::parse(const string& label) {
+    BarSpec spec;
+    size_t digits = label.find_first_of("0123456789.");
+    string kind = label.substr(0, digits);
+    if (kind == "time") {
+        spec.kind = BarKind::Time;
+    } else if (kind == "volume") {
+        spec.kind = BarKind::Volume;
+    } else if (kind == "dollar") {
+        spec.kind = BarKind::Dollar;
+    } else {
+        throw invalid_argument("bar spec must be time<n>[s|m|h|d], volume<n> or dollar<n>: " + label);
+    }
+    size_t used = 0;
+    try {
+        spec.threshold = stod(label.substr(digits), &used);
+    } catch (const exception&) {
+        throw invalid_argument("bar spec without a size: " + label);
+    }
+    string unit = label.substr(digits + used);
+    if (spec.kind == BarKind::Time && !unit.empty()) {
+        if (unit == "m") spec.threshold *= 60;
+        else if (unit == "h") spec.threshold *= 3600;
+        else if (unit == "d") spec.threshold *= 86400;
+        else if (unit != "s") throw invalid_argument("unknown time unit in bar spec: " + label);
+    } else if (!unit.empty()) {
+        throw invalid_argument("unexpected suffix in bar spec: " + label);
+    }
+    if (!(spec.threshold > 0)) throw invalid_argument("bar spec size must be positive: " + label);
+    if (spec.kind == BarKind::Time && spec.threshold * kSecond < 1) {
+        throw invalid_argument("time bars shorter than a nanosecond: " + label);
+    }
+    return spec;
+}
+
+TickAggregator::TickAggregator(vector<BarSpec> specs, Sink sink)
+    : specs_(move(specs)), sink_(move(sink)) {
+    if (specs_.empty()) throw invalid_argument("tick aggregator needs at least one bar spec");
+    for (const auto& s : specs_) {
+        interval_ns_.push_back(s.kind == BarKind::Time ? static_cast<int64_t>(llround(s.threshold * kSecond)) : 0);
+    }
+}
+
+void TickAggregator::add(const Tick* ticks, size_t n) {
+    const size_t k = specs_.size();
+    for (size_t i = 0; i < n; ++i) {
+        const Tick& t = ticks[i];
+        size_t base = size_t(t.symbol) * k;
+        if (base + k > states_.size()) states_.resize(base + k);
+        double notional = t.price * t.size;
+        for (size_t j = 0; j < k; ++j) {
+            State& s = states_[base + j];
+            const BarKind kind = specs_[j].kind;
+            if (kind == BarKind::Time) {
+                int64_t bucket = floor_div(t.time_ns, interval_ns_[j]);
+                if (s.ticks && bucket > s.bucket) emit(t.symbol, static_cast<uint32_t>(j), s);
+                if (!s.ticks) {
+                    s.bucket = bucket;
+                    s.start_ns = bucket * interval_ns_[j];
+                }
+            } else if (!s.ticks) {
+                s.start_ns = t.time_ns;
+            }
+            if (s.ticks == 0) {
+                s.open = s.high = s.low = t.price;
+            } else {
+                s.high = max(s.high, t.price);
+                s.low = min(s.low, t.price);
+            }
+            s.close = t.price;
+            s.volume += t.size;
+            s.notional += notional;
+            s.end_ns = t.time_ns;
+            ++s.ticks;
+            if ((kind == BarKind::Volume && s.volume >= specs_[j].threshold)
+                || (kind == BarKind::Dollar && s.notional >= specs_[j].threshold)) {
+                emit(t.symbol, static_cast<uint32_t>(j), s);
+            }
+        }
+    }
+    ticks_ += n;
+}
+
+void TickAggregator::emit(uint32_t symbol, uint32_t spec, State& s) {
+    AggregatedBar bar;
+    bar.symbol = symbol;
+    bar.spec = spec;
+    bar.start_ns = s.start_ns;
+    bar.end_ns = specs_[spec].kind == BarKind::Time ? s.start_ns + interval_ns_[spec] : s.end_ns;
+    bar.open = s.open;
+    bar.high = s.high;
+    bar.low = s.low;
+    bar.close = s.close;
+    bar.volume = s.volume;
+    bar.notional = s.notional;
+    bar.ticks = s.ticks;
+    s = State{};
+    if (sink_) sink_(bar);
+}
+
+void TickAggregator::flush() {
+    const size_t k = specs_.size();
+    for (size_t i = 0; i < states_.size(); ++i) {
+        if (states_[i].ticks) emit(static_cast<uint32_t>(i / k), static_cast<uint32_t>(i % k), states_[i]);
+    }
+}
+
+uint32_t SymbolTable::id(const string& name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(name, id);
+    return id;
+}
+
+void read_ticks(const string& path, SymbolTable& symbols,
+                const function<void(const Tick*, size_t)>& on_batch, size_t batch) {
+    batch = max<size_t>(1, batch);
+    string ext = filesystem::path(path).extension().string();
+    if (ext == ".spt") {
+        read_binary_ticks(path, symbols, on_batch, batch);
+    } else {
+        read_csv_ticks(path, symbols, on_batch, batch);
+    }
+}
+
+void write_ticks(const string& path, const vector<Tick>& ticks, const SymbolTable& symbols) {
+    ofstream out(path, ios::binary);
+    if (!out) throw runtime_error("failed to open the file: " + path);
+    string names;
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        const string& name = symbols.name(static_cast<uint32_t>(i));
+        if (name.size() > 0xffff) throw runtime_error("symbol name too long: " + name.substr(0, 32));
+        uint16_t len = static_cast<uint16_t>(name.size());
+        names.append(reinterpret_cast<const char*>(&len), 2);
+        names += name;
+    }
+    uint64_t count = ticks.size();
+    uint32_t n_symbols = static_cast<uint32_t>(symbols.size());
+    uint32_t names_bytes = static_cast<uint32_t>(names.size());
+    out.write(kTickMagic, 8);
+    out.write(reinterpret_cast<const char*>(&count), 8);
+    out.write(reinterpret_cast<const char*>(&n_symbols), 4);
+    out.write(reinterpret_cast<const char*>(&names_bytes), 4);
+    out << names;
+    size_t pad = align8(24 + names.size()) - (24 + names.size());
+    out.write("\0\0\0\0\0\0\0", static_cast<streamsize>(pad));
+    out.write(reinterpret_cast<const char*>(ticks.data()), static_cast<streamsize>(ticks.size() * sizeof(Tick)));
+    if (!out) throw runtime_error("failed to write the file: " + path);
+}
+
+string format_time_ns(int64_t time_ns) {
+    int64_t days = floor_div(time_ns, 86400 * kSecond);
+    int64_t rem = time_ns - days * 86400 * kSecond;
+    int64_t y;
+    unsigned m, d;
+    civil_from_days(days, y, m, d);
+    int64_t secs = rem / kSecond;
+    int64_t ms = (rem % kSecond) / 1000000;
+    char buf[48];
+    if (ms) {
+        snprintf(buf, sizeof(buf), "%04lld-%02u-%02u %02lld:%02lld:%02lld.%03lld", static_cast<long long>(y), m, d,
+                 static_cast<long long>(secs / 3600), static_cast<long long>(secs / 60 % 60),
+                 static_cast<long long>(secs % 60), static_cast<long long>(ms));
+    } else {
+        snprintf(buf, sizeof(buf), "%04lld-%02u-%02u %02lld:%02lld:%02lld", static_cast<long long>(y), m, d,
+                 static_cast<long long>(secs / 3600), static_cast<long long>(secs / 60 % 60),
+                 static_cast<long long>(secs % 60));
+    }
+    return buf;
+}
+
+} // namespace sp
@@ -0,0 +1,103 @@
+// builds OHLCV bars from trade prints: time, volume and dollar bars for many symbols in
+// one pass over the ticks, plus streaming readers for tick csv and binary .spt files
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sp {
+
+// one trade; also the on-disk record of .spt files
+struct Tick {
+    int64_t time_ns = 0;  // unix epoch
+    double price = 0.0;
+    double size = 0.0;
+    uint32_t symbol = 0;  // id from a SymbolTable
+    uint32_t reserved = 0;
+};
+
+enum class BarKind : uint8_t { Time, Volume, Dollar };
+
+struct BarSpec {
+    BarKind kind = BarKind::Time;
+    double threshold = 60.0;  // seconds per bar, shares per bar, or notional per bar
+
+    // "time60s", "volume5000", "dollar1000000"; parse accepts the same form
+    std::string label() const;
+    static BarSpec parse(const std::string& label);  // throws invalid_argument
+};
+
+struct AggregatedBar {
+    uint32_t symbol = 0;
+    uint32_t spec = 0;      // index into the aggregator's specs
+    int64_t start_ns = 0;   // time bars: bucket start; others: first tick
+    int64_t end_ns = 0;     // time bars: bucket end; others: last tick
+    double open = 0.0, high = 0.0, low = 0.0, close = 0.0;
+    double volume = 0.0;
+    double notional = 0.0;  // sum of price * size
+    uint32_t ticks = 0;
+};
+
+// per symbol, ticks must arrive in time order. a volume or dollar bar closes on the tick
+// that reaches its threshold (ticks are not split); a time bar closes when a tick lands
+// in a later bucket, so empty buckets produce no bar
+class TickAggregator {
+public:
+    using Sink = std::function<void(const AggregatedBar&)>;
+
+    TickAggregator(std::vector<BarSpec> specs, Sink sink);
+
+    void add(const Tick* ticks, size_t n);
+    void flush();  // emits every bar still open, e.g. at the end of the input
+
+    const std::vector<BarSpec>& specs() const { return specs_; }
+    uint64_t ticks() const { return ticks_; }
+
+private:
+    struct State {
+        int64_t bucket = 0;
+        int64_t start_ns = 0, end_ns = 0;
+        double open = 0.0, high = 0.0, low = 0.0, close = 0.0;
+        double volume = 0.0, notional = 0.0;
+        uint32_t ticks = 0;
+    };
+
+    std::vector<BarSpec> specs_;
+    std::vector<int64_t> interval_ns_;  // time specs
+    Sink sink_;
+    std::vector<State> states_;         // symbol * specs + spec
+    uint64_t ticks_ = 0;
+
+    void emit(uint32_t symbol, uint32_t spec, State& s);
+};
+
+// symbol names <-> dense ids, in order of first appearance
+class SymbolTable {
+public:
+    uint32_t id(const std::string& name);
+    const std::string& name(uint32_t id) const { return names_.at(id); }
+    size_t size() const { return names_.size(); }
+
+private:
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, uint32_t> ids_;
+};
+
+// streams ticks in batches; on_batch's pointer is only valid during the call.
+// .spt files are mapped and handed over in place. csv needs a header naming
+// timestamp (or time), price and size (or qty/quantity/volume) columns, and optionally
+// symbol; without it the file stem is the symbol. timestamps are integer epoch
+// nanoseconds or "YYYY-MM-DD HH:MM:SS[.fff]" (or with a T), UTC. throws runtime_error
+void read_ticks(const std::string& path, SymbolTable& symbols,
+                const std::function<void(const Tick*, size_t)>& on_batch, size_t batch = 65536);
+
+// binary tick file: symbol names, then the Tick records as they are in memory
+void write_ticks(const std::string& path, const std::vector<Tick>& ticks, const SymbolTable& symbols);
+
+// "YYYY-MM-DD HH:MM:SS.fff" for a unix epoch time, UTC; milliseconds only when nonzero
+std::string format_time_ns(int64_t time_ns);
+
+} // namespace sp
@@ -1,9 +1,54 @@
 #include "../src/linear_regression.h"
 #include "../src/feature_engineer.h"
 #include "../src/csv_loader.h"
+#include "../src/autoregressive.h"
+#include "../src/fft.h"
+#include "../src/spectral.h"
+#include "../src/correlation_engine.h"
+#include "../src/factor_model.h"
+#include "../src/hash.h"
+#include "../src/feature_cache.h"
+#include "../src/panel.h"
+#include "../src/bar_cache.h"
+#include "../src/compact_bars.h"
+#include "../src/bar_archive.h"
+#include "../src/async_loader.h"
+#include "../src/batch.h"
+#include "../src/file_reader.h"
+#include "../src/sp_api.h"
+#include "../src/refresh.h"
+#include "../src/huge_pages.h"
+#include "../src/numa_topology.h"
+#include "../src/streaming.h"
+#include "../src/feed.h"
+#include "../src/prediction_table.h"
+#include "../src/tick_aggregator.h"
+#include "../src/bar_normalize.h"
+#include "../src/adjustments.h"
+#include "../src/range_index.h"
+#include "../src/task_graph.h"
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 using namespace sp;
 
@@ -46,8 +91,8 @@ bool test_multiple_regression() {
         return false;
     }
     double pred = model.predict({6.0, 4.0});
-    if (!approx_eq(pred, 25.0, 0.5)) {
-        std::cerr << "  FAIL: Prediction incorrect. Expected 25, got " << pred << "\n";
+    if (!approx_eq(pred, 22.0, 0.5)) {
+        std::cerr << "  FAIL: Prediction incorrect. Expected 22, got " << pred << "\n";
         return false;
     }
     std::cout << "  PASS\n";
@@ -138,17 +183,1655 @@ bool test_train_test_split() {
     return true;
 }
 
+bool test_autoregressive_levinson() {
+    std::cout << "Test 6: AR model via Levinson-Durbin...\n";
+    // simulate x_t = 0.6 x_{t-1} - 0.3 x_{t-2} + e_t with a fixed LCG
+    std::vector<double> x(5000, 0.0);
+    unsigned long long state = 42;
+    auto noise = [&]() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(state >> 11) / 9007199254740992.0 - 0.5;
+    };
+    for (size_t t = 2; t < x.size(); ++t) {
+        x[t] = 0.6 * x[t - 1] - 0.3 * x[t - 2] + noise();
+    }
+    ARModel model(20, OrderCriterion::BIC);
+    if (!model.train(x)) {
+        std::cerr << "  FAIL: Training failed\n";
+        return false;
+    }
+    if (model.order() != 2) {
+        std::cerr << "  FAIL: BIC picked order " << model.order() << ", expected 2\n";
+        return false;
+    }
+    auto phi = model.coefficients();
+    if (!approx_eq(phi[0], 0.6, 0.05) || !approx_eq(phi[1], -0.3, 0.05)) {
+        std::cerr << "  FAIL: Coefficients incorrect. Got [" << phi[0] << ", " << phi[1] << "]\n";
+        return false;
+    }
+    if (model.aic().size() != 21 || model.bic().size() != 21) {
+        std::cerr << "  FAIL: Expected criteria for all 21 orders\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_fft_spectral_features() {
+    std::cout << "Test 7: FFT autocorrelation and spectral features...\n";
+    std::vector<double> x(300);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = std::sin(0.3 * i) + 0.5 * std::cos(1.7 * i) + 0.01 * (i % 7);
+    }
+    // odd length goes through bluestein, even length through the packed real path
+    for (size_t n : {size_t(300), size_t(299)}) {
+        std::vector<double> xs(x.begin(), x.begin() + n);
+        auto back = irfft(rfft(xs), n);
+        for (size_t i = 0; i < n; ++i) {
+            if (!approx_eq(back[i], xs[i], 1e-9)) {
+                std::cerr << "  FAIL: rfft round trip mismatch (n=" << n << ")\n";
+                return false;
+            }
+        }
+    }
+    auto direct = autocovariance(x, 120);
+    auto fast = autocovariance_fft(x, 120);
+    for (size_t k = 0; k < direct.size(); ++k) {
+        if (!approx_eq(direct[k], fast[k], 1e-9)) {
+            std::cerr << "  FAIL: autocovariance mismatch at lag " << k << "\n";
+            return false;
+        }
+    }
+    // rolling ACF from block updates against a direct sum over the last window
+    int window = 64, hop = 8, lag = 5;
+    auto cols = rolling_spectral(x, window, hop, {lag}, 2);
+    size_t end = x.size() - 1;
+    while (std::isnan(cols.acf[0][end]) || (end + 1 - lag) % hop != 0) --end;
+    size_t start = end + 1 - window;
+    double mu = 0.0;
+    for (size_t t = start; t <= end; ++t) mu += x[t];
+    mu /= window;
+    double c0 = 0.0, ck = 0.0;
+    for (size_t t = start; t <= end; ++t) {
+        c0 += (x[t] - mu) * (x[t] - mu);
+        ck += (x[t] - mu) * (x[t - lag] - mu);
+    }
+    if (!approx_eq(cols.acf[0][end], ck / c0, 1e-9)) {
+        std::cerr << "  FAIL: rolling ACF " << cols.acf[0][end] << " vs " << ck / c0 << "\n";
+        return false;
+    }
+    if (!approx_eq(cols.band_power[0][end] + cols.band_power[1][end], 1.0, 1e-9)) {
+        std::cerr << "  FAIL: band powers should sum to 1\n";
+        return false;
+    }
+    // band power from the running spectrum against the last window's periodogram, with
+    // short blocks (direct sums) and long ones (transformed)
+    for (int h : {8, 32}) {
+        auto bands = rolling_spectral(x, window, h, {}, 2);
+        size_t last = x.size() / h * h;
+        auto p = periodogram(std::vector<double>(x.begin() + last - window, x.begin() + last));
+        double low = 0.0, total = 0.0;
+        for (size_t k = 1; k < p.size(); ++k) {
+            total += p[k];
+            if (k < 1 + (p.size() - 1) / 2) low += p[k];
+        }
+        if (!approx_eq(bands.band_power[0][last - 1], low / total, 1e-9)) {
+            std::cerr << "  FAIL: rolling band power " << bands.band_power[0][last - 1] << " vs "
+                      << low / total << " (hop " << h << ")\n";
+            return false;
+        }
+    }
+
+    std::vector<Bar> bars;
+    for (int i = 0; i < 400; ++i) {
+        double c = 100.0 + 10.0 * std::sin(0.2 * i) + 0.05 * i;
+        bars.push_back({"d" + std::to_string(i), c, c + 1, c - 1, c, 1000.0 + i});
+    }
+    FeatureConfig config;
+    config.use_spectral = true;
+    config.spectral_window = 128;
+    config.spectral_hop = 16;
+    FeatureEngineer engineer(config);
+    auto [features, targets] = engineer.create_features(bars, 1);
+    if (features.empty() || static_cast<int>(features[0].size()) != engineer.get_feature_count()
+        || engineer.get_feature_names().size() != features[0].size()) {
+        std::cerr << "  FAIL: spectral feature count mismatch\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_correlation_engine() {
+    std::cout << "Test 8: Blocked covariance/correlation engine...\n";
+    // 70 symbols spans two column tiles, rows are column-major per symbol
+    const size_t n = 70, rows = 60, window = 40;
+    std::vector<double> panel(n * rows);
+    unsigned long long state = 7;
+    for (auto& v : panel) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        v = static_cast<double>(state >> 11) / 9007199254740992.0 - 0.5;
+    }
+    auto naive_cov = [&](size_t i, size_t j, size_t first, size_t len) {
+        double mi = 0.0, mj = 0.0;
+        for (size_t k = first; k < first + len; ++k) { mi += panel[i * rows + k]; mj += panel[j * rows + k]; }
+        mi /= len; mj /= len;
+        double c = 0.0;
+        for (size_t k = first; k < first + len; ++k) {
+            c += (panel[i * rows + k] - mi) * (panel[j * rows + k] - mj);
+        }
+        return c / (len - 1);
+    };
+
+    CorrelationEngine engine(n, window, 3);
+    engine.compute(panel.data(), rows - 5, rows);
+    // slide the last five time steps in one row at a time
+    std::vector<double> row(n);
+    for (size_t k = rows - 5; k < rows; ++k) {
+        for (size_t j = 0; j < n; ++j) row[j] = panel[j * rows + k];
+        engine.push_row(row.data());
+    }
+    for (size_t i = 0; i < n; i += 7) {
+        for (size_t j = 0; j < n; j += 3) {
+            if (!approx_eq(engine.covariance(i, j), naive_cov(i, j, rows - window, window), 1e-12)) {
+                std::cerr << "  FAIL: covariance mismatch at (" << i << ", " << j << ")\n";
+                return false;
+            }
+        }
+    }
+
+    std::string path = "test_correlation_matrix.bin";
+    engine.write(path, MatrixKind::Correlation);
+    {
+        CorrelationFile file(path);
+        if (file.symbols() != n || file.kind() != MatrixKind::Correlation
+            || !approx_eq(file.at(5, 60), engine.correlation(5, 60), 1e-15)
+            || !approx_eq(file.at(60, 5), file.at(5, 60), 0.0)
+            || !approx_eq(file.at(3, 3), 1.0, 1e-12)) {
+            std::cerr << "  FAIL: mapped matrix file does not match engine\n";
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_randomized_factor_model() {
+    std::cout << "Test 9: Randomized PCA factor model...\n";
+    // exact two-factor panel plus per-symbol means: k = 2 must reconstruct it
+    const size_t n = 60, rows = 150;
+    std::vector<double> panel(n * rows);
+    for (size_t j = 0; j < n; ++j) {
+        double b1 = 1.0 + 0.01 * j, b2 = std::sin(0.3 * j), mean = 0.001 * j;
+        for (size_t t = 0; t < rows; ++t) {
+            panel[j * rows + t] = mean + b1 * std::sin(0.1 * t) + b2 * std::cos(0.37 * t + 1.0);
+        }
+    }
+    FactorModel model(2, 5, 2, 2);
+    if (!model.fit(panel.data(), rows, n, rows)) {
+        std::cerr << "  FAIL: Fit failed\n";
+        return false;
+    }
+    double worst = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+        double mean = 0.0;
+        for (size_t t = 0; t < rows; ++t) mean += panel[j * rows + t];
+        mean /= rows;
+        for (size_t t = 0; t < rows; ++t) {
+            double rec = model.factor_return(t, 0) * model.loading(j, 0)
+                       + model.factor_return(t, 1) * model.loading(j, 1);
+            worst = std::max(worst, std::fabs(rec - (panel[j * rows + t] - mean)));
+        }
+    }
+    if (worst > 1e-8) {
+        std::cerr << "  FAIL: Reconstruction error " << worst << "\n";
+        return false;
+    }
+    const auto& var = model.explained_variance();
+    if (!(var[0] >= var[1] && var[1] > 0.0)) {
+        std::cerr << "  FAIL: Explained variance not ordered\n";
+        return false;
+    }
+
+    // fitted on the first 100 rows: the later rows are projected, and changing them
+    // leaves every fitted value alone
+    const size_t span = 100;
+    FactorModel trained(2, 5, 2, 2);
+    auto shocked = panel;
+    for (size_t j = 0; j < n; ++j) shocked[j * rows + 120] += 0.5 * std::cos(double(j));
+    FactorModel other(2, 5, 2, 2);
+    if (!trained.fit(panel.data(), rows, n, rows, span) || !other.fit(shocked.data(), rows, n, rows, span)
+        || trained.rows() != rows) {
+        std::cerr << "  FAIL: Training-span fit failed\n";
+        return false;
+    }
+    worst = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+        double mean = 0.0;
+        for (size_t t = 0; t < span; ++t) mean += panel[j * rows + t];
+        mean /= span;
+        for (size_t t = span; t < rows; ++t) {
+            double rec = trained.factor_return(t, 0) * trained.loading(j, 0)
+                       + trained.factor_return(t, 1) * trained.loading(j, 1);
+            worst = std::max(worst, std::fabs(rec - (panel[j * rows + t] - mean)));
+        }
+        worst = std::max(worst, std::fabs(trained.loading(j, 1) - other.loading(j, 1)));
+    }
+    for (size_t t = 0; t < rows; ++t) {
+        if (t != 120) worst = std::max(worst, std::fabs(trained.factor_return(t, 0) - other.factor_return(t, 0)));
+    }
+    if (worst > 1e-8) {
+        std::cerr << "  FAIL: Training-span fit leaks later rows (" << worst << ")\n";
+        return false;
+    }
+
+    FeatureEngineer engineer;
+    int base = engineer.get_feature_count();
+    model.append_features(engineer, 3, 1, rows + 1);
+    if (engineer.get_feature_count() != base + 3
+        || engineer.get_feature_names().back() != "factor_fit") {
+        std::cerr << "  FAIL: Factor columns not added to feature engineer\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_feature_cache() {
+    std::cout << "Test 10: Feature cache and xxHash64...\n";
+    if (xxhash64("", 0) != 0xEF46DB3751D8E999ULL) {
+        std::cerr << "  FAIL: xxhash64 of empty input does not match reference\n";
+        return false;
+    }
+    // streaming in odd pieces must equal the one-shot hash
+    std::string text(100, 'x');
+    for (size_t i = 0; i < text.size(); ++i) text[i] = static_cast<char>('a' + i % 26);
+    XXHash64 streamed;
+    streamed.update(text.data(), 7);
+    streamed.update(text.data() + 7, 40);
+    streamed.update(text.data() + 47, 53);
+    if (streamed.digest() != xxhash64(text.data(), text.size())) {
+        std::cerr << "  FAIL: streaming hash differs from one-shot hash\n";
+        return false;
+    }
+
+    std::vector<Bar> bars;
+    for (int i = 0; i < 120; ++i) {
+        double c = 100.0 + std::sin(0.1 * i) * 5.0;
+        bars.push_back({"2025-01-" + std::to_string(i), c, c + 1, c - 1, c, 1000.0 + i});
+    }
+    FeatureEngineer engineer;
+    std::string dir = "test_feature_cache";
+    FeatureCache cache(dir);
+    bool hit = true;
+    auto first = cache.get_or_create(engineer, bars, 1, &hit);
+    if (hit) {
+        std::cerr << "  FAIL: empty cache reported a hit\n";
+        return false;
+    }
+    auto second = cache.get_or_create(engineer, bars, 1, &hit);
+    if (!hit || second.first != first.first || second.second != first.second) {
+        std::cerr << "  FAIL: cached features differ from computed ones\n";
+        return false;
+    }
+    uint64_t k1 = feature_cache_key(bars, engineer, 1);
+    if (feature_cache_key(bars, engineer, 2) == k1) {
+        std::cerr << "  FAIL: horizon not part of the cache key\n";
+        return false;
+    }
+    bars[50].close += 0.01;
+    if (feature_cache_key(bars, engineer, 1) == k1) {
+        std::cerr << "  FAIL: bar contents not part of the cache key\n";
+        return false;
+    }
+    // a one-byte budget evicts everything on the next store
+    FeatureCache tiny(dir, 1);
+    tiny.store(42, first.first, first.second);
+    std::vector<std::vector<double>> f;
+    std::vector<double> t;
+    if (tiny.lookup(k1, f, t)) {
+        std::cerr << "  FAIL: LRU eviction did not run\n";
+        return false;
+    }
+    std::filesystem::remove_all(dir);
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_panel_asof_alignment() {
+    std::cout << "Test 11: Date-aligned panel with as-of joins...\n";
+    auto bar = [](const std::string& d, double c) { return Bar{d, c, c, c, c, 100.0}; };
+    std::vector<std::vector<Bar>> series = {
+        {bar("2024-01-02", 10), bar("2024-01-03", 11), bar("2024-01-05", 12)},
+        {bar("2024-01-03", 20), bar("2024-01-04", 21)},
+        {bar("2023-12-29", 30), bar("2024-01-05", 33)},
+    };
+    Panel p = Panel::build({"AAA", "BBB", "CCC"}, series);
+    std::vector<int32_t> expected = {20231229, 20240102, 20240103, 20240104, 20240105};
+    if (p.date_index() != expected) {
+        std::cerr << "  FAIL: unified date index incorrect\n";
+        return false;
+    }
+    // AAA listed 01-02: nothing on 12-29, carried 11 into the 01-04 gap with no volume
+    if (p.valid(0, 0) || !std::isnan(p.at(PanelField::Close, 0, 0))
+        || p.observed(0, 3) || !p.valid(0, 3) || p.at(PanelField::Close, 0, 3) != 11.0
+        || p.at(PanelField::Volume, 0, 3) != 0.0 || p.at(PanelField::Volume, 0, 2) != 100.0
+        || p.asof(PanelField::Volume, 1, 20240110) != 0.0) {
+        std::cerr << "  FAIL: gap handling incorrect\n";
+        return false;
+    }
+    // BBB stops on 01-04 but as-of still sees its last bar
+    if (p.asof(PanelField::Close, 1, 20240110) != 21.0 || !std::isnan(p.asof(PanelField::Close, 1, 20231201))
+        || p.asof(PanelField::Close, 2, 20240104) != 30.0) {
+        std::cerr << "  FAIL: as-of join incorrect\n";
+        return false;
+    }
+    auto r = p.returns(1, 4);
+    if (!approx_eq(r[0 * 4 + 1], 0.1) || r[0 * 4 + 2] != 0.0 || !approx_eq(r[2 * 4 + 3], 0.1)) {
+        std::cerr << "  FAIL: panel returns incorrect\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_loader_pushdown_and_bar_cache() {
+    std::cout << "Test 12: Loader date range / column projection and binary cache...\n";
+    std::string csv = "Date,Open,High,Low,Close,Volume\r\n";
+    std::vector<Bar> all;
+    for (int i = 0; i < 300; ++i) {
+        std::string d = key_to_date(20200101 + (i / 28) * 100 + i % 28);
+        double c = 50.0 + 0.25 * i;
+        all.push_back({d, c - 1, c + 1, c - 2, c, 1000.0 + i});
+        csv += d + "," + std::to_string(c - 1) + "," + std::to_string(c + 1) + ","
+             + std::to_string(c - 2) + "," + std::to_string(c) + "," + std::to_string(1000 + i) + "\r\n";
+    }
+    LoadOptions opts;
+    opts.start_date = "2020-03-05";
+    opts.end_date = "2020-05-10";
+    opts.columns = kClose | kVolume;
+    auto parsed = CSVLoader::parse(csv.data(), csv.size(), opts);
+    // months 03..05 (28 days each), days 5..28 of March + all of April + days 1..10 of May
+    if (parsed.size() != 24 + 28 + 10 || parsed.front().date != "2020-03-05"
+        || !std::isnan(parsed.front().open) || !approx_eq(parsed.front().volume, 1000 + 2 * 28 + 4)) {
+        std::cerr << "  FAIL: CSV pushdown/projection incorrect\n";
+        return false;
+    }
+
+    std::string path = "test_bars.spb";
+    BarCache::write(path, all, 16);
+    auto cached = CSVLoader(path).load(opts);
+    if (cached.size() != parsed.size()) {
+        std::cerr << "  FAIL: binary cache range has " << cached.size() << " rows\n";
+        return false;
+    }
+    for (size_t i = 0; i < cached.size(); ++i) {
+        if (cached[i].date != parsed[i].date || !approx_eq(cached[i].close, parsed[i].close)
+            || !std::isnan(cached[i].high)) {
+            std::cerr << "  FAIL: binary cache row " << i << " differs\n";
+            return false;
+        }
+    }
+    auto range = BarCache::row_range(path, opts);
+    auto full = CSVLoader(path).load();
+    std::remove(path.c_str());
+    if (range.first != 2 * 28 + 4 || full.size() != all.size() || full.back().open != all.back().open) {
+        std::cerr << "  FAIL: binary cache seek or full read incorrect\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_compact_bar_storage() {
+    std::cout << "Test 13: Quantized compact bar storage...\n";
+    std::vector<Bar> bars;
+    for (int i = 0; i < 2500; ++i) {
+        double c = std::round((120.0 + 30.0 * std::sin(0.01 * i)) * 100.0) / 100.0;
+        bars.push_back({key_to_date(20100101 + (i / 28) % 12 * 100 + (i / 336) * 10000 + i % 28),
+                        c - 0.05, c + 0.37, c - 0.41, c, 1e6 + 17.0 * i});
+    }
+    auto compact = CompactBarSeries::encode(bars, 0.01);
+    if (compact.varint_volume() || compact.memory_bytes() * 5 >= bars.size() * 6 * sizeof(double) * 3) {
+        std::cerr << "  FAIL: expected uint32 volumes and under 60% of double columns\n";
+        return false;
+    }
+    auto back = compact.to_bars();
+    for (size_t i = 0; i < bars.size(); ++i) {
+        if (back[i].date != bars[i].date || !approx_eq(back[i].low, bars[i].low, 1e-9)
+            || !approx_eq(back[i].close, bars[i].close, 1e-9) || back[i].volume != bars[i].volume) {
+            std::cerr << "  FAIL: round trip mismatch at row " << i << "\n";
+            return false;
+        }
+    }
+    // partial decode across a block boundary, then a kernel fed block by block
+    std::vector<double> part(50);
+    compact.decode(kHigh, 1000, 50, part.data());
+    if (!approx_eq(part[30], bars[1030].high, 1e-9)) {
+        std::cerr << "  FAIL: partial decode mismatch\n";
+        return false;
+    }
+    double streamed = 0.0, direct = 0.0;
+    compact.for_each_block(kClose, [&](const double* v, size_t n, size_t) {
+        for (size_t i = 0; i < n; ++i) streamed += v[i];
+    });
+    for (const auto& b : bars) direct += b.close;
+    if (!approx_eq(streamed, direct, 1e-6)) {
+        std::cerr << "  FAIL: block stream sum mismatch\n";
+        return false;
+    }
+    // indicators fed block by block match the same indicators over the decoded column
+    auto closes = compact.column(kClose);
+    SMAIndicator sma(50);
+    EMAIndicator ema(12);
+    RSIIndicator rsi(14);
+    for (Indicator* ind : std::vector<Indicator*>{&sma, &ema, &rsi}) {
+        auto blocks = ind->compute(compact, kClose);
+        auto whole = ind->compute(closes);
+        for (size_t i = 0; i < whole.size(); ++i) {
+            if (blocks[i] != whole[i] && !(std::isnan(blocks[i]) && std::isnan(whole[i]))) {
+                std::cerr << "  FAIL: block-fed indicator differs at row " << i << "\n";
+                return false;
+            }
+        }
+    }
+    // volumes past 32 bits switch to varints
+    bars[7].volume = 6e9;
+    auto wide = CompactBarSeries::encode(bars, 0.01);
+    if (!wide.varint_volume() || wide.column(kVolume)[7] != 6e9 || wide.column(kVolume)[2000] != bars[2000].volume) {
+        std::cerr << "  FAIL: varint volume path incorrect\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_bar_archive() {
+    std::cout << "Test 14: Compressed bar archive...\n";
+    std::vector<Bar> bars;
+    for (int i = 0; i < 1000; ++i) {
+        double c = std::round((80.0 + 10.0 * std::sin(0.05 * i)) * 100.0) / 100.0;
+        bars.push_back({key_to_date(19900101 + (i / 336) * 10000 + (i / 28) % 12 * 100 + i % 28),
+                        c, c + 0.5, c - 0.5, c, 5000.0 + (i * 37) % 1000});
+    }
+    // one irrational-looking column forces the xor fallback
+    for (int i = 0; i < 1000; i += 3) bars[i].high = bars[i].close * 1.0001234567;
+
+    std::string path = "test_bars.spa";
+    BarArchive::write(path, bars, 128);
+    auto full = CSVLoader(path).load();
+    if (full.size() != bars.size()) {
+        std::cerr << "  FAIL: archive returned " << full.size() << " rows\n";
+        return false;
+    }
+    for (size_t i = 0; i < bars.size(); ++i) {
+        if (full[i].date != bars[i].date || full[i].close != bars[i].close
+            || full[i].high != bars[i].high || full[i].volume != bars[i].volume) {
+            std::cerr << "  FAIL: archive row " << i << " not bit exact\n";
+            return false;
+        }
+    }
+    LoadOptions opts;
+    opts.start_date = bars[300].date;
+    opts.end_date = bars[520].date;
+    opts.columns = kLow;
+    auto range = BarArchive::read(path, opts);
+
+    // a blob offset past the blobs, or a file cut short, is refused rather than read
+    auto refused = [&](const std::string& bytes) {
+        std::string bad = "test_bad.spa";
+        std::ofstream(bad, std::ios::binary) << bytes;
+        bool threw = false;
+        try {
+            BarArchive::read(bad, {});
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        std::remove(bad.c_str());
+        return threw;
+    };
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    uint64_t index_offset, past_end = bytes.size();
+    std::memcpy(&index_offset, bytes.data() + 24, sizeof(index_offset));
+    std::string moved = bytes;
+    std::memcpy(&moved[index_offset + 16 + 8], &past_end, sizeof(past_end));  // block 0, open column
+    bool corrupt_ok = refused(moved) && refused(bytes.substr(0, bytes.size() / 2));
+    std::remove(path.c_str());
+    if (!corrupt_ok) {
+        std::cerr << "  FAIL: corrupt archive was not rejected\n";
+        return false;
+    }
+    if (range.size() != 221 || range.front().date != bars[300].date
+        || range.back().low != bars[520].low || !std::isnan(range.back().close)) {
+        std::cerr << "  FAIL: archive range read incorrect\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_incremental_gram_update() {
+    std::cout << "Test 15: Incremental retraining from saved statistics...\n";
+    std::vector<std::vector<double>> X;
+    std::vector<double> y;
+    for (int i = 0; i < 200; ++i) {
+        double a = std::sin(0.1 * i), b = std::cos(0.37 * i) + 0.01 * i;
+        X.push_back({a, b});
+        y.push_back(1.5 + 2.0 * a - 0.5 * b + 0.01 * std::sin(1.7 * i));
+    }
+    LinearRegression full;
+    full.train(X, y);
+
+    // first 150 rows, persisted, then the last 50 added on a fresh model
+    LinearRegression first;
+    first.train({X.begin(), X.begin() + 150}, {y.begin(), y.begin() + 150});
+    GramStats saved = first.gram();
+    saved.source = GramStats::fingerprint(X, y, 150);
+    std::string path = "test_gram.bin";
+    if (!saved.save(path)) {
+        std::cerr << "  FAIL: could not save statistics\n";
+        return false;
+    }
+    GramStats state;
+    bool loaded = state.load(path);
+    std::remove(path.c_str());
+    LinearRegression resumed;
+    if (!loaded || state.rows != 150 || !resumed.set_gram(state)
+        || !resumed.update({X.begin() + 150, X.end()}, {y.begin() + 150, y.end()})) {
+        std::cerr << "  FAIL: could not resume from saved statistics\n";
+        return false;
+    }
+    for (size_t i = 0; i < full.coefficients().size(); ++i) {
+        if (!approx_eq(full.coefficients()[i], resumed.coefficients()[i], 1e-9)) {
+            std::cerr << "  FAIL: coefficient " << i << " differs from a full refit\n";
+            return false;
+        }
+    }
+    if (resumed.gram().rows != 200 || resumed.update({{1.0, 2.0, 3.0}}, {1.0})) {
+        std::cerr << "  FAIL: row count or width check wrong\n";
+        return false;
+    }
+    // the saved rows are recognised; a revised first row or one among the last
+    // kFingerprintRows is not, nor is another row count
+    auto head = y, recent = y;
+    head[0] += 1.0;
+    recent[150 - GramStats::kFingerprintRows] += 1.0;
+    if (state.source != GramStats::fingerprint(X, y, 150) || state.source == GramStats::fingerprint(X, head, 150)
+        || state.source == GramStats::fingerprint(X, recent, 150)
+        || state.source == GramStats::fingerprint(X, y, 149)) {
+        std::cerr << "  FAIL: state fingerprint does not identify its rows\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_async_batch_loading() {
+    std::cout << "Test 16: Coroutine loading of many symbol files...\n";
+    namespace fs = std::filesystem;
+    fs::path dir = "test_batch_dir";
+    fs::create_directories(dir);
+    std::vector<std::string> paths;
+    for (int s = 0; s < 12; ++s) {
+        std::string path = (dir / ("SYM" + std::to_string(10 + s) + ".csv")).string();
+        std::ofstream out(path);
+        out << "Date,Open,High,Low,Close,Volume\n";
+        for (int i = 0; i < 120; ++i) {
+            double c = 50.0 + s + 5.0 * std::sin(0.1 * i + s) + 0.02 * i
+                       + ((i * 7919 + s * 104729) % 1000) / 1000.0;
+            out << key_to_date(20200101 + (i / 28) * 100 + i % 28) << ',' << c << ','
+                << c + 1 + 0.3 * std::sin(0.7 * i) << ',' << c - 1 << ',' << c << ','
+                << 1000 + (i * 37 + s * 11) % 400 << '\n';
+        }
+        paths.push_back(path);
+    }
+    paths.push_back((dir / "missing.csv").string());
+
+    AsyncLoadOptions opts;
+    opts.workers = 2;
+    opts.in_flight = 4;
+    auto series = load_many_async(paths, opts);
+    bool ok = series.size() == 13 && series.back().error.find("failed to open") == 0;
+    for (size_t i = 0; ok && i < 12; ++i) {
+        auto direct = CSVLoader(paths[i]).load();
+        ok = series[i].error.empty() && series[i].bars.size() == direct.size()
+             && series[i].bars.back().close == direct.back().close;
+    }
+    if (!ok) {
+        fs::remove_all(dir);
+        std::cerr << "  FAIL: async load differs from CSVLoader\n";
+        return false;
+    }
+
+    BatchConfig config;
+    config.load = opts;
+    auto files = BatchRunner::list_files(dir.string());
+    auto results = BatchRunner(config).run(files);
+    fs::remove_all(dir);
+    if (files.size() != 12 || results.size() != 12 || results[0].symbol != "SYM10"
+        || !results[0].error.empty() || results[0].test_rows == 0) {
+        std::cerr << "  FAIL: batch results incorrect\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_file_reader() {
+    std::cout << "Test 17: Batched file reads (io_uring / pread)...\n";
+    std::vector<std::string> paths = {"test_read_small.txt", "test_read_large.txt",
+                                      "test_read_empty.txt", "test_read_missing.txt"};
+    std::string small = "Date,Close\n2020-01-02,1.5\n";
+    std::string large;
+    for (int i = 0; i < 20000; ++i) large += std::to_string(i * 7919 % 100003) + ",";
+    std::ofstream(paths[0], std::ios::binary) << small;
+    std::ofstream(paths[1], std::ios::binary) << large;
+    std::ofstream(paths[2], std::ios::binary);
+
+    bool ok = true;
+    for (bool uring : {true, false}) {
+        FileReaderOptions opts;
+        opts.use_uring = uring;
+        opts.queue_depth = 2;       // fewer slots than files
+        opts.buffer_bytes = 4096;   // the large file needs many reads
+        FileReader reader(opts);
+        std::vector<std::string> got(paths.size()), errors(paths.size());
+        reader.read_all(paths, [&](size_t i, const char* data, size_t len, const std::string& error) {
+            got[i].assign(data ? data : "", len);
+            errors[i] = error;
+        });
+        ok = ok && got[0] == small && got[1] == large && got[2].empty() && errors[2].empty()
+             && errors[3].find("failed to open") == 0;
+
+        // borrowed data stays valid after the callback until released here
+        std::mutex m;
+        std::condition_variable cv;
+        std::vector<std::pair<const char*, size_t>> held(paths.size());
+        std::vector<std::function<void()>> releases;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            reader.submit_borrowed(paths[i], [&, i](const char* data, size_t len, const std::string&,
+                                                    std::function<void()> release) {
+                std::lock_guard<std::mutex> lock(m);
+                held[i] = {data, len};
+                releases.push_back(std::move(release));
+                cv.notify_all();
+            });
+        }
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return releases.size() == paths.size(); });
+        ok = ok && std::string(held[0].first, held[0].second) == small
+             && std::string(held[1].first, held[1].second) == large;
+        for (auto& release : releases) release();
+    }
+    for (const auto& p : paths) std::remove(p.c_str());
+    if (!ok) {
+        std::cerr << "  FAIL: file contents differ\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_c_api() {
+    std::cout << "Test 18: C API pipeline...\n";
+    std::vector<int32_t> dates;
+    std::vector<double> open, high, low, close, volume;
+    for (int i = 0; i < 200; ++i) {
+        double c = 100.0 + 10.0 * std::sin(0.07 * i) + ((i * 7919) % 1000) / 500.0;
+        dates.push_back(20100101 + (i / 336) * 10000 + (i / 28) % 12 * 100 + i % 28);
+        open.push_back(c - 0.2);
+        high.push_back(c + 1.0);
+        low.push_back(c - 1.0);
+        close.push_back(c);
+        volume.push_back(1e5 + (i * 37) % 5000);
+    }
+    sp_pipeline* p = sp_pipeline_create(1, 0.8);
+    // two pushes, then a date that goes backwards
+    bool ok = p && sp_pipeline_push_bars(p, dates.data(), open.data(), high.data(), low.data(),
+                                         close.data(), volume.data(), 120) == SP_OK
+              && sp_pipeline_push_bars(p, dates.data() + 120, open.data() + 120, high.data() + 120,
+                                       low.data() + 120, close.data() + 120, volume.data() + 120, 80) == SP_OK
+              && sp_pipeline_push_bars(p, dates.data(), open.data(), high.data(), low.data(),
+                                       close.data(), volume.data(), 1) == SP_ERR_ARGUMENT
+              && sp_pipeline_run(p) == SP_OK;
+    size_t rows = 0, cols = 0, n_pred = 0;
+    const double* X = ok ? sp_pipeline_features(p, &rows, &cols) : nullptr;
+    const double* pred = ok ? sp_pipeline_predictions(p, &n_pred) : nullptr;
+    sp_metrics m{};
+    ok = ok && X && pred && n_pred == rows && sp_pipeline_metrics(p, &m) == SP_OK
+         && m.train_rows + m.test_rows == rows;
+
+    if (ok) {
+        // same pipeline through the C++ classes
+        std::vector<Bar> bars;
+        for (size_t i = 0; i < dates.size(); ++i) {
+            bars.push_back({key_to_date(dates[i]), open[i], high[i], low[i], close[i], volume[i]});
+        }
+        FeatureConfig config;
+        FeatureEngineer engineer(config);
+        auto [features, targets] = engineer.create_features(bars, 1);
+        auto [train_X, train_y, test_X, test_y] = engineer.train_test_split(features, targets, 0.8);
+        LinearRegression model;
+        model.train(train_X, train_y);
+        ok = features.size() == rows && features[0].size() == cols
+             && X[cols + 2] == features[1][2]
+             && approx_eq(pred[rows - 1], model.predict(features.back()), 1e-9)
+             && std::string(sp_pipeline_feature_name(p, 0)) == engineer.get_feature_names()[0];
+    }
+    sp_pipeline_free(p);
+    if (!ok) {
+        std::cerr << "  FAIL: C API results differ from the C++ pipeline\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_incremental_refresh() {
+    std::cout << "Test 19: Dirty-tracking batch refresh...\n";
+    namespace fs = std::filesystem;
+    fs::path dir = "test_refresh_data", state = "test_refresh_state";
+    fs::remove_all(state);
+    fs::create_directories(dir);
+    auto series = [](int s, int n) {
+        std::vector<Bar> bars;
+        for (int i = 0; i < n; ++i) {
+            double c = 40.0 + 3 * s + 4.0 * std::sin(0.09 * i + s) + ((i * 7919 + s * 31) % 1000) / 400.0;
+            bars.push_back({key_to_date(20000101 + (i / 336) * 10000 + (i / 28) % 12 * 100 + i % 28),
+                            c, c + 0.5 + 0.2 * std::cos(0.3 * i), c - 0.5, c, 2000.0 + (i * 53 + s) % 700});
+        }
+        return bars;
+    };
+    auto write = [](const fs::path& path, const std::vector<Bar>& bars) {
+        std::ofstream out(path);
+        out.precision(17);
+        out << "Date,Open,High,Low,Close,Volume\n";
+        for (const auto& b : bars) {
+            out << b.date << ',' << b.open << ',' << b.high << ',' << b.low << ',' << b.close << ','
+                << b.volume << '\n';
+        }
+        out.close();
+        // make sure the edit is visible even on coarse timestamps
+        fs::last_write_time(path, fs::file_time_type::clock::now() + std::chrono::seconds(5));
+    };
+    std::vector<std::vector<Bar>> data;
+    std::vector<std::string> paths;
+    for (int s = 0; s < 3; ++s) {
+        data.push_back(series(s, 700));
+        paths.push_back((dir / ("R" + std::to_string(s) + ".csv")).string());
+        write(paths.back(), data.back());
+    }
+    BatchConfig config;
+    BatchRunner runner(config);
+    auto matches_full_run = [&](const std::vector<SymbolResult>& got) {
+        auto full = runner.run(paths);
+        for (size_t i = 0; i < full.size(); ++i) {
+            if (!got[i].error.empty() || got[i].test_rows != full[i].test_rows
+                || !approx_eq(got[i].test_rmse, full[i].test_rmse, 1e-6)
+                || !approx_eq(got[i].last_prediction, full[i].last_prediction, 1e-6)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    RefreshStats first, second, third;
+    bool ok = matches_full_run(runner.refresh(paths, state.string(), &first)) && first.rebuilt == 3;
+    runner.refresh(paths, state.string(), &second);
+    ok = ok && second.unchanged == 3 && second.rows_computed == 0;
+
+    // one symbol gets new days, another a revised bar in the middle
+    auto extra = series(0, 730);
+    data[0] = extra;
+    write(paths[0], data[0]);
+    data[1][400].close *= 1.01;
+    write(paths[1], data[1]);
+    auto results = runner.refresh(paths, state.string(), &third);
+    size_t full_rows = FeatureEngineer().create_features(data[0], 1).first.size()
+                       + FeatureEngineer().create_features(data[1], 1).first.size();
+    ok = ok && matches_full_run(results) && third.unchanged == 1 && third.updated == 2
+         && third.rows_computed < full_rows;
+
+    // another --start changes the bars every file yields, so nothing is reused
+    config.load.load.start_date = data[2][100].date;
+    BatchRunner later(config);
+    RefreshStats fourth;
+    auto moved = later.refresh(paths, state.string(), &fourth);
+    auto full = later.run(paths);
+    ok = ok && fourth.unchanged == 0 && moved[2].test_rows == full[2].test_rows
+         && approx_eq(moved[2].test_rmse, full[2].test_rmse, 1e-6) && moved[2].test_rows != results[2].test_rows;
+
+    // the same symbol as .csv and .spb: two sources, two states, neither evicts the other
+    paths.push_back((dir / "R2.spb").string());
+    BarCache::write(paths.back(), data[2]);
+    RefreshStats fifth, sixth;
+    auto both = later.refresh(paths, state.string(), &fifth);
+    later.refresh(paths, state.string(), &sixth);
+    ok = ok && fifth.unchanged == 3 && fifth.rebuilt == 1 && sixth.unchanged == 4 && both[3].symbol == "R2"
+         && both[3].test_rows == both[2].test_rows;
+    fs::remove_all(dir);
+    fs::remove_all(state);
+    if (!ok) {
+        std::cerr << "  FAIL: refresh differs from a full run or redid too much ("
+                  << third.unchanged << "/" << third.updated << "/" << third.rows_computed << ")\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_huge_page_allocator() {
+    std::cout << "Test 20: Huge-page allocation policy...\n";
+    HugePagePolicy saved = huge_page_policy();
+    size_t saved_threshold = huge_page_threshold();
+    set_huge_page_threshold(1 << 20);
+
+    bool ok = true;
+    for (HugePagePolicy policy : {HugePagePolicy::Off, HugePagePolicy::Advise}) {
+        set_huge_page_policy(policy);
+        HugePageStats before = huge_page_stats();
+        huge_vector<double> big(1 << 18, 1.0);   // 2 MB
+        huge_vector<double> small(100, 2.0);
+        HugePageStats during = huge_page_stats();
+        uint64_t mapped = during.advised_bytes + during.hugetlb_bytes
+                          - before.advised_bytes - before.hugetlb_bytes;
+        big.back() = 3.0;
+        ok = ok && reinterpret_cast<uintptr_t>(big.data()) % 64 == 0
+             && reinterpret_cast<uintptr_t>(small.data()) % 64 == 0
+             && big.back() + small.front() == 5.0;
+#ifndef _WIN32
+        ok = ok && mapped == (policy == HugePagePolicy::Off ? 0 : big.size() * sizeof(double));
+#endif
+    }
+    // a block freed after the policy changed still goes back the way it came
+    set_huge_page_policy(HugePagePolicy::Advise);
+    void* p = huge_alloc(4 << 20);
+    set_huge_page_policy(HugePagePolicy::Off);
+    huge_free(p);
+    HugePageStats after = huge_page_stats();
+    ok = ok && after.advised_bytes == 0 && after.hugetlb_bytes == 0;
+
+    set_huge_page_policy(saved);
+    set_huge_page_threshold(saved_threshold);
+    if (!ok) {
+        std::cerr << "  FAIL: allocation kind, alignment or accounting wrong\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_numa_sharded_batch() {
+    std::cout << "Test 21: NUMA-sharded batch run...\n";
+    auto nodes = numa_topology();
+    bool ok = !nodes.empty();
+    for (const auto& n : nodes) ok = ok && !n.cpus.empty();
+
+    // a pinned thread records its node and its big buffers still work
+    int seen = -2;
+    std::thread([&] {
+        pin_thread_to_node(nodes[0]);
+        seen = current_thread_node();
+        huge_vector<double> buf(1 << 20, 1.5);
+        if (buf.back() != 1.5) seen = -3;
+    }).join();
+    ok = ok && seen == nodes[0].id && current_thread_node() == -1;
+
+    namespace fs = std::filesystem;
+    fs::path dir = "test_numa_dir";
+    fs::create_directories(dir);
+    for (int s = 0; s < 9; ++s) {
+        std::ofstream out(dir / ("N" + std::to_string(s) + ".csv"));
+        out << "Date,Open,High,Low,Close,Volume\n";
+        for (int i = 0; i < 100; ++i) {
+            double c = 30.0 + s + 3.0 * std::sin(0.2 * i + s) + ((i * 7919 + s * 104729) % 1000) / 500.0;
+            out << key_to_date(20210101 + (i / 28) * 100 + i % 28) << ',' << c << ','
+                << c + 1 + 0.2 * std::cos(0.9 * i) << ',' << c - 1 << ',' << c << ','
+                << 2000 + (i * 53 + s) % 700 << '\n';
+        }
+    }
+    BatchConfig config;
+    config.load.in_flight = 4;
+    auto files = BatchRunner::list_files(dir.string());
+    auto plain = BatchRunner(config).run(files);
+    config.numa = true;
+    std::vector<NodeThroughput> per_node;
+    auto sharded = BatchRunner(config).run(files, &per_node);
+    fs::remove_all(dir);
+
+    size_t symbols = 0, bars = 0;
+    for (const auto& n : per_node) {
+        symbols += n.symbols;
+        bars += n.bars;
+    }
+    ok = ok && per_node.size() == nodes.size() && symbols == files.size() && bars == 900
+         && sharded.size() == plain.size();
+    for (size_t i = 0; ok && i < plain.size(); ++i) {
+        ok = sharded[i].symbol == plain[i].symbol && sharded[i].error.empty()
+             && approx_eq(sharded[i].test_rmse, plain[i].test_rmse)
+             && approx_eq(sharded[i].last_prediction, plain[i].last_prediction);
+    }
+    if (!ok) {
+        std::cerr << "  FAIL: topology, pinning or sharded results wrong\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_spsc_ring_streaming() {
+    std::cout << "Test 22: SPSC ring and streaming features...\n";
+    // fifo order across threads, with batches that wrap the ring
+    SpscRing<uint64_t> ring(100);
+    bool ok = ring.capacity() == 128;
+    const uint64_t count = 200000;
+    std::thread producer([&] {
+        uint64_t buf[37];
+        for (uint64_t next = 0; next < count;) {
+            size_t n = 0;
+            while (n < 37 && next + n < count) { buf[n] = next + n; ++n; }
+            size_t done = 0;
+            while (done < n) {
+                done += ring.push(buf + done, n - done);
+                if (done < n) std::this_thread::yield();
+            }
+            next += n;
+        }
+    });
+    uint64_t expect = 0;
+    uint64_t out[50];
+    while (expect < count) {
+        size_t n = ring.pop(out, 50);
+        for (size_t k = 0; k < n; ++k) ok = ok && out[k] == expect++;
+        if (n == 0) std::this_thread::yield();
+    }
+    producer.join();
+    ok = ok && ring.empty();
+
+    // streamed rows equal the batch rows, predictions equal the model's
+    std::vector<Bar> bars;
+    for (int i = 0; i < 300; ++i) {
+        double c = 40.0 + 4.0 * std::sin(0.15 * i) + 0.03 * i + ((i * 7919) % 1000) / 400.0;
+        bars.push_back({key_to_date(20150101 + (i / 336) * 10000 + (i / 28) % 12 * 100 + i % 28),
+                        c, c + 1, c - 1, c, 1000.0 + (i * 61) % 500});
+    }
+    FeatureConfig config;
+    FeatureEngineer engineer(config);
+    std::vector<size_t> index;
+    auto [X, y] = engineer.create_features(bars, 1, 0, &index);
+    StreamingFeatures stream(config);
+    std::vector<double> row;
+    size_t matched = 0;
+    for (size_t i = 0; i < bars.size(); ++i) {
+        bool has = stream.push(bars[i].close, bars[i].volume, row);
+        if (matched < index.size() && index[matched] == i) {
+            ok = ok && has && row == X[matched];
+            ++matched;
+        }
+    }
+    ok = ok && matched == X.size() && !X.empty();
+
+    LinearRegression model;
+    ok = ok && model.train(X, y);
+    StreamingEngine engine(config, 2, 64);
+    engine.set_model(7, model);
+    std::vector<double> predictions(bars.size(), NAN);
+    engine.start([&](const BarRecord& bar, double p) {
+        if (bar.symbol == 7) predictions[bar.date] = p;
+    });
+    for (size_t i = 0; i < bars.size(); ++i) {
+        BarRecord a, b;
+        a.symbol = 7;
+        b.symbol = 8;  // no model: features only
+        a.date = b.date = static_cast<int32_t>(i);
+        a.close = b.close = bars[i].close;
+        a.volume = b.volume = bars[i].volume;
+        BarRecord pair[2] = {a, b};
+        engine.push(pair, 2);
+    }
+    engine.stop();
+    StreamStats stats = engine.stats();
+    ok = ok && stats.bars == 2 * bars.size() && stats.predictions >= X.size();
+    for (size_t k = 0; ok && k < index.size(); ++k) {
+        ok = predictions[index[k]] == model.predict(X[k]);
+    }
+    if (!ok) {
+        std::cerr << "  FAIL: ring order, streamed rows or predictions differ\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_loopback_feed() {
+    std::cout << "Test 23: Loopback feed protocol, tcp and udp...\n";
+    std::vector<BarRecord> sent(3000);
+    for (size_t i = 0; i < sent.size(); ++i) {
+        sent[i].symbol = static_cast<uint32_t>(i % 3);
+        sent[i].date = 20200101 + static_cast<int32_t>(i);
+        sent[i].close = 100.0 + 0.25 * i;
+        sent[i].volume = 1000.0 + i;
+    }
+    // a message split anywhere decodes only once complete
+    std::vector<uint64_t> storage(feed_message_size(4) / 8);
+    char* buf = reinterpret_cast<char*>(storage.data());
+    size_t size = encode_feed_message(buf, sent.data(), 4, 9);
+    FeedMessage msg;
+    bool ok = decode_feed_message(buf, size - 1, msg) == 0 && decode_feed_message(buf, size, msg) == size
+              && msg.count == 4 && msg.header->sequence == 9 && msg.bars[3].close == sent[3].close
+              && reinterpret_cast<const char*>(msg.bars) == buf + sizeof(FeedHeader);
+    ok = ok && FeedEndpoint::parse("udp://239.255.0.1:9100").multicast()
+         && !FeedEndpoint::parse("tcp://127.0.0.1:9100").multicast();
+
+#ifndef _WIN32
+    for (const char* uri : {"tcp://127.0.0.1:39187", "udp://127.0.0.1:39188"}) {
+        FeedEndpoint endpoint = FeedEndpoint::parse(uri);
+        std::vector<BarRecord> got;
+        FeedStats stats;
+        std::string error;
+        auto publish = [&] {
+            try {
+                if (endpoint.udp) {
+                    // a stray datagram and a truncated message, both dropped by the subscriber
+                    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+                    sockaddr_in to{};
+                    to.sin_family = AF_INET;
+                    to.sin_port = htons(endpoint.port);
+                    inet_pton(AF_INET, endpoint.host.c_str(), &to.sin_addr);
+                    const char junk[] = "not a feed message";
+                    sendto(fd, junk, sizeof(junk), 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+                    sendto(fd, buf, size - 8, 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+                    close(fd);
+                }
+                FeedPublisher publisher(endpoint, 5000);
+                for (size_t i = 0; i < sent.size(); i += 100) {
+                    publisher.send(sent.data() + i, 100);
+                    if (endpoint.udp) std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+                publisher.finish();
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        };
+        try {
+            std::thread publisher;
+            if (!endpoint.udp) publisher = std::thread(publish);
+            FeedSubscriber subscriber(endpoint, 5000);
+            if (endpoint.udp) publisher = std::thread(publish);
+            stats = subscriber.run([&](const BarRecord* bars, size_t n) {
+                got.insert(got.end(), bars, bars + n);
+            }, 2000);
+            publisher.join();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        // udp may drop under load, but what arrives is intact and in order
+        bool intact = error.empty() && !got.empty() && stats.bars == got.size();
+        for (size_t i = 1; intact && i < got.size(); ++i) {
+            intact = got[i].date > got[i - 1].date && got[i].close == 100.0 + 0.25 * (got[i].date - 20200101);
+        }
+        if (!endpoint.udp) intact = intact && got.size() == sent.size() && stats.gaps == 0;
+        else intact = intact && stats.malformed == 2;
+        if (!intact) std::cerr << "  " << uri << ": " << (error.empty() ? "records differ" : error) << "\n";
+        ok = ok && intact;
+    }
+#endif
+    if (!ok) {
+        std::cerr << "  FAIL: feed messages not delivered intact\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_shared_prediction_table() {
+    std::cout << "Test 24: Shared-memory prediction table (seqlock)...\n";
+    bool ok = true;
+    try {
+        PredictionTable writer = PredictionTable::create("sp_test_table", 8);
+        PredictionTable reader = PredictionTable::open("sp_test_table");
+        PredictionValue v;
+        ok = reader.capacity() == 8 && !reader.read(3, v) && !reader.read(99, v);
+
+        // every field of a value is derived from k: a torn read would mix two of them
+        std::atomic<bool> done{false};
+        std::thread publisher([&] {
+            for (int k = 1; k <= 200000; ++k) {
+                writer.publish(3, {k * 0.5, k, int64_t(k) * 7, uint64_t(k) * 3});
+            }
+            done = true;
+        });
+        size_t reads = 0;
+        while (!done || reads < 1000) {
+            if (reader.read(3, v)) {
+                ok = ok && v.prediction == v.date * 0.5 && v.timestamp_ns == int64_t(v.date) * 7
+                     && v.model_version == uint64_t(v.date) * 3;
+                ++reads;
+            }
+        }
+        publisher.join();
+        ok = ok && reader.read(3, v) && v.date == 200000;
+        bool threw = false;
+        try {
+            reader.publish(3, v);
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        ok = ok && threw && PredictionTable::remove("sp_test_table");
+    } catch (const std::exception& e) {
+        std::cerr << "  " << e.what() << "\n";
+        ok = false;
+    }
+    if (!ok) {
+        std::cerr << "  FAIL: torn or missing prediction\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_tick_aggregation() {
+    std::cout << "Test 25: Tick-to-bar aggregation (time, volume, dollar)...\n";
+    {
+        std::ofstream out("test_ticks.csv");
+        out << "Symbol,Timestamp,Price,Size\n"
+            << "AAA,2024-01-02 09:30:00,10,100\n"
+            << "BBB,2024-01-02T09:30:05.250Z,50,10\n"
+            << "AAA,2024-01-02 09:30:30,11,50\n"
+            << "AAA,1704187870000000000,9,100\n";  // 09:31:10
+    }
+    std::vector<BarSpec> specs = {BarSpec::parse("time1m"), BarSpec::parse("volume100"),
+                                  BarSpec::parse("dollar1500")};
+    std::vector<AggregatedBar> bars;
+    std::vector<Tick> ticks;
+    SymbolTable symbols;
+    TickAggregator agg(specs, [&](const AggregatedBar& b) { bars.push_back(b); });
+    bool ok = true;
+    try {
+        read_ticks("test_ticks.csv", symbols, [&](const Tick* t, size_t n) {
+            agg.add(t, n);
+            ticks.insert(ticks.end(), t, t + n);
+        }, 3);
+        agg.flush();
+        write_ticks("test_ticks.spt", ticks, symbols);
+        SymbolTable again;
+        std::vector<Tick> reread;
+        read_ticks("test_ticks.spt", again, [&](const Tick* t, size_t n) { reread.insert(reread.end(), t, t + n); });
+        ok = reread.size() == ticks.size() && again.size() == 2 && again.name(1) == "BBB";
+        for (size_t i = 0; ok && i < ticks.size(); ++i) {
+            ok = reread[i].time_ns == ticks[i].time_ns && reread[i].price == ticks[i].price
+                 && reread[i].symbol == ticks[i].symbol;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "  " << e.what() << "\n";
+        ok = false;
+    }
+    std::remove("test_ticks.csv");
+    std::remove("test_ticks.spt");
+
+    auto find = [&](uint32_t symbol, uint32_t spec, size_t nth) -> const AggregatedBar* {
+        for (const auto& b : bars) {
+            if (b.symbol == symbol && b.spec == spec && nth-- == 0) return &b;
+        }
+        return nullptr;
+    };
+    const AggregatedBar* t0 = find(0, 0, 0);
+    const AggregatedBar* t1 = find(0, 0, 1);
+    const AggregatedBar* v1 = find(0, 1, 1);
+    const AggregatedBar* d0 = find(0, 2, 0);
+    const AggregatedBar* b0 = find(1, 0, 0);
+    ok = ok && ticks.size() == 4 && ticks[3].time_ns == ticks[0].time_ns + 70000000000LL
+         && ticks[1].time_ns == ticks[0].time_ns + 5250000000LL
+         && t0 && t1 && !find(0, 0, 2) && format_time_ns(t0->start_ns) == "2024-01-02 09:30:00"
+         && t0->open == 10 && t0->high == 11 && t0->close == 11 && t0->volume == 150 && t0->ticks == 2
+         && t1->open == 9 && t1->volume == 100
+         && v1 && v1->open == 11 && v1->low == 9 && v1->close == 9 && v1->volume == 150 && !find(0, 1, 2)
+         && d0 && d0->close == 11 && d0->notional == 1550 && find(0, 2, 1) && find(0, 2, 1)->ticks == 1
+         && b0 && b0->open == 50 && format_time_ns(b0->end_ns) == "2024-01-02 09:31:00";
+    if (!ok) {
+        std::cerr << "  FAIL: aggregated bars or tick file round trip wrong\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_bar_normalization() {
+    std::cout << "Test 26: Radix-sort normalization and duplicate bars...\n";
+    std::string csv = "Date,Open,High,Low,Close,Volume\n"
+                      "2024-01-03,3,4,2,3.5,300\n"
+                      "2024-01-02,1,2,0.5,1.5,100\n"
+                      "2024-01-03,3.1,5,2.5,3.2,50\n"
+                      "2023-12-29,0.9,1,0.8,0.95,10\n";
+    LoadOptions options;
+    auto as_is = CSVLoader::parse(csv.data(), csv.size(), options);
+    options.normalize = true;
+    auto last = CSVLoader::parse(csv.data(), csv.size(), options);
+    options.duplicates = DuplicatePolicy::Merge;
+    auto merged = CSVLoader::parse(csv.data(), csv.size(), options);
+    options.duplicates = DuplicatePolicy::Keep;
+    auto kept = CSVLoader::parse(csv.data(), csv.size(), options);
+    bool ok = as_is.size() == 4 && as_is[0].date == "2024-01-03"
+              && last.size() == 3 && last[0].date == "2023-12-29" && last[1].date == "2024-01-02"
+              && last[2].open == 3.1 && last[2].volume == 50
+              && merged.size() == 3 && merged[2].open == 3 && merged[2].high == 5 && merged[2].low == 2
+              && merged[2].close == 3.2 && merged[2].volume == 350
+              && kept.size() == 4 && kept[2].open == 3 && kept[3].open == 3.1;
+
+    // intraday stamps; the time of day orders rows within a date
+    ok = ok && bar_time_key("2024-01-02 09:30:00.5") < bar_time_key("2024-01-02T09:30:00.600")
+         && bar_time_key("2024-01-02 23:59:59") < bar_time_key("2024-01-03")
+         && bar_time_key("2024-01-02") == bar_time_key("2024-01-02 00:00");
+
+    // shuffled minute bars with repeats against a stable comparison sort
+    std::mt19937 rng(7);
+    std::vector<Bar> bars;
+    for (int i = 0; i < 20000; ++i) {
+        int minute = int(rng() % 5000);
+        char date[32];
+        std::snprintf(date, sizeof(date), "20%02d-%02d-%02d %02d:%02d:00", 10 + minute / 2000, 1 + minute % 12,
+                      1 + minute % 28, minute / 60 % 24, minute % 60);
+        bars.push_back({date, double(i), 0, 0, 0, 1});
+    }
+    auto expected = bars;
+    std::stable_sort(expected.begin(), expected.end(), [](const Bar& a, const Bar& b) {
+        return bar_time_key(a.date) < bar_time_key(b.date);
+    });
+    NormalizeStats stats;
+    normalize_bars(bars, DuplicatePolicy::Keep, &stats);
+    ok = ok && !stats.was_sorted && stats.duplicates == 0 && bars.size() == expected.size();
+    for (size_t i = 0; ok && i < bars.size(); ++i) ok = bars[i].date == expected[i].date && bars[i].open == expected[i].open;
+    normalize_bars(bars, DuplicatePolicy::KeepFirst, &stats);
+    size_t distinct = 1;
+    for (size_t i = 1; i < expected.size(); ++i) distinct += expected[i].date != expected[i - 1].date;
+    ok = ok && stats.was_sorted && stats.rows_out == distinct && stats.duplicates == 20000 - distinct
+         && bars.size() == distinct && bars[0].open == expected[0].open;
+    for (size_t i = 1; ok && i < bars.size(); ++i) ok = bar_time_key(bars[i - 1].date) < bar_time_key(bars[i].date);
+    if (!ok) {
+        std::cerr << "  FAIL: normalized bars out of order or duplicates resolved wrong\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_data_quality() {
+    std::cout << "Test 27: Data-quality checks while parsing...\n";
+    std::string csv = "Date,Open,High,Low,Close,Volume\n"
+                      "2024-01-01,10,11,9,10,100\n"
+                      "2024-01-02,10,11,9,10.5,100\n"
+                      "2024-01-03,10.5,10,11,10.6,100\n"   // high < low
+                      "2024-01-04,10.6,11,10,0,100\n"      // zero close
+                      "2024-01-05,10.6,30,10,25,100\n"     // gap from 10.6
+                      "2024-01-08,10.6,11,10,10.8,inf\n"   // non-finite volume
+                      "2024-01-09,10.8,11,10,11,5000\n"    // volume spike
+                      "2024-01-10,11,11.5,10.5,11.2,100\n";
+    LoadOptions options;
+    options.quality.volume_window = 2;
+    options.quality.volume_spike = 10;
+    QualityReport report;
+    options.quality.policy = QualityPolicy::Flag;
+    auto flagged = CSVLoader::parse(csv.data(), csv.size(), options, &report);
+    bool ok = flagged.size() == 8 && report.rows == 8 && report.flagged == 5 && report.dropped == 0
+              && report.rule_counts[2] == 1 && report.rule_counts[0] == 1 && report.rule_counts[3] == 1
+              && report.rule_counts[1] == 1 && report.rule_counts[4] == 1
+              && report.flagged_rows.size() == 1 && report.flagged_rows[0] == 0x7c
+              && !report.is_flagged(0) && report.is_flagged(2) && !report.is_flagged(7) && !report.is_flagged(500);
+
+    options.quality.policy = QualityPolicy::Drop;
+    auto dropped = CSVLoader::parse(csv.data(), csv.size(), options, &report);
+    ok = ok && dropped.size() == 3 && report.dropped == 5 && dropped[2].date == "2024-01-10";
+
+    options.quality.policy = QualityPolicy::Clamp;
+    auto clamped = CSVLoader::parse(csv.data(), csv.size(), options, &report);
+    ok = ok && clamped.size() == 8 && report.repaired == 5
+         && clamped[2].high == 11 && clamped[2].low == 10 && clamped[2].close == 10.6
+         && clamped[3].close == 10.6 && clamped[3].date == "2024-01-04"   // filled from the row before
+         && std::fabs(clamped[4].close - 15.9) < 1e-9 && std::fabs(clamped[4].high - 15.9) < 1e-9
+         && clamped[5].volume == 100 && clamped[6].volume < 5000 && clamped[6].volume > 100;
+
+    options.quality.policy = QualityPolicy::ForwardFill;
+    auto filled = CSVLoader::parse(csv.data(), csv.size(), options, &report);
+    ok = ok && filled.size() == 8 && filled[4].close == 10.5 && filled[4].date == "2024-01-05"
+         && filled[6].volume == 100 && filled[7].close == 11.2;
+
+    // a 3:1 split in unadjusted bars: after reanchor_rows rows on the new level the gap is
+    // measured from there, so only the first rows of the new level are flagged
+    std::vector<Bar> shifted;
+    for (int i = 0; i < 100; ++i) {
+        double c = (i < 50 ? 90.0 : 30.0) + 0.1 * (i % 7);
+        shifted.push_back({key_to_date(20240101 + (i / 28) * 100 + i % 28), c, c + 0.5, c - 0.5, c, 1000});
+    }
+    QualityRules split_rules;
+    split_rules.policy = QualityPolicy::Drop;
+    auto kept = shifted;
+    QualityReport split = check_bars(kept, split_rules, kAllColumns);
+    ok = ok && split.flagged == 2 && kept.size() == 98 && split.is_flagged(50) && split.is_flagged(51)
+         && !split.is_flagged(52) && kept.back().close == shifted.back().close;
+    split_rules.policy = QualityPolicy::ForwardFill;
+    auto filled_split = shifted;
+    check_bars(filled_split, split_rules, kAllColumns);
+    ok = ok && filled_split[51].close == shifted[49].close && filled_split[60].close == shifted[60].close;
+    split_rules.reanchor_rows = 0;
+    kept = shifted;
+    ok = ok && check_bars(kept, split_rules, kAllColumns).flagged == 50;
+
+    // a zero close divides to inf in the features; such rows are left out, not kept
+    LoadOptions raw;
+    auto bars = CSVLoader::parse(csv.data(), csv.size(), raw);
+    for (int i = 0; i < 80; ++i) bars.push_back({key_to_date(20240201 + i % 28), 11, 12, 10, 11 + 0.1 * (i % 5), 100});
+    bars[60].close = 0;
+    FeatureConfig config;
+    config.use_sma = config.use_ema = config.use_rsi = false;
+    auto [X, y] = FeatureEngineer(config).create_features(bars, 1);
+    for (const auto& row : X) {
+        for (double v : row) ok = ok && std::isfinite(v);
+    }
+    for (double v : y) ok = ok && std::isfinite(v);
+    ok = ok && X.size() > 20 && X.size() < 37;
+    if (!ok) {
+        std::cerr << "  FAIL: flagged rows, policies or non-finite features wrong\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_adjusted_view() {
+    std::cout << "Test 28: Split and dividend adjustment view...\n";
+    // raw prices halve at the split on bar 60; a 1.0 dividend goes ex on bar 80
+    std::vector<Bar> raw;
+    for (int i = 0; i < 100; ++i) {
+        double px = (i < 60 ? 100.0 : 50.0) + 0.5 * (i % 7) - (i >= 80 ? 1.0 : 0.0);
+        raw.push_back({key_to_date(20200101 + (i / 28) * 100 + i % 28), px, px + 1, px - 1, px, 1000.0 + i});
+    }
+    AdjustmentTable table;
+    table.add({date_to_key(raw[80].date), 1.0, 0.6});
+    table.add({date_to_key(raw[60].date), 2.0, 0.0});
+    table.add({date_to_key(raw[80].date), 1.0, 0.4});  // same day: dividends add
+    AdjustedView view(raw, table);
+    double div_factor = 1.0 - 1.0 / raw[79].close;
+    auto close = view.column(kClose);
+    auto volume = view.column(kVolume);
+    bool ok = table.actions().size() == 2 && table.actions()[0].split == 2.0 && table.actions()[1].dividend == 1.0
+              && view.segments().size() == 3 && view.segments()[1].begin == 60 && view.segments()[2].begin == 80
+              && close[99] == raw[99].close && close[80] == raw[80].close
+              && std::fabs(close[79] - raw[79].close * div_factor) < 1e-12
+              && std::fabs(close[10] - raw[10].close * div_factor / 2) < 1e-12
+              && volume[10] == raw[10].volume * 2 && volume[70] == raw[70].volume
+              && view.bar(10).high == raw[10].high * view.segments()[0].price;
+
+    // a part of a column across a segment boundary
+    std::vector<double> part(10);
+    view.column(kOpen, 55, 10, part.data());
+    for (int k = 0; k < 10; ++k) ok = ok && part[k] == view.bar(55 + k).open;
+
+    // the view gives the same rows as an adjusted copy of the bars
+    auto copy = view.to_bars();
+    FeatureEngineer engineer;
+    auto [X1, y1] = engineer.create_features(copy, 1);
+    auto [X2, y2] = engineer.create_features(view, 1);
+    ok = ok && !X1.empty() && X1 == X2 && y1 == y2;
+
+    // tables on disk: append adds a line, load merges it in date order
+    const char* path = "test_adjustments.csv";
+    std::remove(path);
+    try {
+        table.save(path);
+        AdjustmentTable::append(path, {20200105, 3.0, 0.0});
+        AdjustmentTable loaded = AdjustmentTable::load(path);
+        ok = ok && loaded.actions().size() == 3 && loaded.actions()[0].date == 20200105
+             && loaded.actions()[2].dividend == 1.0 && AdjustmentTable::load("no_such_table.csv").empty();
+    } catch (const std::exception& e) {
+        std::cerr << "  " << e.what() << "\n";
+        ok = false;
+    }
+    std::remove(path);
+    if (!ok) {
+        std::cerr << "  FAIL: adjusted prices or adjustment table wrong\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_range_index() {
+    std::cout << "Test 29: Range-query index (sparse table + prefix sums)...\n";
+    namespace fs = std::filesystem;
+    std::mt19937 rng(11);
+    std::vector<Bar> bars;
+    double px = 50.0;
+    for (int i = 0; i < 3000; ++i) {
+        px = std::max(1.0, px + double(int(rng() % 200) - 100) / 100.0);
+        int32_t key = 20000101 + (i / 336) * 10000 + (i / 28 % 12) * 100 + i % 28;
+        bars.push_back({key_to_date(key), px, px + double(rng() % 300) / 100.0, px - double(rng() % 300) / 100.0,
+                        px + 0.1, double(1000 + rng() % 5000)});
+    }
+    RangeIndex index = RangeIndex::build(bars);
+    bool ok = index.size() == bars.size() && std::isnan(index.max_high(5, 5)) && index.volume(7, 7) == 0.0;
+    for (int q = 0; ok && q < 2000; ++q) {
+        size_t a = rng() % bars.size(), b = rng() % bars.size();
+        if (q % 4 == 0) b = a + rng() % 40;  // short ranges inside one or two blocks
+        size_t first = std::min(a, b), last = std::min(bars.size(), std::max(a, b) + 1);
+        double hi = -1e300, lo = 1e300, vol = 0.0, pv = 0.0;
+        for (size_t i = first; i < last; ++i) {
+            hi = std::max(hi, bars[i].high);
+            lo = std::min(lo, bars[i].low);
+            vol += bars[i].volume;
+            pv += (bars[i].high + bars[i].low + bars[i].close) / 3.0 * bars[i].volume;
+        }
+        RangeStats r = index.query_rows(first, last);
+        ok = r.rows == last - first && r.high == hi && r.low == lo && std::fabs(r.volume - vol) < 1e-6
+             && std::fabs(r.vwap - pv / vol) < 1e-9 && r.open == bars[first].open && r.close == bars[last - 1].close;
+    }
+    RangeStats by_date = index.query(date_to_key(bars[100].date), date_to_key(bars[199].date));
+    RangeStats none = index.query(19900101, 19901231);
+    ok = ok && by_date.rows == 100 && by_date.high == index.max_high(100, 200) && none.rows == 0 && std::isnan(none.high);
+
+    // minute bars: a day spans many rows, an hour is a key range, a repeated minute is refused
+    std::vector<Bar> minutes;
+    for (int i = 0; i < 3 * 390; ++i) {
+        int m = 9 * 60 + 30 + i % 390;
+        char stamp[32];
+        std::snprintf(stamp, sizeof(stamp), "2021-03-%02d %02d:%02d", 1 + i / 390, m / 60, m % 60);
+        double c = 20.0 + 0.01 * i;
+        minutes.push_back({stamp, c, c + 0.05, c - 0.05, c, 100.0});
+    }
+    RangeIndex intraday = RangeIndex::build(minutes);
+    auto day = intraday.rows(20210302, 20210302);
+    auto hour = intraday.rows_between(bar_time_key("2021-03-02 10:00"), bar_time_key("2021-03-02 10:59"));
+    RangeStats days = intraday.query(20210302, 20210303);
+    ok = ok && day == std::make_pair(size_t(390), size_t(780)) && hour == std::make_pair(size_t(420), size_t(480))
+         && days.rows == 780 && days.first_date == 20210302 && days.last_date == 20210303;
+    minutes[5].date = minutes[4].date;
+    try {
+        RangeIndex::build(minutes);
+        ok = false;
+    } catch (const std::invalid_argument&) {
+    }
+
+    // stored with the bar cache, or built from a cache written without it
+    fs::path with = fs::temp_directory_path() / "sp_test_range.spb";
+    fs::path without = fs::temp_directory_path() / "sp_test_norange.spb";
+    try {
+        BarCache::write(with.string(), bars, 1024, true);
+        BarCache::write(without.string(), bars);
+        RangeIndex stored = BarCache::range_index(with.string());
+        RangeIndex rebuilt = BarCache::range_index(without.string());
+        ok = ok && fs::file_size(with) > fs::file_size(without) && CSVLoader(with.string()).load().size() == bars.size();
+        for (int q = 0; ok && q < 200; ++q) {
+            size_t a = rng() % bars.size(), b = a + rng() % (bars.size() - a) + 1;
+            RangeStats x = index.query_rows(a, b), y = stored.query_rows(a, b), z = rebuilt.query_rows(a, b);
+            ok = x.high == y.high && x.low == y.low && x.vwap == y.vwap && x.high == z.high && x.volume == z.volume;
+        }
+
+        // through the C API, over pushed bars and over the file
+        std::vector<int32_t> dates;
+        std::vector<double> open, high, low, close, volume;
+        for (const auto& bar : bars) {
+            dates.push_back(date_to_key(bar.date));
+            open.push_back(bar.open);
+            high.push_back(bar.high);
+            low.push_back(bar.low);
+            close.push_back(bar.close);
+            volume.push_back(bar.volume);
+        }
+        sp_pipeline* p = sp_pipeline_create(1, 0.8);
+        sp_range_stats api{};
+        ok = ok && p && sp_pipeline_push_bars(p, dates.data(), open.data(), high.data(), low.data(), close.data(),
+                                               volume.data(), dates.size()) == SP_OK
+             && sp_pipeline_range_query(p, dates[100], dates[199], &api) == SP_OK && api.rows == 100
+             && api.high == by_date.high && api.vwap == by_date.vwap;
+        sp_pipeline_free(p);
+        // a damaged section header is not trusted: the tables are rebuilt from the columns
+        {
+            std::fstream f(with, std::ios::in | std::ios::out | std::ios::binary);
+            std::string bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+            size_t at = bytes.rfind("SPRNG1");
+            uint64_t huge_blocks = uint64_t(1) << 60;
+            f.seekp(at + 16);
+            f.write(reinterpret_cast<const char*>(&huge_blocks), sizeof(huge_blocks));
+            ok = ok && at != std::string::npos && f.good();
+        }
+        RangeStats damaged = BarCache::range_index(with.string()).query_rows(100, 2000);
+        ok = ok && damaged.high == index.max_high(100, 2000) && damaged.vwap == index.vwap(100, 2000);
+
+        sp_range_index* file = sp_range_index_open(with.string().c_str());
+        ok = ok && file && sp_range_index_query(file, dates[100], dates[199], &api) == SP_OK && api.low == by_date.low
+             && !sp_range_index_open("no_such_file.spb");
+        sp_range_index_free(file);
+    } catch (const std::exception& e) {
+        std::cerr << "  " << e.what() << "\n";
+        ok = false;
+    }
+    fs::remove(with);
+    fs::remove(without);
+    if (!ok) {
+        std::cerr << "  FAIL: range aggregates differ from a linear scan\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
+bool test_task_graph() {
+    std::cout << "Test 30: Task graph executor and threaded feature/training pipeline...\n";
+    // a diamond per chain: every task must see its dependencies finished
+    TaskGraph graph;
+    std::vector<std::atomic<int>> done(400);
+    std::atomic<bool> order_ok{true};
+    for (size_t c = 0; c < 100; ++c) {
+        auto top = graph.add([&, c] { done[4 * c] = 1; });
+        auto left = graph.then(top, [&, c] { order_ok = order_ok && done[4 * c] == 1; done[4 * c + 1] = 1; });
+        auto right = graph.then(top, [&, c] { order_ok = order_ok && done[4 * c] == 1; done[4 * c + 2] = 1; });
+        graph.add([&, c] { order_ok = order_ok && done[4 * c + 1] == 1 && done[4 * c + 2] == 1; done[4 * c + 3] = 1; },
+                  {left, right});
+    }
+    std::atomic<size_t> ranged{0};
+    auto join = graph.add_range(64, [&](size_t i) { ranged += i; });
+    bool join_ok = false;
+    graph.then(join, [&] { join_ok = ranged == 64 * 63 / 2; });
+    bool ok = true;
+    for (unsigned threads : {1u, 4u}) {
+        for (auto& d : done) d = 0;
+        ranged = 0;
+        join_ok = false;
+        graph.run(threads);
+        for (auto& d : done) ok = ok && d == 1;
+        ok = ok && join_ok && order_ok;
+    }
+    TaskGraph failing;
+    bool skipped = true;
+    auto bad = failing.add([] { throw std::runtime_error("task failed"); });
+    failing.then(bad, [&] { skipped = false; });
+    for (unsigned threads : {1u, 3u}) {
+        try {
+            failing.run(threads);
+            ok = false;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    try {
+        graph.add(nullptr, {graph.size()});
+        ok = false;
+    } catch (const std::out_of_range&) {
+    }
+    ok = ok && skipped;
+
+    // a long series: rows and fits must not depend on the worker count
+    std::vector<Bar> bars;
+    std::mt19937 rng(5);
+    double px = 100.0;
+    for (int i = 0; i < 40000; ++i) {
+        px = std::max(1.0, px * (1.0 + (double(rng() % 2001) - 1000.0) / 100000.0));
+        bars.push_back({key_to_date(19000101 + (i / 336) * 10000 + (i / 28 % 12) * 100 + i % 28), px, px + 0.5,
+                        px - 0.5, px, double(1000 + rng() % 9000)});
+    }
+    FeatureConfig config;
+    config.use_spectral = true;
+    config.threads = 1;
+    std::vector<size_t> idx1, idx4;
+    auto [X1, y1] = FeatureEngineer(config).create_features(bars, 1, 0, &idx1);
+    config.threads = 4;
+    auto [X4, y4] = FeatureEngineer(config).create_features(bars, 1, 0, &idx4);
+    ok = ok && !X1.empty() && X1 == X4 && y1 == y4 && idx1 == idx4;
+
+    // the spectral columns leave this synthetic fit singular; fit the default columns
+    auto [X, y] = FeatureEngineer().create_features(bars, 1);
+    LinearRegression one, four;
+    one.set_threads(1);
+    four.set_threads(4);
+    ok = ok && one.train(X, y) && four.train(X, y) && one.coefficients() == four.coefficients()
+         && one.gram().rows == X.size();
+    if (!ok) {
+        std::cerr << "  FAIL: task graph ordering, errors or threaded results differ\n";
+        return false;
+    }
+    std::cout << "  PASS\n";
+    return true;
+}
+
 int main() {
     std::cout << "=== Predictor Unit Tests ===\n\n";
     
     int passed = 0;
-    int total = 5;
+    int total = 30;
     
     if (test_linear_regression_basic()) passed++;
     if (test_multiple_regression()) passed++;
     if (test_evaluation_metrics()) passed++;
     if (test_feature_engineering()) passed++;
     if (test_train_test_split()) passed++;
+    if (test_autoregressive_levinson()) passed++;
+    if (test_fft_spectral_features()) passed++;
+    if (test_correlation_engine()) passed++;
+    if (test_randomized_factor_model()) passed++;
+    if (test_feature_cache()) passed++;
+    if (test_panel_asof_alignment()) passed++;
+    if (test_loader_pushdown_and_bar_cache()) passed++;
+    if (test_compact_bar_storage()) passed++;
+    if (test_bar_archive()) passed++;
+    if (test_incremental_gram_update()) passed++;
+    if (test_async_batch_loading()) passed++;
+    if (test_file_reader()) passed++;
+    if (test_c_api()) passed++;
+    if (test_incremental_refresh()) passed++;
+    if (test_huge_page_allocator()) passed++;
+    if (test_numa_sharded_batch()) passed++;
+    if (test_spsc_ring_streaming()) passed++;
+    if (test_loopback_feed()) passed++;
+    if (test_shared_prediction_table()) passed++;
+    if (test_tick_aggregation()) passed++;
+    if (test_bar_normalization()) passed++;
+    if (test_data_quality()) passed++;
+    if (test_adjusted_view()) passed++;
+    if (test_range_index()) passed++;
+    if (test_task_graph()) passed++;
     
     std::cout << "\n=== Results: " << passed << "/" << total << " tests passed ===\n";
     
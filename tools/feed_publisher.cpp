@@ -0,0 +1,112 @@
+// replays bar files over the loopback feed (src/feed.h) at a fixed rate, a local
+// stand-in for the production market-data feed
+
+#include "batch.h"
+#include "csv_loader.h"
+#include "feed.h"
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace sp;
+using namespace std;
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+    vector<string> args;
+    map<string, string> options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            size_t eq = arg.find('=');
+            string name = arg.substr(2, eq == string::npos ? string::npos : eq - 2);
+            options[name] = eq == string::npos ? "" : arg.substr(eq + 1);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() < 2) {
+        cerr << "Usage: feed_publisher <file|dir> <tcp://host:port|udp://host:port> [options]\n";
+        cerr << "\nOptions:\n";
+        cerr << "  --rate=<n>         bars per second, 0 = as fast as possible (default 0)\n";
+        cerr << "  --batch=<n>        bars per send (default 64)\n";
+        cerr << "  --loops=<n>        replay the data n times (default 1)\n";
+        cerr << "\nFiles (.csv, .spb, .spa) become symbols 0, 1, ... in name order; bars are\n";
+        cerr << "interleaved across symbols. udp multicast groups stay on this host.\n";
+        cerr << "\nExample: feed_publisher data/stock_data.csv tcp://127.0.0.1:9100 --rate=50000\n";
+        return 1;
+    }
+    try {
+        vector<string> paths = fs::is_directory(args[0]) ? BatchRunner::list_files(args[0])
+                                                          : vector<string>{args[0]};
+        double rate = options.count("rate") ? stod(options["rate"]) : 0.0;
+        size_t batch = options.count("batch") ? max<size_t>(1, stoul(options["batch"])) : 64;
+        size_t loops = options.count("loops") ? stoul(options["loops"]) : 1;
+
+        vector<vector<Bar>> series;
+        size_t longest = 0;
+        for (const auto& p : paths) {
+            series.push_back(CSVLoader(p).load());
+            longest = max(longest, series.back().size());
+        }
+        vector<BarRecord> feed;
+        for (size_t i = 0; i < longest; ++i) {
+            for (size_t s = 0; s < series.size(); ++s) {
+                if (i >= series[s].size()) continue;
+                const Bar& b = series[s][i];
+                BarRecord r;
+                r.symbol = static_cast<uint32_t>(s);
+                r.date = date_to_key(b.date);
+                r.open = b.open;
+                r.high = b.high;
+                r.low = b.low;
+                r.close = b.close;
+                r.volume = b.volume;
+                feed.push_back(r);
+            }
+        }
+        if (feed.empty()) {
+            cerr << "Error: no bars in " << args[0] << "\n";
+            return 1;
+        }
+
+        FeedEndpoint endpoint = FeedEndpoint::parse(args[1]);
+        cout << "Publishing " << feed.size() << " bars of " << series.size() << " symbol(s) x "
+             << loops << " on " << endpoint.str();
+        if (!endpoint.udp) cout << " (waiting for a subscriber)";
+        cout << "\n";
+        FeedPublisher publisher(endpoint);
+
+        // paced against the start time, so a slow send is caught up rather than drifting
+        auto start = chrono::steady_clock::now();
+        size_t sent = 0;
+        for (size_t loop = 0; loop < loops; ++loop) {
+            for (size_t i = 0; i < feed.size(); i += batch) {
+                size_t n = min(batch, feed.size() - i);
+                if (rate > 0) {
+                    this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                         chrono::duration<double>(sent / rate)));
+                }
+                int64_t now = StreamingEngine::now_ns();
+                for (size_t k = 0; k < n; ++k) feed[i + k].stamp_ns = now;
+                publisher.send(feed.data() + i, n);
+                sent += n;
+            }
+        }
+        publisher.finish();
+
+        const FeedStats& st = publisher.stats();
+        double secs = max(st.seconds, 1e-9);
+        cout << "  Sent " << st.bars << " bars in " << st.messages << " messages, "
+             << st.bytes / 1024 << " KiB in " << fixed << setprecision(3) << st.seconds << " s ("
+             << setprecision(0) << st.bars / secs << " bars/s)\n";
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+// reads the shared-memory prediction table a predictor --publish-shm run writes;
+// the consumer side of prediction_table.h, also a template for other consumers
+
+#include "csv_loader.h"
+#include "prediction_table.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace sp;
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    vector<string> args;
+    map<string, string> options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            size_t eq = arg.find('=');
+            string name = arg.substr(2, eq == string::npos ? string::npos : eq - 2);
+            options[name] = eq == string::npos ? "" : arg.substr(eq + 1);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        cerr << "Usage: prediction_reader <name> [symbol ...] [options]\n";
+        cerr << "\nOptions:\n";
+        cerr << "  --watch=<ms>       print again every ms until interrupted\n";
+        cerr << "  --remove           delete the shared memory segment and exit\n";
+        cerr << "\nWithout symbols every published symbol is printed.\n";
+        return 1;
+    }
+    if (options.count("remove")) {
+        if (!PredictionTable::remove(args[0])) {
+            cerr << "Error: no prediction table named " << args[0] << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    try {
+        PredictionTable table = PredictionTable::open(args[0]);
+        vector<uint32_t> symbols;
+        for (size_t i = 1; i < args.size(); ++i) symbols.push_back(stoul(args[i]));
+        if (symbols.empty()) {
+            for (uint32_t s = 0; s < table.capacity(); ++s) symbols.push_back(s);
+        }
+        int watch_ms = options.count("watch") ? stoi(options["watch"]) : 0;
+        do {
+            cout << setw(8) << "Symbol" << setw(12) << "Date" << setw(14) << "Prediction"
+                 << setw(14) << "Age (us)" << "  Model\n";
+            for (uint32_t s : symbols) {
+                PredictionValue v;
+                if (!table.read(s, v)) continue;
+                double age_us = (PredictionTable::now_ns() - v.timestamp_ns) / 1000.0;
+                cout << setw(8) << s << setw(12) << key_to_date(v.date) << fixed << setprecision(4)
+                     << setw(14) << v.prediction << setprecision(0) << setw(14) << age_us << "  "
+                     << hex << setw(16) << setfill('0') << v.model_version << dec << setfill(' ')
+                     << "\n";
+            }
+            if (watch_ms > 0) this_thread::sleep_for(chrono::milliseconds(watch_ms));
+        } while (watch_ms > 0);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
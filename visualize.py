@@ -1,9 +1,17 @@
 import pandas as pd
 import matplotlib.pyplot as plt
 import numpy as np
+import sys
 
-# Read predictions
-df = pd.read_csv('output/predictions.csv')
+# Read predictions: from libsp when a data csv is given, else from the predictor's output
+if len(sys.argv) > 1:
+    from libsp import run_csv
+    pipeline = run_csv(sys.argv[1])
+    n_train = pipeline.metrics()['train_rows']
+    df = pd.DataFrame({'Actual': pipeline.targets()[n_train:],
+                       'Predicted': pipeline.predictions()[n_train:]})
+else:
+    df = pd.read_csv('output/predictions.csv')
 
 # Create figure with subplots
 fig, axes = plt.subplots(2, 2, figsize=(15, 10))